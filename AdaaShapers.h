@@ -0,0 +1,344 @@
+/*
+  ==============================================================================
+
+    Antiderivative anti-aliasing (ADAA) versions of the distortion modes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    First- and second-order ADAA for every mode in Waveshapers.h.
+
+    Instead of f(x[n]), first order outputs the average of f over the segment
+    from x[n-1] to x[n], (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1]); second order
+    does the same one level further up with F2. That suppresses aliasing
+    without changing the sample rate, at the cost of a gentle high-frequency
+    roll-off and a delay of half a sample (first order) or one sample (second
+    order). The clean half of the mix is delayed to match, so the mix doesn't
+    comb-filter. Nothing is reported to the host as latency.
+
+    When consecutive inputs are too close together, the differences above lose
+    all precision. Those ill-conditioned cases fall back to evaluating f or F1
+    at the midpoint, which is what the difference quotient tends to. Everything
+    is computed in double, since the second-order quotients subtract large,
+    nearly equal values.
+
+    Each mode is a struct with f, F1 and F2 in closed form, and F1(0) = F2(0) = 0.
+    The tanh-based modes need the dilogarithm for F2; see logCoshIntegral().
+*/
+namespace AdaaShapers
+{
+    /** Per-block values, including each mode's integration constants for this threshold. */
+    struct Settings
+    {
+        double threshold = 0.0, inverseThreshold = 0.0;
+        double softAboveF1 = 0.0, softAboveF2 = 0.0;    // SoftClip constants for x > threshold
+        double asymmetricF1 = 0.0, asymmetricF2 = 0.0;  // Asymmetric offsets that make F1(0) = F2(0) = 0
+
+        static Settings make (float threshold) noexcept;
+    };
+
+    static constexpr double ln2 = 0.69314718055994530942;
+
+    //==============================================================================
+    /** Li2(z) for z in [-1, 0), via Li2(z) = -Li2(w) - ln^2(1 - z) / 2 with
+        w = z / (z - 1) in (0, 1/2], and the Bernoulli series in u = -ln(1 - w)
+        for Li2(w). Absolute error is around 1e-13.
+    */
+    inline double dilogOfNegative (double z) noexcept
+    {
+        const auto v = std::log1p (-z);             // ln(1 - z), which is also -ln(1 - w)
+        const auto u = v, u2 = u * u;
+        const auto li2w = u * (1.0 + u * (-0.25 + u * (1.0 / 36.0 + u2 * (-1.0 / 3600.0 + u2 * (1.0 / 211680.0
+                            + u2 * (-1.0 / 10886400.0 + u2 * (1.0 / 526901760.0)))))));
+
+        return -li2w - 0.5 * v * v;
+    }
+
+    /** ln cosh(u), without overflow for large |u|. */
+    inline double logCosh (double u) noexcept
+    {
+        const auto a = std::abs (u);
+        return a + std::log1p (std::exp (-2.0 * a)) - ln2;
+    }
+
+    /** Integral of ln cosh from 0 to u, an odd function:
+        a^2/2 - a ln2 + (Li2(-e^(-2a)) - Li2(-1)) / 2 with a = |u|.
+    */
+    inline double logCoshIntegral (double u) noexcept
+    {
+        const auto a = std::abs (u);
+        const auto dilogAtMinusOne = -juce::MathConstants<double>::pi * juce::MathConstants<double>::pi / 12.0;
+        const auto value = 0.5 * a * a - a * ln2
+                         + 0.5 * (dilogOfNegative (-std::exp (-2.0 * a)) - dilogAtMinusOne);
+
+        return u < 0.0 ? -value : value;
+    }
+
+    //==============================================================================
+    struct HardClip
+    {
+        static double f (double x, const Settings& s) noexcept      { return juce::jlimit (-s.threshold, s.threshold, x); }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            const auto c = f (x, s);
+            return c * x - 0.5 * c * c;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto c = f (x, s);
+            return 0.5 * x * x * c - 0.5 * x * c * c + c * c * c / 6.0;
+        }
+    };
+
+    /** x > t: 1 - e^-x, otherwise e^x - 1. Jumps at t unless t is 0, which ADAA handles like any other input. */
+    struct SoftClip
+    {
+        static double f (double x, const Settings& s) noexcept
+        {
+            return x > s.threshold ? 1.0 - std::exp (-x) : std::exp (x) - 1.0;
+        }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            return x > s.threshold ? x + std::exp (-x) + s.softAboveF1
+                                   : std::exp (x) - x - 1.0;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            return x > s.threshold ? 0.5 * x * x - std::exp (-x) + s.softAboveF1 * x + s.softAboveF2
+                                   : std::exp (x) - 0.5 * x * x - x - 1.0;
+        }
+    };
+
+    struct HalfWave
+    {
+        static double f (double x, const Settings& s) noexcept      { return x > s.threshold ? x : 0.0; }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold;
+            return x > t ? 0.5 * (x * x - t * t) : 0.0;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold;
+            return x > t ? x * x * x / 6.0 - 0.5 * t * t * x + t * t * t / 3.0 : 0.0;
+        }
+    };
+
+    struct Tanh
+    {
+        static double f (double x, const Settings& s) noexcept      { return s.threshold * std::tanh (x * s.inverseThreshold); }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            return s.threshold * s.threshold * logCosh (x * s.inverseThreshold);
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold;
+            return t * t * t * logCoshIntegral (x * s.inverseThreshold);
+        }
+    };
+
+    struct Cubic
+    {
+        static double f (double x, const Settings& s) noexcept
+        {
+            const auto u = juce::jlimit (-1.0, 1.0, x * s.inverseThreshold);
+            return s.threshold * u * (1.5 - 0.5 * u * u);
+        }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold, a = std::abs (x);
+
+            if (a >= t)
+                return t * a - 0.375 * t * t;
+
+            return 0.75 * x * x - 0.125 * x * x * x * x * s.inverseThreshold * s.inverseThreshold;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold, a = std::abs (x);
+
+            const auto value = a >= t ? 0.5 * t * a * a - 0.375 * t * t * a + 0.1 * t * t * t
+                                      : 0.25 * a * a * a - a * a * a * a * a * s.inverseThreshold * s.inverseThreshold / 40.0;
+
+            return x < 0.0 ? -value : value;
+        }
+    };
+
+    struct Asymmetric
+    {
+        static constexpr double bias = 0.5;
+        static constexpr double offset = 0.46211715726000974;     // tanh (bias)
+
+        static double f (double x, const Settings& s) noexcept
+        {
+            return s.threshold * (std::tanh (x * s.inverseThreshold + bias) - offset);
+        }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold;
+            return t * t * logCosh (x * s.inverseThreshold + bias) - t * offset * x + s.asymmetricF1;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold;
+            return t * t * t * logCoshIntegral (x * s.inverseThreshold + bias)
+                     - 0.5 * t * offset * x * x + s.asymmetricF1 * x + s.asymmetricF2;
+        }
+    };
+
+    /** Triangle fold of period 4 in u = x / t. F1 is periodic; F2 grows as t^3 u / 2 plus a periodic part. */
+    struct Foldback
+    {
+        static double phase (double x, const Settings& s) noexcept
+        {
+            const auto v = x * s.inverseThreshold + 1.0;
+            return v - 4.0 * std::floor (v * 0.25);
+        }
+
+        static double f (double x, const Settings& s) noexcept
+        {
+            return s.threshold * (1.0 - std::abs (phase (x, s) - 2.0));
+        }
+
+        static double F1 (double x, const Settings& s) noexcept
+        {
+            const auto p = phase (x, s);
+            const auto h = p < 2.0 ? 0.5 * (p - 1.0) * (p - 1.0) : 1.0 - 0.5 * (p - 3.0) * (p - 3.0);
+            return s.threshold * s.threshold * h;
+        }
+
+        static double F2 (double x, const Settings& s) noexcept
+        {
+            const auto t = s.threshold, p = phase (x, s);
+            const auto j = p < 2.0 ? (p - 1.0) * (p - 1.0) * (p - 1.0) / 6.0 - 0.5 * p + 1.0 / 6.0
+                                   : 0.5 * p - (p - 3.0) * (p - 3.0) * (p - 3.0) / 6.0 - 11.0 / 6.0;
+            return t * t * t * (0.5 * x * s.inverseThreshold + j + 1.0 / 3.0);
+        }
+    };
+
+    inline Settings Settings::make (float thresholdValue) noexcept
+    {
+        Settings s;
+        s.threshold = (double) thresholdValue;
+        s.inverseThreshold = s.threshold > 0.0 ? 1.0 / s.threshold : 0.0;
+
+        // SoftClip: continuity of F1 and F2 at x = t.
+        const auto t = s.threshold;
+        s.softAboveF1 = std::exp (t) - 2.0 * t - 1.0 - std::exp (-t);
+        s.softAboveF2 = std::exp (t) - t * t - t - 1.0 + std::exp (-t) - s.softAboveF1 * t;
+
+        s.asymmetricF1 = -t * t * logCosh (Asymmetric::bias);
+        s.asymmetricF2 = -t * t * t * logCoshIntegral (Asymmetric::bias);
+        return s;
+    }
+
+    //==============================================================================
+    /** Inputs that came before the current block, per channel. */
+    struct ChannelState
+    {
+        double x1 = 0.0, x2 = 0.0;
+    };
+
+    /** Differences closer than this are treated as ill-conditioned. */
+    static constexpr double tolerance = 1.0e-5;
+
+    template <typename Shape>
+    void processFirstOrder (float* samples, int numSamples, ChannelState& state, const Settings& s, float mix) noexcept
+    {
+        const auto wet = (double) mix, dry = 1.0 - wet;
+
+        // Recomputed from the stored input each block, so a threshold or mode change never leaves a stale F1 behind.
+        auto x1 = state.x1, x2 = state.x2;
+        auto F1x1 = Shape::F1 (x1, s);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x0 = (double) samples[i];
+            const auto F1x0 = Shape::F1 (x0, s);
+            const auto d = x0 - x1;
+
+            const auto shaped = std::abs (d) < tolerance ? Shape::f (0.5 * (x0 + x1), s)
+                                                         : (F1x0 - F1x1) / d;
+
+            samples[i] = (float) (dry * 0.5 * (x0 + x1) + wet * shaped);
+
+            x2 = x1;
+            x1 = x0;
+            F1x1 = F1x0;
+        }
+
+        // Kept for second-order ADAA, which needs the last two inputs if the mode switches.
+        state.x2 = x2;
+        state.x1 = x1;
+    }
+
+    template <typename Shape>
+    void processSecondOrder (float* samples, int numSamples, ChannelState& state, const Settings& s, float mix) noexcept
+    {
+        const auto wet = (double) mix, dry = 1.0 - wet;
+
+        // First divided difference of F2, falling back to F1 at the midpoint.
+        const auto difference = [&s] (double a, double b, double F2a, double F2b)
+        {
+            const auto d = a - b;
+            return std::abs (d) < tolerance ? Shape::F1 (0.5 * (a + b), s) : (F2a - F2b) / d;
+        };
+
+        auto x1 = state.x1, x2 = state.x2;
+        auto F2x1 = Shape::F2 (x1, s);
+        auto D1 = difference (x1, x2, F2x1, Shape::F2 (x2, s));
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x0 = (double) samples[i];
+            const auto F2x0 = Shape::F2 (x0, s);
+            const auto D0 = difference (x0, x1, F2x0, F2x1);
+            const auto d = x0 - x2;
+
+            double shaped;
+
+            if (std::abs (d) >= tolerance)
+            {
+                shaped = 2.0 * (D0 - D1) / d;
+            }
+            else
+            {
+                // x[n] and x[n-2] coincide: expand around their mean instead.
+                const auto mean = 0.5 * (x0 + x2);
+                const auto delta = mean - x1;
+
+                shaped = std::abs (delta) < tolerance ? Shape::f (0.5 * (mean + x1), s)
+                                                      : 2.0 / delta * (Shape::F1 (mean, s) + (F2x1 - Shape::F2 (mean, s)) / delta);
+            }
+
+            samples[i] = (float) (dry * x1 + wet * shaped);
+
+            x2 = x1;
+            x1 = x0;
+            F2x1 = F2x0;
+            D1 = D0;
+        }
+
+        state.x1 = x1;
+        state.x2 = x2;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    Hands the signal before and after the effect chain to the analyser view.
+
+  ==============================================================================
+*/
+
+#include "AnalyserTap.h"
+
+//==============================================================================
+AnalyserTap::AnalyserTap()
+{
+    buffer.clear();
+}
+
+void AnalyserTap::prepare (double newSampleRate, int maximumBlockSize)
+{
+    sampleRate.store (newSampleRate, std::memory_order_relaxed);
+
+    scratch.setSize (numTaps, maximumBlockSize);
+}
+
+void AnalyserTap::mixToMono (const juce::dsp::AudioBlock<float>& block, float* destination, int numSamples) noexcept
+{
+    using FVO = juce::FloatVectorOperations;
+
+    const auto numChannels = (int) block.getNumChannels();
+    const auto scale = 1.0f / (float) juce::jmax (1, numChannels);
+
+    if (numChannels == 0)
+    {
+        FVO::clear (destination, numSamples);
+        return;
+    }
+
+    FVO::copyWithMultiply (destination, block.getChannelPointer (0), scale, numSamples);
+
+    for (int channel = 1; channel < numChannels; ++channel)
+        FVO::addWithMultiply (destination, block.getChannelPointer ((size_t) channel), scale, numSamples);
+}
+
+void AnalyserTap::capturePre (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    preCaptured = active.load (std::memory_order_relaxed);
+
+    if (preCaptured)
+        mixToMono (block, scratch.getWritePointer (pre), juce::jmin ((int) block.getNumSamples(), scratch.getNumSamples()));
+}
+
+void AnalyserTap::pushPost (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    // Only if the pre half of this block was taken too, so a view switched on mid-block can't pair it with stale samples.
+    if (! preCaptured)
+        return;
+
+    const auto numSamples = juce::jmin ((int) block.getNumSamples(), scratch.getNumSamples());
+    mixToMono (block, scratch.getWritePointer (post), numSamples);
+
+    if (fifo.getFreeSpace() < numSamples)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    for (int t = 0; t < numTaps; ++t)
+    {
+        buffer.copyFrom (t, start1, scratch, t, 0, size1);
+
+        if (size2 > 0)
+            buffer.copyFrom (t, start2, scratch, t, size1, size2);
+    }
+
+    fifo.finishedWrite (size1 + size2);
+}
+
+//==============================================================================
+int AnalyserTap::pop (float* preSamples, float* postSamples, int maxSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        juce::FloatVectorOperations::copy (preSamples, buffer.getReadPointer (pre, start1), size1);
+        juce::FloatVectorOperations::copy (postSamples, buffer.getReadPointer (post, start1), size1);
+    }
+
+    if (size2 > 0)
+    {
+        juce::FloatVectorOperations::copy (preSamples + size1, buffer.getReadPointer (pre, start2), size2);
+        juce::FloatVectorOperations::copy (postSamples + size1, buffer.getReadPointer (post, start2), size2);
+    }
+
+    fifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    Hands the signal before and after the effect chain to the analyser view.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Copies the chain's input and output, each mixed down to mono, into a FIFO
+    that the analyser view drains on the message thread.
+
+    The audio thread calls capturePre() before the chain and pushPost() after
+    it. pushPost() writes the pre and post samples of the block side by side,
+    so the two stay aligned. The writer never waits. When the FIFO is full the
+    block is dropped, and the reader sees a gap instead of stale audio.
+
+    While no view is active, both calls return at once, so a closed editor or
+    a hidden analyser tab costs the audio thread one atomic load per block.
+*/
+class AnalyserTap
+{
+public:
+    enum Tap
+    {
+        pre,
+        post,
+        numTaps
+    };
+
+    /** Over 0.15 s at 192 kHz: several frames at the view's refresh rate. */
+    static constexpr int fifoSize = 1 << 15;
+
+    AnalyserTap();
+
+    /** Call before playback starts, off the audio thread. */
+    void prepare (double sampleRate, int maximumBlockSize);
+    double getSampleRate() const noexcept                   { return sampleRate.load (std::memory_order_relaxed); }
+
+    /** Message thread: set while a view is showing. */
+    void setActive (bool shouldBeActive) noexcept           { active.store (shouldBeActive, std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Audio thread. */
+    void capturePre (const juce::dsp::AudioBlock<float>& block) noexcept;
+    void pushPost (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    //==============================================================================
+    /** Message thread: moves up to maxSamples of each tap into the arrays; returns how many. */
+    int pop (float* preSamples, float* postSamples, int maxSamples) noexcept;
+
+private:
+    static void mixToMono (const juce::dsp::AudioBlock<float>& block, float* destination, int numSamples) noexcept;
+
+    juce::AbstractFifo fifo { fifoSize };
+    juce::AudioBuffer<float> buffer { numTaps, fifoSize };
+
+    juce::AudioBuffer<float> scratch;           // this block's pre and post, waiting to go in together
+    bool preCaptured = false;
+
+    std::atomic<bool> active { false };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyserTap)
+};
@@ -0,0 +1,346 @@
+/*
+  ==============================================================================
+
+    Spectrum analyser and oscilloscope for the signal around the effect chain.
+
+  ==============================================================================
+*/
+
+#include "AnalyserView.h"
+#include "Parameters.h"
+
+namespace
+{
+    // Ballistics, per frame at frameRateHz.
+    constexpr float releaseDecibelsPerFrame = 2.0f;      // 60 dB/s
+    constexpr int peakHoldFrames = 45;                   // 1.5 s
+    constexpr float peakFallDecibelsPerFrame = 0.7f;     // about 20 dB/s
+
+    // The scope shows this many samples, starting at a rising zero crossing found in the half of the window before them.
+    constexpr int scopeLength = 1024;
+
+    const juce::Colour backgroundColour = juce::Colour::fromRGB (30, 34, 38);
+    // Plain ARGB rather than juce::Colours, which may not be constructed yet when these are.
+    const juce::Colour gridColour (0x1fffffffu);
+    const juce::Colour preColour (0x80d3d3d3u);
+    const juce::Colour postColour = juce::Colour::fromRGB (242, 202, 16);
+    const juce::Colour markerColour = juce::Colour::fromRGB (115, 155, 184);
+}
+
+//==============================================================================
+constexpr float AnalyserView::minFrequency, AnalyserView::maxFrequency;
+constexpr float AnalyserView::minDecibels, AnalyserView::maxDecibels;
+
+AnalyserView::AnalyserView (AnalyserTap& t, juce::AudioProcessorValueTreeState& apvts)
+    : ShowingTimerComponent (frameRateHz),
+      tap (t),
+      cutoff (apvts.getRawParameterValue (ParamIDs::cutoff)),
+      threshold (apvts.getRawParameterValue (ParamIDs::threshold)),
+      fftData ((size_t) (2 * fftSize)),
+      popPre ((size_t) fftSize),
+      popPost ((size_t) fftSize)
+{
+    for (auto& signal : signals)
+    {
+        signal.history.assign ((size_t) fftSize, 0.0f);
+        signal.window.assign ((size_t) fftSize, 0.0f);
+        signal.scopePath.preallocateSpace (3 * (scopeLength + 1));
+    }
+
+    setOpaque (true);
+}
+
+AnalyserView::~AnalyserView()
+{
+    tap.setActive (false);
+}
+
+void AnalyserView::showingChanged (bool isNowShowing)
+{
+    tap.setActive (isNowShowing);
+
+    // Whatever is left in the FIFO is from the last time the view was showing.
+    if (isNowShowing)
+        while (tap.pop (popPre.data(), popPost.data(), fftSize) > 0) {}
+}
+
+void AnalyserView::timerCallback()
+{
+    if (! drain())
+        return;
+
+    for (auto& signal : signals)
+        analyse (signal);
+
+    repaint();
+}
+
+//==============================================================================
+bool AnalyserView::drain()
+{
+    if (tap.getSampleRate() != sampleRate)
+    {
+        sampleRate = tap.getSampleRate();
+        updateColumnBins();
+    }
+
+    auto anythingNew = false;
+
+    for (;;)
+    {
+        const auto numSamples = tap.pop (popPre.data(), popPost.data(), fftSize);
+
+        if (numSamples == 0)
+            break;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            signals[AnalyserTap::pre].history[(size_t) writePosition] = popPre[(size_t) i];
+            signals[AnalyserTap::post].history[(size_t) writePosition] = popPost[(size_t) i];
+            writePosition = (writePosition + 1) % fftSize;
+        }
+
+        anythingNew = true;
+    }
+
+    return anythingNew;
+}
+
+void AnalyserView::unwrap (Signal& signal) const
+{
+    const auto numAfterWrite = fftSize - writePosition;
+
+    std::copy_n (signal.history.begin() + writePosition, numAfterWrite, signal.window.begin());
+    std::copy_n (signal.history.begin(), writePosition, signal.window.begin() + numAfterWrite);
+}
+
+void AnalyserView::analyse (Signal& signal)
+{
+    unwrap (signal);
+
+    std::copy (signal.window.begin(), signal.window.end(), fftData.begin());
+    std::fill (fftData.begin() + fftSize, fftData.end(), 0.0f);
+
+    hann.multiplyWithWindowingTable (fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform (fftData.data());
+
+    // The window is normalised to unity gain, so a full-scale sine peaks at fftSize / 2.
+    const auto scale = 2.0f / (float) fftSize;
+    const auto numBins = fftSize / 2;
+    const auto numColumns = (int) signal.levels.size();
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const auto left = columnBins[(size_t) column];
+        const auto right = columnBins[(size_t) column + 1];
+        float magnitude;
+
+        if (right - left < 1.0f)
+        {
+            // Narrower than a bin, at the low end: interpolate between the two nearest.
+            const auto centre = 0.5f * (left + right);
+            const auto bin = juce::jmin ((int) centre, numBins - 1);
+            const auto fraction = centre - (float) bin;
+            magnitude = fftData[(size_t) bin] + fraction * (fftData[(size_t) bin + 1] - fftData[(size_t) bin]);
+        }
+        else
+        {
+            // Wider: the loudest bin, so narrow peaks don't vanish between columns.
+            const auto first = (int) left;
+            const auto last = juce::jmin ((int) std::ceil (right), numBins);
+            magnitude = *std::max_element (fftData.begin() + first, fftData.begin() + juce::jmax (first + 1, last));
+        }
+
+        const auto decibels = juce::Decibels::gainToDecibels (magnitude * scale, minDecibels);
+        auto& level = signal.levels[(size_t) column];
+        level = juce::jmax (decibels, level - releaseDecibelsPerFrame);
+
+        auto& peak = signal.peaks[(size_t) column];
+        auto& age = signal.peakAge[(size_t) column];
+
+        if (level >= peak)
+        {
+            peak = level;
+            age = 0;
+        }
+        else if (++age > peakHoldFrames)
+        {
+            peak = juce::jmax (level, peak - peakFallDecibelsPerFrame);
+        }
+    }
+
+    buildSpectrumPath (signal.spectrumPath, signal.levels);
+    buildSpectrumPath (signal.peakPath, signal.peaks);
+}
+
+void AnalyserView::updateColumnBins()
+{
+    const auto numColumns = spectrumArea.getWidth();
+
+    columnBins.resize ((size_t) numColumns + 1);
+
+    for (auto& signal : signals)
+    {
+        signal.levels.assign ((size_t) numColumns, minDecibels);
+        signal.peaks.assign ((size_t) numColumns, minDecibels);
+        signal.peakAge.assign ((size_t) numColumns, 0);
+        signal.spectrumPath.preallocateSpace (3 * (numColumns + 1));
+        signal.peakPath.preallocateSpace (3 * (numColumns + 1));
+    }
+
+    const auto binsPerHz = sampleRate > 0.0 ? (float) (fftSize / sampleRate) : 0.0f;
+
+    for (int x = 0; x <= numColumns; ++x)
+    {
+        const auto frequency = minFrequency * std::pow (maxFrequency / minFrequency, (float) x / (float) juce::jmax (1, numColumns));
+        columnBins[(size_t) x] = juce::jmin (frequency * binsPerHz, (float) (fftSize / 2 - 1));
+    }
+}
+
+//==============================================================================
+float AnalyserView::frequencyToX (float frequency) const noexcept
+{
+    const auto proportion = std::log (frequency / minFrequency) / std::log (maxFrequency / minFrequency);
+    return (float) spectrumArea.getX() + proportion * (float) spectrumArea.getWidth();
+}
+
+float AnalyserView::decibelsToY (float decibels) const noexcept
+{
+    return juce::jmap (decibels, minDecibels, maxDecibels, (float) spectrumArea.getBottom(), (float) spectrumArea.getY());
+}
+
+void AnalyserView::buildSpectrumPath (juce::Path& path, const std::vector<float>& values) const
+{
+    path.clear();
+
+    for (size_t column = 0; column < values.size(); ++column)
+    {
+        const auto x = (float) spectrumArea.getX() + (float) column + 0.5f;
+        const auto y = decibelsToY (values[column]);
+
+        if (column == 0)
+            path.startNewSubPath (x, y);
+        else
+            path.lineTo (x, y);
+    }
+}
+
+int AnalyserView::findTrigger() const noexcept
+{
+    // The most recent rising zero crossing that still leaves scopeLength samples after it.
+    const auto& window = signals[AnalyserTap::post].window;
+
+    for (int i = fftSize - scopeLength; i > fftSize / 2; --i)
+        if (window[(size_t) i - 1] < 0.0f && window[(size_t) i] >= 0.0f)
+            return i;
+
+    return fftSize - scopeLength;
+}
+
+void AnalyserView::buildScopePath (juce::Path& path, const Signal& signal, int triggerOffset) const
+{
+    path.clear();
+
+    const auto area = scopeArea.toFloat();
+    const auto xScale = area.getWidth() / (float) (scopeLength - 1);
+
+    for (int i = 0; i < scopeLength; ++i)
+    {
+        const auto sample = juce::jlimit (-1.0f, 1.0f, signal.window[(size_t) (triggerOffset + i)]);
+        const auto x = area.getX() + (float) i * xScale;
+        const auto y = area.getCentreY() - sample * 0.5f * area.getHeight();
+
+        if (i == 0)
+            path.startNewSubPath (x, y);
+        else
+            path.lineTo (x, y);
+    }
+}
+
+//==============================================================================
+void AnalyserView::paint (juce::Graphics& g)
+{
+    g.fillAll (backgroundColour);
+    paintSpectrum (g);
+    paintScope (g);
+}
+
+void AnalyserView::paintSpectrum (juce::Graphics& g)
+{
+    g.setColour (gridColour);
+
+    for (auto frequency : { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f })
+        g.drawVerticalLine (juce::roundToInt (frequencyToX (frequency)), (float) spectrumArea.getY(), (float) spectrumArea.getBottom());
+
+    for (auto decibels : { 0.0f, -24.0f, -48.0f, -72.0f })
+        g.drawHorizontalLine (juce::roundToInt (decibelsToY (decibels)), (float) spectrumArea.getX(), (float) spectrumArea.getRight());
+
+    g.setColour (juce::Colours::white.withAlpha (0.5f));
+    g.setFont (10.0f);
+
+    for (auto frequency : { 100.0f, 1000.0f, 10000.0f })
+        g.drawText (frequency < 1000.0f ? "100" : juce::String ((int) frequency / 1000) + "k",
+                    juce::Rectangle<float> (frequencyToX (frequency) + 2.0f, (float) spectrumArea.getBottom() - 12.0f, 30.0f, 12.0f),
+                    juce::Justification::centredLeft, false);
+
+    // Filter cutoff.
+    const auto cutoffX = frequencyToX (juce::jlimit (minFrequency, maxFrequency, cutoff->load()));
+    g.setColour (markerColour);
+    g.drawLine (cutoffX, (float) spectrumArea.getY(), cutoffX, (float) spectrumArea.getBottom(), 1.5f);
+
+    const juce::Graphics::ScopedSaveState clip (g);
+    g.reduceClipRegion (spectrumArea);
+
+    g.setColour (preColour);
+    g.strokePath (signals[AnalyserTap::pre].spectrumPath, juce::PathStrokeType (1.0f));
+
+    g.setColour (postColour.withAlpha (0.45f));
+    g.strokePath (signals[AnalyserTap::post].peakPath, juce::PathStrokeType (1.0f));
+
+    g.setColour (postColour);
+    g.strokePath (signals[AnalyserTap::post].spectrumPath, juce::PathStrokeType (1.5f));
+}
+
+void AnalyserView::paintScope (juce::Graphics& g)
+{
+    const auto area = scopeArea.toFloat();
+
+    g.setColour (gridColour);
+    g.drawRect (area);
+    g.drawHorizontalLine (juce::roundToInt (area.getCentreY()), area.getX(), area.getRight());
+
+    // Distortion threshold, where the clipping shapes start to bend the signal.
+    const auto thresholdValue = juce::jlimit (0.0f, 1.0f, threshold->load());
+
+    if (thresholdValue > 0.0f)
+    {
+        g.setColour (markerColour);
+
+        for (auto sign : { 1.0f, -1.0f })
+            g.drawHorizontalLine (juce::roundToInt (area.getCentreY() - sign * thresholdValue * 0.5f * area.getHeight()), area.getX(), area.getRight());
+    }
+
+    const auto triggerOffset = findTrigger();
+    buildScopePath (signals[AnalyserTap::pre].scopePath, signals[AnalyserTap::pre], triggerOffset);
+    buildScopePath (signals[AnalyserTap::post].scopePath, signals[AnalyserTap::post], triggerOffset);
+
+    const juce::Graphics::ScopedSaveState clip (g);
+    g.reduceClipRegion (scopeArea);
+
+    g.setColour (preColour);
+    g.strokePath (signals[AnalyserTap::pre].scopePath, juce::PathStrokeType (1.0f));
+
+    g.setColour (postColour);
+    g.strokePath (signals[AnalyserTap::post].scopePath, juce::PathStrokeType (1.5f));
+}
+
+void AnalyserView::resized()
+{
+    auto area = getLocalBounds().reduced (6);
+
+    scopeArea = area.removeFromRight (area.getWidth() / 3);
+    area.removeFromRight (8);
+    spectrumArea = area;
+
+    updateColumnBins();
+}
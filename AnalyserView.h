@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    Spectrum analyser and oscilloscope for the signal around the effect chain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalyserTap.h"
+#include "ShowingTimerComponent.h"
+
+//==============================================================================
+/**
+    Left: the spectrum of the chain's input (grey) and output (colour) on a
+    log-frequency axis from 20 Hz to 20 kHz, with peak hold on the output and
+    a marker at the filter cutoff. Right: an oscilloscope of both signals,
+    triggered on a rising zero crossing of the output, with the distortion
+    threshold marked.
+
+    Everything runs on the message thread at frameRateHz. Each frame drains
+    the AnalyserTap, then runs one Hann-windowed FFT per signal on the latest
+    fftSize samples. The audio between frames is only kept for the next
+    window, never analysed hop by hop. All buffers, including the paths'
+    storage, are allocated up front or on resize.
+
+    The view activates the tap only while it is showing. A hidden tab or a
+    closed editor costs neither thread anything.
+*/
+class AnalyserView  : public ShowingTimerComponent
+{
+public:
+    AnalyserView (AnalyserTap& tap, juce::AudioProcessorValueTreeState& apvts);
+    ~AnalyserView() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int frameRateHz = 30;
+
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+    static constexpr float minDecibels = -96.0f, maxDecibels = 6.0f;
+
+    struct Signal
+    {
+        std::vector<float> history;         // the last fftSize samples, as a ring
+        std::vector<float> window;          // the same, unwrapped oldest first
+        std::vector<float> levels;          // dB per spectrum column, with a falling release
+        std::vector<float> peaks;           // held maxima of levels
+        std::vector<int> peakAge;           // frames since each peak was set
+        juce::Path spectrumPath, peakPath, scopePath;
+    };
+
+    void timerCallback() override;
+    void showingChanged (bool isNowShowing) override;
+
+    bool drain();
+    void analyse (Signal& signal);
+    void unwrap (Signal& signal) const;
+    void updateColumnBins();
+
+    void buildSpectrumPath (juce::Path& path, const std::vector<float>& values) const;
+    void buildScopePath (juce::Path& path, const Signal& signal, int triggerOffset) const;
+    int findTrigger() const noexcept;
+
+    void paintSpectrum (juce::Graphics& g);
+    void paintScope (juce::Graphics& g);
+
+    float frequencyToX (float frequency) const noexcept;
+    float decibelsToY (float decibels) const noexcept;
+
+    AnalyserTap& tap;
+    std::atomic<float>* cutoff = nullptr;
+    std::atomic<float>* threshold = nullptr;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> hann { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann };
+    std::vector<float> fftData;
+    std::vector<float> popPre, popPost;
+
+    Signal signals[AnalyserTap::numTaps];
+    int writePosition = 0;
+    double sampleRate = 0.0;
+
+    // For each column of the spectrum, the fractional FFT bins at its left and right edges.
+    std::vector<float> columnBins;
+
+    juce::Rectangle<int> spectrumArea, scopeArea;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyserView)
+};
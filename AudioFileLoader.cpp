@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    Opens, prepares and pre-buffers audio files on a background job, then hands
+    them to the audio thread with an atomic pointer swap.
+
+  ==============================================================================
+*/
+
+#include "AudioFileLoader.h"
+
+//==============================================================================
+AudioFileLoader::AudioFileLoader (juce::AudioFormatManager& fm)
+    : formatManager (fm)
+{
+    readAheadThread.startThread();
+}
+
+AudioFileLoader::~AudioFileLoader()
+{
+    latestRequest += 1;                     // makes any running job bail out early
+    loadPool.removeAllJobs (true, 5000);
+
+    delete pending.exchange (nullptr);
+    collectGarbage();
+
+    readAheadThread.stopThread (1000);
+}
+
+void AudioFileLoader::setOptions (const Options& newOptions)
+{
+    const juce::ScopedLock sl (optionsLock);
+    options = newOptions;
+}
+
+AudioFileLoader::Options AudioFileLoader::getOptions() const
+{
+    const juce::ScopedLock sl (optionsLock);
+    return options;
+}
+
+void AudioFileLoader::setPlaybackConfig (double newSampleRate, int newSamplesPerBlock, int newNumChannels)
+{
+    const juce::ScopedLock sl (optionsLock);
+    sampleRate = newSampleRate;
+    samplesPerBlock = newSamplesPerBlock;
+    numChannels = juce::jmax (1, newNumChannels);
+}
+
+//==============================================================================
+void AudioFileLoader::loadAsync (const juce::File& file)
+{
+    const auto requestId = ++latestRequest;
+    loadPool.addJob ([this, file, requestId] { runLoadJob (file, requestId); });
+}
+
+void AudioFileLoader::unloadAsync()
+{
+    loadAsync ({});
+}
+
+void AudioFileLoader::runLoadJob (const juce::File& file, int requestId)
+{
+    collectGarbage();
+
+    if (requestId != latestRequest.load())
+        return;
+
+    const auto currentOptions = getOptions();
+
+    // No file means unload: an empty entry goes through the same hand-off, so the
+    // audio thread retires whatever it was playing in the usual way.
+    auto loaded = file == juce::File() ? std::make_unique<LoadedAudioFile>()
+                                       : open (file, currentOptions);
+
+    if (loaded != nullptr && loaded->source != nullptr && ! preBuffer (*loaded, currentOptions, requestId))
+        return;     // superseded while pre-buffering
+
+    const auto succeeded = loaded != nullptr;
+
+    if (succeeded)
+    {
+        // If the audio thread never claimed the previous one, nobody else can see it.
+        delete pending.exchange (loaded.release(), std::memory_order_acq_rel);
+
+        // The audio thread retires the old file in the same call that claims the
+        // new one, so once the slot empties there is something to clean up.
+        for (int waited = 0; waited < 200 && pending.load() != nullptr; ++waited)
+        {
+            if (requestId != latestRequest.load())
+                break;
+
+            juce::Thread::sleep (5);
+        }
+
+        collectGarbage();
+    }
+
+    std::weak_ptr<int> token (lifetimeToken);
+
+    juce::MessageManager::callAsync ([this, token, file, succeeded, requestId]
+    {
+        if (token.expired())
+            return;
+
+        if (requestId == latestRequest.load() && onLoadFinished != nullptr)
+            onLoadFinished (file, succeeded);
+    });
+}
+
+std::unique_ptr<LoadedAudioFile> AudioFileLoader::open (const juce::File& file, const Options& currentOptions)
+{
+    double rate;
+    int channels;
+
+    {
+        const juce::ScopedLock sl (optionsLock);
+        rate = sampleRate;
+        channels = numChannels;
+    }
+
+    auto loaded = std::make_unique<LoadedAudioFile>();
+    loaded->file = file;
+
+    int fileChannels = 0;
+
+    if (currentOptions.memoryMapping)
+    {
+        if (auto mappedReader = MappedAudioFileSource::createReaderFor (formatManager, file))
+        {
+            loaded->fileSampleRate = mappedReader->sampleRate;
+            fileChannels = (int) mappedReader->numChannels;
+            loaded->mappedSource = std::make_unique<MappedAudioFileSource> (std::move (mappedReader), readAheadThread);
+            loaded->source = loaded->mappedSource.get();
+        }
+    }
+
+    if (loaded->source == nullptr)
+    {
+        auto* reader = formatManager.createReaderFor (file);
+
+        if (reader == nullptr)
+            return {};
+
+        loaded->fileSampleRate = reader->sampleRate;
+        fileChannels = (int) reader->numChannels;
+        loaded->readerSource = std::make_unique<juce::AudioFormatReaderSource> (reader, true);
+        loaded->source = loaded->readerSource.get();
+    }
+
+    // A stereo file on a 7.1.4 bus only needs two channels resampled and buffered; the sources
+    // below clear the rest. Mono stays at two, since the reader copies it to both sides.
+    channels = juce::jlimit (1, channels, juce::jmax (2, fileChannels));
+    loaded->numChannels = channels;
+
+    const auto needsResampling = loaded->fileSampleRate > 0.0 && loaded->fileSampleRate != rate;
+
+    if (needsResampling)
+    {
+        loaded->resamplingSource = std::make_unique<ResamplingPositionableSource> (*loaded->source, loaded->fileSampleRate,
+                                                                                   channels, currentOptions.resamplingQuality);
+        loaded->source = loaded->resamplingSource.get();
+    }
+
+    // Resampling always goes behind the read-ahead buffer; a mapped file at the
+    // session rate is read directly.
+    if (needsResampling || (currentOptions.streaming && loaded->mappedSource == nullptr))
+    {
+        const auto bufferRate = needsResampling ? 0.0 : loaded->fileSampleRate;
+
+        loaded->streamingSource = std::make_unique<StreamingAudioSource> (*loaded->source, readAheadThread, channels,
+                                                                          currentOptions.readAheadSeconds, bufferRate);
+        loaded->source = loaded->streamingSource.get();
+    }
+
+    return loaded;
+}
+
+bool AudioFileLoader::preBuffer (LoadedAudioFile& loaded, const Options& currentOptions, int requestId)
+{
+    double rate;
+    int blockSize;
+
+    {
+        const juce::ScopedLock sl (optionsLock);
+        rate = sampleRate;
+        blockSize = samplesPerBlock;
+    }
+
+    loaded.source->prepareToPlay (blockSize, rate);
+
+    if (loaded.streamingSource != nullptr)
+    {
+        const auto wanted = juce::jmin (loaded.source->getTotalLength(), (juce::int64) (currentOptions.preBufferSeconds * rate));
+        const auto target = (int) juce::jmin (wanted, (juce::int64) loaded.streamingSource->getBufferSize() - 1);
+
+        // Give up waiting after a couple of seconds; playback then starts on whatever has arrived.
+        for (int waited = 0; waited < 2000; ++waited)
+        {
+            if (requestId != latestRequest.load())
+                return false;
+
+            if (loaded.streamingSource->getNumBufferedSamples() >= target)
+                break;
+
+            juce::Thread::sleep (1);
+        }
+    }
+    else if (loaded.mappedSource != nullptr)
+    {
+        loaded.mappedSource->prefetch (0, (juce::int64) (currentOptions.preBufferSeconds * loaded.fileSampleRate));
+    }
+
+    return requestId == latestRequest.load();
+}
+
+//==============================================================================
+LoadedAudioFile* AudioFileLoader::takePending() noexcept
+{
+    if (pending.load (std::memory_order_relaxed) == nullptr)
+        return nullptr;
+
+    // Only swap if the file being replaced, and an empty entry after it, can be queued for destruction.
+    if (retireFifo.getFreeSpace() < 2)
+        return nullptr;
+
+    return pending.exchange (nullptr, std::memory_order_acq_rel);
+}
+
+void AudioFileLoader::retire (LoadedAudioFile* file) noexcept
+{
+    if (file == nullptr)
+        return;
+
+    int start1, size1, start2, size2;
+    retireFifo.prepareToWrite (1, start1, size1, start2, size2);
+    jassert (size1 == 1);   // takePending() guarantees there is room
+
+    if (size1 > 0)
+    {
+        retired[(size_t) start1] = file;
+        retireFifo.finishedWrite (1);
+    }
+}
+
+void AudioFileLoader::collectGarbage()
+{
+    const juce::ScopedLock sl (collectLock);
+
+    while (retireFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        retireFifo.prepareToRead (1, start1, size1, start2, size2);
+
+        std::unique_ptr<LoadedAudioFile> dead (retired[(size_t) start1]);
+        retired[(size_t) start1] = nullptr;
+        retireFifo.finishedRead (1);
+    }
+}
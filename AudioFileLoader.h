@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    Opens, prepares and pre-buffers audio files on a background job, then hands
+    them to the audio thread with an atomic pointer swap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StreamingAudioSource.h"
+#include "MappedAudioFileSource.h"
+#include "PolyphaseResampler.h"
+
+//==============================================================================
+/** Everything needed to play one file. Built and destroyed off the audio thread;
+    while published, only the audio thread touches it.
+*/
+struct LoadedAudioFile
+{
+    juce::File file;
+    double fileSampleRate = 0.0;
+    int numChannels = 0;        // bus channels the source fills; any beyond this are cleared by the player
+
+    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;    // streamed and direct paths
+    std::unique_ptr<StreamingAudioSource> streamingSource;          // streamed path only
+    std::unique_ptr<MappedAudioFileSource> mappedSource;            // PCM WAV/AIFF path only
+    std::unique_ptr<ResamplingPositionableSource> resamplingSource; // only when the file rate differs
+
+    /** Whichever of the above the audio thread should pull from; nullptr in the
+        empty entry unloadAsync() publishes, which plays nothing.
+    */
+    juce::PositionableAudioSource* source = nullptr;
+
+    ~LoadedAudioFile()
+    {
+        if (source != nullptr)
+            source->releaseResources();
+
+        // Each wrapper refers to the one below it, so tear down from the top.
+        streamingSource = nullptr;
+        resamplingSource = nullptr;
+        mappedSource = nullptr;
+        readerSource = nullptr;
+    }
+};
+
+//==============================================================================
+/**
+    Background file loading with a lock-free hand-off.
+
+    loadAsync() queues a job that opens the file, picks the memory-mapped or
+    streamed path, puts a resampler in front of it if the file's rate differs
+    from the session's (always behind the read-ahead buffer, so the audio
+    thread never runs it), prepares it for the current playback settings and waits
+    until the first preBufferSeconds are ready. The result is published into a
+    single pending slot that the audio thread claims with takePending(). The
+    file it replaces goes back through retire(), and is destroyed later by
+    collectGarbage() on a non-real-time thread.
+
+    A newer request supersedes any load still in progress.
+*/
+class AudioFileLoader
+{
+public:
+    struct Options
+    {
+        bool streaming = true;          // read ahead on a background thread
+        bool memoryMapping = true;      // map PCM WAV/AIFF instead of streaming them
+        PolyphaseResampler::Quality resamplingQuality = PolyphaseResampler::Quality::high;
+        double readAheadSeconds = 2.0;
+        double preBufferSeconds = 0.1;
+    };
+
+    explicit AudioFileLoader (juce::AudioFormatManager& formatManager);
+    ~AudioFileLoader();
+
+    /** Applies to files loaded afterwards. Message thread. */
+    void setOptions (const Options& newOptions);
+    Options getOptions() const;
+
+    /** Called from prepareToPlay so new loads are prepared to match. */
+    void setPlaybackConfig (double sampleRate, int samplesPerBlock, int numChannels);
+
+    /** Starts loading in the background and returns immediately. */
+    void loadAsync (const juce::File& file);
+
+    /** Supersedes any load in progress and publishes an entry with no source, so
+        playback stops once the audio thread claims it. Reported to onLoadFinished
+        as a successful load of juce::File().
+    */
+    void unloadAsync();
+
+    /** Called on the message thread when a load finishes; succeeded is false
+        if the file couldn't be opened. Superseded loads aren't reported.
+    */
+    std::function<void (const juce::File& file, bool succeeded)> onLoadFinished;
+
+    //==============================================================================
+    /** Audio thread: claims a newly published file, if any. The caller owns it
+        until it hands it back with retire(). Returns nullptr if nothing is
+        waiting or the retire queue has no room for both the file being replaced
+        and this one, since an empty entry from unloadAsync() is retired straight away.
+    */
+    LoadedAudioFile* takePending() noexcept;
+
+    /** Audio thread: queues a file that is no longer playing for destruction. */
+    void retire (LoadedAudioFile* file) noexcept;
+
+    /** Non-real-time threads: destroys retired files. */
+    void collectGarbage();
+
+    juce::TimeSliceThread& getReadAheadThread() noexcept    { return readAheadThread; }
+
+private:
+    std::unique_ptr<LoadedAudioFile> open (const juce::File& file, const Options& options);
+    bool preBuffer (LoadedAudioFile& loaded, const Options& options, int requestId);
+    void runLoadJob (const juce::File& file, int requestId);
+
+    juce::AudioFormatManager& formatManager;
+
+    mutable juce::CriticalSection optionsLock;
+    Options options;
+    double sampleRate = 44100.0;
+    int samplesPerBlock = 512, numChannels = 2;
+
+    juce::TimeSliceThread readAheadThread { "Audio file read-ahead" };
+    juce::ThreadPool loadPool { 1 };
+    std::atomic<int> latestRequest { 0 };
+
+    std::atomic<LoadedAudioFile*> pending { nullptr };
+
+    // Lets completion callbacks that are still queued on the message thread see that we've gone.
+    std::shared_ptr<int> lifetimeToken { std::make_shared<int> (0) };
+
+    static constexpr int retireCapacity = 32;
+    std::array<LoadedAudioFile*, retireCapacity> retired {};
+    juce::AbstractFifo retireFifo { retireCapacity };
+    juce::CriticalSection collectLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileLoader)
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    Offline renderer that runs audio files through the plug-in without a host.
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+namespace
+{
+    // Decoded audio kept ahead of the processor, and processed audio waiting to be encoded.
+    constexpr int readAheadSamples = 65536;
+    constexpr int writeBehindSamples = 65536;
+}
+
+//==============================================================================
+class BatchRenderer::Worker  : public juce::Thread
+{
+public:
+    Worker (BatchRenderer& o, int index)
+        : juce::Thread ("Batch worker " + juce::String (index)),
+          owner (o),
+          ioThread ("Batch I/O " + juce::String (index))
+    {
+        processor.setNonRealtime (true);
+
+        // Files are already spread over the cores; splitting their channels as well would only oversubscribe them.
+        processor.setParallelProcessingEnabled (false);
+
+        if (owner.options.state.getSize() > 0)
+            processor.setStateInformation (owner.options.state.getData(), (int) owner.options.state.getSize());
+
+        // A state saved mid-playback would have the built-in player drown out the input files.
+        if (auto* play = processor.apvts.getParameter (ParamIDs::play))
+            play->setValueNotifyingHost (0.0f);
+
+        ioThread.startThread (3);
+    }
+
+    ~Worker() override
+    {
+        stopThread (-1);
+        ioThread.stopThread (2000);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            const auto job = owner.nextJob++;
+
+            if (job >= owner.queue.size())
+                break;
+
+            auto& result = owner.results[(size_t) job];
+
+            // Rejected up front, e.g. two inputs that would write the same output.
+            if (result.succeeded())
+                result = owner.renderFile (processor, ioThread, owner.queue.getReference (job));
+
+            if (owner.onFileFinished != nullptr)
+                owner.onFileFinished (result);
+        }
+    }
+
+private:
+    BatchRenderer& owner;
+    AudioProcessor2AudioProcessor processor;
+    juce::TimeSliceThread ioThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+BatchRenderer::BatchRenderer (const Options& o)
+    : options (o)
+{
+    formatManager.registerBasicFormats();
+}
+
+BatchRenderer::~BatchRenderer() = default;
+
+std::vector<BatchRenderer::Result> BatchRenderer::render (const juce::Array<juce::File>& inputs)
+{
+    queue = inputs;
+    results.assign ((size_t) inputs.size(), {});
+    nextJob = 0;
+
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        auto& result = results[(size_t) i];
+        result.input = inputs[i];
+        result.output = getOutputFileFor (inputs[i]);
+
+        for (int j = 0; j < i; ++j)
+            if (results[(size_t) j].output == result.output)
+                result.error = "same output file as " + inputs[j].getFullPathName();
+    }
+
+    const auto numCores = options.numWorkers > 0 ? options.numWorkers : juce::SystemStats::getNumCpus();
+    const auto numWorkers = juce::jlimit (1, juce::jmax (1, inputs.size()), numCores);
+
+    // Created here so each processor is constructed on the message thread.
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.push_back (std::make_unique<Worker> (*this, i + 1));
+
+    for (auto& worker : workers)
+        worker->startThread();
+
+    for (auto& worker : workers)
+        worker->waitForThreadToExit (-1);
+
+    return results;
+}
+
+juce::File BatchRenderer::getOutputFileFor (const juce::File& input) const
+{
+    return options.outputDirectory.getChildFile (input.getFileNameWithoutExtension() + options.suffix + options.formatExtension);
+}
+
+bool BatchRenderer::loadStateFile (const juce::File& file, juce::MemoryBlock& destData)
+{
+    if (auto xml = juce::parseXML (file))
+    {
+        juce::AudioProcessor::copyXmlToBinary (*xml, destData);
+        return true;
+    }
+
+    return file.loadFileAsData (destData) && destData.getSize() > 0;
+}
+
+//==============================================================================
+BatchRenderer::Result BatchRenderer::renderFile (AudioProcessor2AudioProcessor& processor,
+                                                 juce::TimeSliceThread& ioThread,
+                                                 const juce::File& input)
+{
+    Result result;
+    result.input = input;
+    result.output = getOutputFileFor (input);
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    const auto finish = [&result, startTime] (const juce::String& error)
+    {
+        result.error = error;
+        result.secondsTaken = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        return result;
+    };
+
+    if (result.output.exists() && ! options.overwrite)
+        return finish ("output already exists");
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input));
+
+    if (reader == nullptr)
+        return finish ("unreadable or unsupported format");
+
+    const auto numChannels = juce::jlimit (1, AudioProcessor2AudioProcessor::maxBusChannels, (int) reader->numChannels);
+    const auto fileSampleRate = reader->sampleRate;
+    const auto sampleRate = options.sampleRate > 0.0 ? options.sampleRate : fileSampleRate;
+    const auto blockSize = juce::jmax (1, options.blockSize);
+
+    auto* format = formatManager.findFormatForFileExtension (options.formatExtension);
+
+    if (format == nullptr)
+        return finish ("no writer for " + options.formatExtension + " files");
+
+    //==============================================================================
+    const auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (channelSet);
+    layout.outputBuses.add (channelSet);
+
+    if (! processor.setBusesLayout (layout))
+        return finish ("the plug-in doesn't accept " + juce::String (numChannels) + " channels");
+
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    //==============================================================================
+    // Decoding runs ahead on the I/O thread; the worker only ever blocks if it catches up.
+    auto* bufferingReader = new juce::BufferingAudioReader (reader.release(), ioThread, readAheadSamples);
+    bufferingReader->setReadTimeout (-1);
+
+    juce::AudioFormatReaderSource readerSource (bufferingReader, true);
+    std::unique_ptr<ResamplingPositionableSource> resamplingSource;
+    juce::PositionableAudioSource* source = &readerSource;
+
+    if (fileSampleRate != sampleRate)
+    {
+        resamplingSource = std::make_unique<ResamplingPositionableSource> (readerSource, fileSampleRate, numChannels,
+                                                                           PolyphaseResampler::Quality::best);
+        source = resamplingSource.get();
+    }
+
+    source->prepareToPlay (blockSize, sampleRate);
+
+    //==============================================================================
+    // Written to a temporary file first, so a failed or interrupted render never leaves half an output behind.
+    result.output.getParentDirectory().createDirectory();
+    juce::TemporaryFile tempFile (result.output);
+    std::unique_ptr<juce::FileOutputStream> stream (tempFile.getFile().createOutputStream());
+
+    if (stream == nullptr || stream->failedToOpen())
+        return finish ("can't create " + tempFile.getFile().getFullPathName());
+
+    auto* writer = format->createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                            options.bitsPerSample, {}, 0);
+
+    if (writer == nullptr)
+        return finish ("can't write " + juce::String (numChannels) + " channels at " + juce::String (options.bitsPerSample)
+                        + " bits to " + options.formatExtension);
+
+    stream.release();   // owned by the writer now
+
+    auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter> (writer, ioThread,
+                                                                                     juce::jmax (writeBehindSamples, blockSize * 4));
+
+    //==============================================================================
+    const auto latency = (juce::int64) processor.getLatencySamples();
+    const auto inputLength = source->getTotalLength();
+    const auto outputLength = inputLength + (juce::int64) juce::roundToInt (options.tailSeconds * sampleRate);
+    const auto lengthToProcess = outputLength + latency;
+
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+    juce::MidiBuffer midi;
+    const float* channels[AudioProcessor2AudioProcessor::maxBusChannels];
+
+    for (juce::int64 processed = 0; processed < lengthToProcess;)
+    {
+        const auto numThisBlock = (int) juce::jmin ((juce::int64) blockSize, lengthToProcess - processed);
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, numThisBlock);
+
+        // Past the end of the input, silence keeps the chain running for the tail and latency.
+        const auto numFromSource = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numThisBlock, inputLength - processed);
+
+        if (numFromSource > 0)
+            source->getNextAudioBlock (juce::AudioSourceChannelInfo (&block, 0, numFromSource));
+
+        if (numFromSource < numThisBlock)
+            block.clear (numFromSource, numThisBlock - numFromSource);
+
+        processor.processBlock (block, midi);
+
+        // The first latency samples are the chain filling up; dropping them keeps the output aligned with the input.
+        const auto numToSkip = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numThisBlock, latency - processed);
+        const auto numToWrite = (int) juce::jmin ((juce::int64) (numThisBlock - numToSkip), outputLength - result.samplesWritten);
+
+        if (numToWrite > 0)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                channels[ch] = block.getReadPointer (ch, numToSkip);
+
+            // The encoder's buffer is full: wait for it rather than growing it.
+            while (! threadedWriter->write (channels, numToWrite))
+                juce::Thread::sleep (1);
+
+            result.samplesWritten += numToWrite;
+        }
+
+        processed += numThisBlock;
+    }
+
+    threadedWriter.reset();     // flushes whatever is still queued
+    source->releaseResources();
+    processor.releaseResources();
+
+    if (! tempFile.overwriteTargetFileWithTemporary())
+        return finish ("can't move the output into place");
+
+    return finish ({});
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    Offline renderer that runs audio files through the plug-in without a host.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../PluginProcessor.h"
+
+//==============================================================================
+/**
+    Renders a list of files through AudioProcessor2AudioProcessor with the same
+    state applied to every one, as fast as the machine allows.
+
+    Each worker thread owns one processor instance and takes the next file from
+    a shared queue when it finishes the last. A file moves through three stages
+    that overlap:
+    - A BufferingAudioReader decodes ahead of the processor.
+    - The worker feeds blocks to processBlock.
+    - An AudioFormatWriter::ThreadedWriter encodes behind it.
+
+    Decode and encode share one background thread per worker. Both buffers
+    have a fixed size, so memory stays flat however long the file is. When the
+    encoder falls behind, the worker waits for it rather than queueing more.
+
+    The processor's reported latency is trimmed from the start of each output,
+    so the result lines up with its input. Files whose rate differs from the
+    requested one go through the same resampler as file playback.
+
+    Construct and call render() on the message thread. The processors are
+    created there and only prepared and run on the workers.
+*/
+class BatchRenderer
+{
+public:
+    struct Options
+    {
+        juce::MemoryBlock state;            // from getStateInformation(); empty leaves the defaults
+        juce::File outputDirectory;
+        juce::String suffix;                // appended to each output's file name
+        juce::String formatExtension = ".wav";
+        int bitsPerSample = 24;
+        double sampleRate = 0.0;            // 0 processes each file at its own rate
+        int blockSize = 512;
+        double tailSeconds = 0.0;           // silence run through the chain after the input ends, for delay tails
+        int numWorkers = 0;                 // 0 uses one per core
+        bool overwrite = false;
+    };
+
+    struct Result
+    {
+        juce::File input, output;
+        juce::String error;                 // empty on success
+        juce::int64 samplesWritten = 0;
+        double secondsTaken = 0.0;
+
+        bool succeeded() const noexcept     { return error.isEmpty(); }
+    };
+
+    explicit BatchRenderer (const Options& options);
+    ~BatchRenderer();
+
+    /** Called on a worker thread as each file finishes; must be thread-safe. */
+    std::function<void (const Result&)> onFileFinished;
+
+    /** Processes every file and returns once all are done, with one result per input in the same order. */
+    std::vector<Result> render (const juce::Array<juce::File>& inputs);
+
+    /** Reads a state file: either a binary blob as saved by the plug-in, or its XML. */
+    static bool loadStateFile (const juce::File& file, juce::MemoryBlock& destData);
+
+private:
+    class Worker;
+
+    Result renderFile (AudioProcessor2AudioProcessor& processor, juce::TimeSliceThread& ioThread, const juce::File& input);
+    juce::File getOutputFileFor (const juce::File& input) const;
+
+    const Options options;
+    juce::AudioFormatManager formatManager;
+
+    juce::Array<juce::File> queue;
+    std::vector<Result> results;
+    std::atomic<int> nextJob { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    Command-line entry point for the offline batch renderer.
+
+    Built as a console app against the same sources and JucePlugin_* settings
+    as the plug-in, minus the wrapper: the BatchRenderer target in
+    CMakeLists.txt.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BatchRenderer.h"
+
+namespace
+{
+    const char* const usage =
+        "Renders audio files through the effect with a fixed state.\n"
+        "\n"
+        "usage: BatchRenderer --out=<dir> [options] <files or folders>...\n"
+        "\n"
+        "  --out=<dir>        where the results go (required)\n"
+        "  --state=<file>     plug-in state or preset, binary or XML; defaults otherwise\n"
+        "  --rate=<hz>        sample rate to process at; each file's own rate if left out\n"
+        "  --block=<samples>  block size handed to processBlock (default 512)\n"
+        "  --jobs=<n>         files rendered at once (default: one per core)\n"
+        "  --tail=<seconds>   extra output after the input ends, for delay tails (default 0)\n"
+        "  --format=<ext>     output format: wav, aiff or flac (default wav)\n"
+        "  --bits=<n>         output bit depth (default 24)\n"
+        "  --suffix=<text>    appended to each output file name\n"
+        "  --overwrite        replace outputs that already exist\n";
+
+    juce::Array<juce::File> collectInputs (const juce::ArgumentList& args, const juce::String& wildcard)
+    {
+        juce::Array<juce::File> inputs;
+
+        for (const auto& arg : args.arguments)
+        {
+            if (arg.isOption())
+                continue;
+
+            const auto file = arg.resolveAsFile();
+
+            if (file.isDirectory())
+            {
+                auto found = file.findChildFiles (juce::File::findFiles, true, wildcard);
+                found.sort();
+                inputs.addArray (found);
+            }
+            else
+            {
+                inputs.add (file);
+            }
+        }
+
+        return inputs;
+    }
+
+    int fail (const juce::String& message)
+    {
+        std::cerr << message << "\n\n" << usage;
+        return 1;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor and its parameters expect a message manager to exist.
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h") || args.size() == 0)
+    {
+        std::cout << usage;
+        return 0;
+    }
+
+    BatchRenderer::Options options;
+
+    if (! args.containsOption ("--out"))
+        return fail ("No output folder given.");
+
+    options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--out").unquoted());
+
+    if (args.containsOption ("--state"))
+    {
+        const auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--state").unquoted());
+
+        if (! BatchRenderer::loadStateFile (stateFile, options.state))
+            return fail ("Can't read the state file " + stateFile.getFullPathName());
+    }
+
+    if (args.containsOption ("--rate"))
+        options.sampleRate = args.getValueForOption ("--rate").getDoubleValue();
+
+    if (args.containsOption ("--block"))
+        options.blockSize = juce::jlimit (16, 65536, args.getValueForOption ("--block").getIntValue());
+
+    if (args.containsOption ("--jobs"))
+        options.numWorkers = juce::jmax (1, args.getValueForOption ("--jobs").getIntValue());
+
+    if (args.containsOption ("--tail"))
+        options.tailSeconds = juce::jmax (0.0, args.getValueForOption ("--tail").getDoubleValue());
+
+    if (args.containsOption ("--format"))
+        options.formatExtension = "." + args.getValueForOption ("--format").trimCharactersAtStart (".");
+
+    if (args.containsOption ("--bits"))
+        options.bitsPerSample = args.getValueForOption ("--bits").getIntValue();
+
+    options.suffix = args.getValueForOption ("--suffix");
+    options.overwrite = args.containsOption ("--overwrite");
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    const auto inputs = collectInputs (args, formats.getWildcardForAllFormats());
+
+    if (inputs.isEmpty())
+        return fail ("No input files given.");
+
+    //==============================================================================
+    BatchRenderer renderer (options);
+    juce::CriticalSection printLock;
+    std::atomic<int> numDone { 0 };
+
+    renderer.onFileFinished = [&] (const BatchRenderer::Result& result)
+    {
+        const juce::ScopedLock sl (printLock);
+        const auto count = "[" + juce::String (++numDone) + "/" + juce::String (inputs.size()) + "] ";
+
+        if (result.succeeded())
+            std::cout << count << result.output.getFullPathName() << " (" << juce::String (result.secondsTaken, 2) << " s)" << std::endl;
+        else
+            std::cerr << count << result.input.getFullPathName() << ": " << result.error << std::endl;
+    };
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+    const auto results = renderer.render (inputs);
+
+    const auto numFailed = (int) std::count_if (results.begin(), results.end(), [] (const BatchRenderer::Result& r) { return ! r.succeeded(); });
+
+    std::cout << (results.size() - (size_t) numFailed) << " rendered, " << numFailed << " failed in "
+              << juce::String ((juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001, 1) << " s" << std::endl;
+
+    return numFailed == 0 ? 0 : 2;
+}
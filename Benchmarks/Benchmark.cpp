@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    Timing harness shared by the microbenchmarks.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    inline juce::uint64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #else
+        return 0;
+       #endif
+    }
+
+    // Input blocks are taken in turn from this many blocks of noise, so the input keeps changing
+    // without the noise being generated inside the timed loop.
+    constexpr int numNoiseBlocks = 16;
+
+    double median (std::vector<double> values)
+    {
+        std::sort (values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+}
+
+//==============================================================================
+juce::String getAutomationName (Automation automation)
+{
+    switch (automation)
+    {
+        case Automation::ramp:  return "ramp";
+        case Automation::jump:  return "jump";
+        case Automation::none:
+        default:                return "static";
+    }
+}
+
+float getAutomationValue (Automation automation, int blockIndex, float restingValue) noexcept
+{
+    switch (automation)
+    {
+        case Automation::ramp:
+        {
+            // Triangle over 256 blocks.
+            const auto phase = (float) (blockIndex & 255) / 128.0f;
+            return phase < 1.0f ? phase : 2.0f - phase;
+        }
+
+        case Automation::jump:
+        {
+            // Integer hash, so every run sees the same sequence.
+            auto x = (juce::uint32) blockIndex * 0x9e3779b9u;
+            x ^= x >> 16;
+            x *= 0x85ebca6bu;
+            x ^= x >> 13;
+            return (float) (x & 0xffffu) / 65535.0f;
+        }
+
+        case Automation::none:
+        default:
+            return restingValue;
+    }
+}
+
+//==============================================================================
+bool hasCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+Measurement measure (BenchmarkStage& stage, const BenchmarkConfig& config, const MeasurementSettings& settings)
+{
+    const juce::ScopedNoDenormals noDenormals;
+
+    const auto blockSize = config.blockSize;
+    juce::AudioBuffer<float> noise (config.numChannels, blockSize * numNoiseBlocks);
+    juce::AudioBuffer<float> buffer (config.numChannels, blockSize);
+    juce::Random random (0x5eed);
+
+    for (int ch = 0; ch < noise.getNumChannels(); ++ch)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample (ch, i, random.nextFloat() - 0.5f);
+
+    stage.prepare (config);
+
+    auto blockIndex = 0;
+
+    const auto runBlocks = [&] (int numBlocks)
+    {
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            const auto offset = (blockIndex % numNoiseBlocks) * blockSize;
+
+            for (int ch = 0; ch < config.numChannels; ++ch)
+                juce::FloatVectorOperations::copy (buffer.getWritePointer (ch), noise.getReadPointer (ch, offset), blockSize);
+
+            stage.process (buffer, blockIndex++);
+        }
+    };
+
+    const auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+    const auto secondsFor = [&] (int numBlocks)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        runBlocks (numBlocks);
+        return (double) (juce::Time::getHighResolutionTicks() - start) / ticksPerSecond;
+    };
+
+    // Warm up caches, branch predictors and the CPU clock, doubling the run
+    // length on the way so it ends up at roughly minSecondsPerRun.
+    auto blocksPerRun = 1;
+    auto warmedUp = 0.0;
+
+    for (;;)
+    {
+        const auto seconds = secondsFor (blocksPerRun);
+        warmedUp += seconds;
+
+        if (seconds >= settings.minSecondsPerRun)
+            break;
+
+        if (warmedUp >= settings.warmUpSeconds && seconds > 0.0)
+        {
+            blocksPerRun = juce::jmax (blocksPerRun, (int) std::ceil (blocksPerRun * settings.minSecondsPerRun / seconds));
+            break;
+        }
+
+        blocksPerRun *= 2;
+    }
+
+    std::vector<double> nsPerSample, cyclesPerSample;
+    const auto samplesPerRun = (double) blocksPerRun * blockSize;
+
+    for (int run = 0; run < juce::jmax (1, settings.numRuns); ++run)
+    {
+        const auto startCycles = readCycleCounter();
+        const auto seconds = secondsFor (blocksPerRun);
+        const auto cycles = readCycleCounter() - startCycles;
+
+        nsPerSample.push_back (seconds * 1.0e9 / samplesPerRun);
+        cyclesPerSample.push_back ((double) cycles / samplesPerRun);
+    }
+
+    auto analysis = stage.analyse (config);
+    stage.release();
+
+    Measurement result;
+    result.nsPerSample = median (nsPerSample);
+    result.nsPerSampleMin = *std::min_element (nsPerSample.begin(), nsPerSample.end());
+    result.nsPerSampleMax = *std::max_element (nsPerSample.begin(), nsPerSample.end());
+    result.cyclesPerSample = hasCycleCounter() ? median (cyclesPerSample) : -1.0;
+    result.samplesPerRun = (juce::int64) samplesPerRun;
+    result.analysis = std::move (analysis);
+    return result;
+}
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    Timing harness shared by the microbenchmarks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** How a stage's main parameter moves from one block to the next. */
+enum class Automation
+{
+    none,       // parked at its default, the case the smoothers skip
+    ramp,       // slow sweep, so ramps and coefficient updates run every block
+    jump        // a new random value every block
+};
+
+juce::String getAutomationName (Automation automation);
+
+/** The normalised [0, 1] parameter value for a block: restingValue while parked, moving otherwise. */
+float getAutomationValue (Automation automation, int blockIndex, float restingValue) noexcept;
+
+//==============================================================================
+struct BenchmarkConfig
+{
+    int blockSize = 512;
+    double sampleRate = 48000.0;
+    int numChannels = 2;
+    Automation automation = Automation::none;
+};
+
+/** One stage set up the way the plug-in drives it. prepare() is not timed; process() is. */
+class BenchmarkStage
+{
+public:
+    virtual ~BenchmarkStage() = default;
+
+    /** False skips the configuration, e.g. a SIMD kernel this CPU lacks. */
+    virtual bool supports (const BenchmarkConfig&) const     { return true; }
+
+    virtual void prepare (const BenchmarkConfig& config) = 0;
+
+    /** Processes the buffer in place; blockIndex counts blocks since prepare(), for automation. */
+    virtual void process (juce::AudioBuffer<float>& buffer, int blockIndex) = 0;
+
+    /** Figures other than speed, e.g. aliasing, reported next to the timings. Called
+        untimed on the prepared stage once the timed runs are over, before release().
+    */
+    virtual juce::NamedValueSet analyse (const BenchmarkConfig&)     { return {}; }
+
+    virtual void release() {}
+};
+
+struct BenchmarkCase
+{
+    juce::String name;
+    std::function<std::unique_ptr<BenchmarkStage>()> create;
+};
+
+//==============================================================================
+struct MeasurementSettings
+{
+    int numRuns = 7;
+    double minSecondsPerRun = 0.05;
+    double warmUpSeconds = 0.02;
+};
+
+struct Measurement
+{
+    double nsPerSample = 0.0;               // median over the runs, per sample frame
+    double nsPerSampleMin = 0.0, nsPerSampleMax = 0.0;
+    double cyclesPerSample = -1.0;          // median; negative where there's no cycle counter
+    juce::int64 samplesPerRun = 0;
+    juce::NamedValueSet analysis;           // whatever the stage's analyse() reported
+};
+
+/** True where cyclesPerSample can be measured (the x86 time-stamp counter, i.e. reference cycles). */
+bool hasCycleCounter() noexcept;
+
+/** Times the stage with fresh noise fed in front of every block. Filling
+    the block is included, so the "copy" case is the floor for every other one.
+*/
+Measurement measure (BenchmarkStage& stage, const BenchmarkConfig& config, const MeasurementSettings& settings);
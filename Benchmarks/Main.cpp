@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    Command-line entry point for the microbenchmarks.
+
+    Built as a console app against the same sources and JucePlugin_* settings
+    as the plug-in, like the batch renderer: the Benchmarks target in
+    CMakeLists.txt. Build it in release mode; timings from a debug build say
+    little about the shipped plug-in.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "StageBenchmarks.h"
+
+namespace
+{
+    const char* const usage =
+        "Times processBlock and each DSP stage; prints JSON.\n"
+        "\n"
+        "usage: Benchmarks [options]\n"
+        "\n"
+        "  --filter=<text,...>    only cases whose name contains one of these\n"
+        "  --blocks=<n,...>       block sizes (default 16,32,64,128,256,512,1024,2048,4096)\n"
+        "  --rates=<hz,...>       sample rates (default 48000)\n"
+        "  --channels=<n,...>     channel counts (default 2)\n"
+        "  --automation=<kind,...> static, ramp and/or jump (default static)\n"
+        "  --full                 rates 44100-192000, channels 1, 2, 6, 16 and every automation\n"
+        "  --runs=<n>             timed runs per configuration; the median is reported (default 7)\n"
+        "  --min-time=<ms>        minimum length of each run (default 50)\n"
+        "  --out=<file>           write the JSON here instead of stdout\n"
+        "  --list                 print the case names and exit\n";
+
+    template <typename Parse>
+    auto parseList (const juce::ArgumentList& args, const char* option, const juce::String& defaults, Parse parse)
+    {
+        const auto text = args.containsOption (option) ? args.getValueForOption (option) : defaults;
+        std::vector<decltype (parse (juce::String()))> values;
+
+        for (const auto& token : juce::StringArray::fromTokens (text, ",", {}))
+            if (token.trim().isNotEmpty())
+                values.push_back (parse (token.trim()));
+
+        return values;
+    }
+
+    Automation parseAutomation (const juce::String& name)
+    {
+        if (name == "ramp")     return Automation::ramp;
+        if (name == "jump")     return Automation::jump;
+        return Automation::none;
+    }
+
+    bool matchesFilter (const juce::String& name, const juce::StringArray& filters)
+    {
+        if (filters.isEmpty())
+            return true;
+
+        for (const auto& f : filters)
+            if (name.contains (f))
+                return true;
+
+        return false;
+    }
+
+    juce::var describeMachine()
+    {
+        auto* machine = new juce::DynamicObject();
+        machine->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        machine->setProperty ("cpuVendor", juce::SystemStats::getCpuVendor());
+        machine->setProperty ("cpuMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+        machine->setProperty ("cores", juce::SystemStats::getNumCpus());
+        machine->setProperty ("physicalCores", juce::SystemStats::getNumPhysicalCpus());
+        machine->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+        machine->setProperty ("avx", juce::SystemStats::hasAVX());
+        machine->setProperty ("avx2", juce::SystemStats::hasAVX2());
+        return machine;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor and its parameters expect a message manager to exist.
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        std::cout << usage;
+        return 0;
+    }
+
+    const auto cases = createBenchmarkCases();
+
+    if (args.containsOption ("--list"))
+    {
+        for (const auto& c : cases)
+            std::cout << c.name << std::endl;
+
+        return 0;
+    }
+
+    const auto full = args.containsOption ("--full");
+
+    const auto blockSizes  = parseList (args, "--blocks", "16,32,64,128,256,512,1024,2048,4096", [] (const juce::String& s) { return juce::jlimit (1, 65536, s.getIntValue()); });
+    const auto rates       = parseList (args, "--rates", full ? "44100,48000,88200,96000,176400,192000" : "48000", [] (const juce::String& s) { return s.getDoubleValue(); });
+    const auto channels    = parseList (args, "--channels", full ? "1,2,6,16" : "2", [] (const juce::String& s) { return juce::jlimit (1, 64, s.getIntValue()); });
+    const auto automations = parseList (args, "--automation", full ? "static,ramp,jump" : "static", parseAutomation);
+    const auto filters     = juce::StringArray::fromTokens (args.getValueForOption ("--filter"), ",", {});
+
+    MeasurementSettings settings;
+
+    if (args.containsOption ("--runs"))
+        settings.numRuns = juce::jmax (1, args.getValueForOption ("--runs").getIntValue());
+
+    if (args.containsOption ("--min-time"))
+        settings.minSecondsPerRun = juce::jmax (1, args.getValueForOption ("--min-time").getIntValue()) * 0.001;
+
+    //==============================================================================
+    juce::Array<juce::var> results;
+
+    for (const auto& benchmarkCase : cases)
+    {
+        if (! matchesFilter (benchmarkCase.name, filters))
+            continue;
+
+        for (auto automation : automations)
+        {
+            for (auto rate : rates)
+            {
+                for (auto numChannels : channels)
+                {
+                    for (auto blockSize : blockSizes)
+                    {
+                        BenchmarkConfig config;
+                        config.blockSize = blockSize;
+                        config.sampleRate = rate;
+                        config.numChannels = numChannels;
+                        config.automation = automation;
+
+                        auto stage = benchmarkCase.create();
+
+                        if (! stage->supports (config))
+                            continue;
+
+                        const auto m = measure (*stage, config, settings);
+
+                        // How many times faster than real time this stage alone runs.
+                        const auto realtimeFactor = m.nsPerSample > 0.0 ? 1.0e9 / (rate * m.nsPerSample) : 0.0;
+
+                        auto* entry = new juce::DynamicObject();
+                        entry->setProperty ("case", benchmarkCase.name);
+                        entry->setProperty ("blockSize", blockSize);
+                        entry->setProperty ("sampleRate", rate);
+                        entry->setProperty ("channels", numChannels);
+                        entry->setProperty ("automation", getAutomationName (automation));
+                        entry->setProperty ("nsPerSample", m.nsPerSample);
+                        entry->setProperty ("nsPerSampleMin", m.nsPerSampleMin);
+                        entry->setProperty ("nsPerSampleMax", m.nsPerSampleMax);
+                        entry->setProperty ("nsPerChannelSample", m.nsPerSample / numChannels);
+                        entry->setProperty ("cyclesPerSample", m.cyclesPerSample >= 0.0 ? juce::var (m.cyclesPerSample) : juce::var());
+                        entry->setProperty ("realtimeFactor", realtimeFactor);
+                        entry->setProperty ("samplesPerRun", m.samplesPerRun);
+
+                        juce::String extras;
+
+                        for (const auto& value : m.analysis)
+                        {
+                            entry->setProperty (value.name, value.value);
+                            extras << "  " << value.name.toString() << " " << juce::String ((double) value.value, 1);
+                        }
+
+                        results.add (entry);
+
+                        std::cerr << benchmarkCase.name << "  " << getAutomationName (automation) << "  " << rate << " Hz  "
+                                  << numChannels << " ch  " << blockSize << ": " << juce::String (m.nsPerSample, 3) << " ns/sample"
+                                  << extras << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("schema", 1);
+    report->setProperty ("plugin", JucePlugin_Name);
+    report->setProperty ("version", JucePlugin_VersionString);
+   #if JUCE_DEBUG
+    report->setProperty ("build", "debug");
+   #else
+    report->setProperty ("build", "release");
+   #endif
+    report->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+    report->setProperty ("machine", describeMachine());
+    report->setProperty ("cycleCounter", hasCycleCounter() ? "tsc" : "none");
+    report->setProperty ("runs", settings.numRuns);
+    report->setProperty ("results", results);
+
+    const auto json = juce::JSON::toString (juce::var (report));
+
+    if (args.containsOption ("--out"))
+    {
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--out").unquoted());
+
+        if (! file.replaceWithText (json))
+        {
+            std::cerr << "Can't write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,503 @@
+/*
+  ==============================================================================
+
+    The stages of the plug-in, wrapped for the benchmark harness.
+
+  ==============================================================================
+*/
+
+#include "StageBenchmarks.h"
+#include "../PluginProcessor.h"
+
+namespace
+{
+    float cutoffFor (float normalised) noexcept      { return 20.0f * std::pow (1000.0f, normalised); }     // 20 Hz to 20 kHz
+    float delayMsFor (float normalised) noexcept     { return 1.0f + 499.0f * normalised; }
+
+    juce::dsp::AudioBlock<float> getBlock (juce::AudioBuffer<float>& buffer)
+    {
+        return juce::dsp::AudioBlock<float> (buffer);
+    }
+
+    //==============================================================================
+    /** Nothing but the harness's input fill. */
+    class CopyBenchmark  : public BenchmarkStage
+    {
+    public:
+        void prepare (const BenchmarkConfig&) override {}
+        void process (juce::AudioBuffer<float>&, int) override {}
+    };
+
+    //==============================================================================
+    class PlaybackBenchmark  : public BenchmarkStage
+    {
+    public:
+        enum class Source
+        {
+            reader,         // decoding on the audio thread, as before streaming existed
+            mapped,         // memory-mapped PCM
+            streamed,       // the audio thread's side of the read-ahead buffer
+            resampled       // the polyphase resampler, which normally runs on the read-ahead thread
+        };
+
+        explicit PlaybackBenchmark (Source s)
+            : sourceType (s)
+        {
+            formatManager.registerBasicFormats();
+        }
+
+        void prepare (const BenchmarkConfig& config) override
+        {
+            // A resampled file is at the other common rate; the rest match the session.
+            const auto fileRate = sourceType != Source::resampled ? config.sampleRate
+                                                                  : (config.sampleRate == 44100.0 ? 48000.0 : 44100.0);
+
+            tempFile = std::make_unique<juce::TemporaryFile> (".wav");
+            writeNoiseFile (tempFile->getFile(), config.numChannels, fileRate);
+
+            thread.startThread (8);
+
+            if (sourceType == Source::mapped)
+            {
+                mappedSource = std::make_unique<MappedAudioFileSource> (MappedAudioFileSource::createReaderFor (formatManager, tempFile->getFile()),
+                                                                        thread);
+                source = mappedSource.get();
+            }
+            else
+            {
+                readerSource = std::make_unique<juce::AudioFormatReaderSource> (formatManager.createReaderFor (tempFile->getFile()), true);
+                source = readerSource.get();
+            }
+
+            if (sourceType == Source::streamed)
+            {
+                streamingSource = std::make_unique<StreamingAudioSource> (*readerSource, thread, config.numChannels, 2.0, fileRate);
+                source = streamingSource.get();
+            }
+            else if (sourceType == Source::resampled)
+            {
+                resamplingSource = std::make_unique<ResamplingPositionableSource> (*readerSource, fileRate, config.numChannels,
+                                                                                   PolyphaseResampler::Quality::normal);
+                source = resamplingSource.get();
+            }
+
+            source->setLooping (true);
+            source->prepareToPlay (config.blockSize, config.sampleRate);
+
+            // Let the read-ahead fill before timing, as the loader does before it hands a file over.
+            if (streamingSource != nullptr)
+                for (int waited = 0; waited < 2000 && streamingSource->getNumBufferedSamples() < streamingSource->getBufferSize() / 2; ++waited)
+                    juce::Thread::sleep (1);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int) override
+        {
+            source->getNextAudioBlock (juce::AudioSourceChannelInfo (buffer));
+        }
+
+        void release() override
+        {
+            source->releaseResources();
+            resamplingSource.reset();
+            streamingSource.reset();
+            readerSource.reset();
+            mappedSource.reset();
+            thread.stopThread (1000);
+            tempFile.reset();
+        }
+
+    private:
+        static void writeNoiseFile (const juce::File& file, int numChannels, double sampleRate)
+        {
+            constexpr double seconds = 2.0;
+            const auto length = (int) (seconds * sampleRate);
+
+            juce::AudioBuffer<float> noise (numChannels, length);
+            juce::Random random (1);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < length; ++i)
+                    noise.setSample (ch, i, random.nextFloat() - 0.5f);
+
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+            std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels, 24, {}, 0));
+
+            if (writer != nullptr)
+            {
+                stream.release();
+                writer->writeFromAudioSampleBuffer (noise, 0, length);
+            }
+        }
+
+        const Source sourceType;
+        juce::AudioFormatManager formatManager;
+        juce::TimeSliceThread thread { "Benchmark read-ahead" };
+        std::unique_ptr<juce::TemporaryFile> tempFile;
+
+        std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+        std::unique_ptr<MappedAudioFileSource> mappedSource;
+        std::unique_ptr<StreamingAudioSource> streamingSource;
+        std::unique_ptr<ResamplingPositionableSource> resamplingSource;
+        juce::PositionableAudioSource* source = nullptr;
+    };
+
+    //==============================================================================
+    /** The low-pass stage as EffectChain drives it: coefficients every updateInterval samples, then the biquad. */
+    class FilterBenchmark  : public BenchmarkStage
+    {
+    public:
+        explicit FilterBenchmark (MultiChannelBiquad::Kernel k)
+            : kernel (k)
+        {
+        }
+
+        bool supports (const BenchmarkConfig& config) const override
+        {
+            return MultiChannelBiquad::isKernelAvailable (kernel) && config.numChannels <= MultiChannelBiquad::maxChannels;
+        }
+
+        void prepare (const BenchmarkConfig& config) override
+        {
+            automation = config.automation;
+            filter.prepare (config.numChannels);
+            filter.setKernel (kernel);
+            coefficients.prepare (config.sampleRate);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int blockIndex) override
+        {
+            coefficients.setTarget (cutoffFor (getAutomationValue (automation, blockIndex, 0.5f)), 0.707f);
+
+            const auto numChannels = buffer.getNumChannels();
+            float* channels[MultiChannelBiquad::maxChannels];
+
+            for (int offset = 0; offset < buffer.getNumSamples(); offset += LowPassCoefficientEngine::updateInterval)
+            {
+                const auto numThisPiece = juce::jmin (LowPassCoefficientEngine::updateInterval, buffer.getNumSamples() - offset);
+
+                if (coefficients.advance (numThisPiece))
+                    filter.setCoefficients (coefficients.get());
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    channels[ch] = buffer.getWritePointer (ch, offset);
+
+                filter.process (channels, numChannels, numThisPiece);
+            }
+        }
+
+    private:
+        const MultiChannelBiquad::Kernel kernel;
+        Automation automation = Automation::none;
+        MultiChannelBiquad filter;
+        LowPassCoefficientEngine coefficients;
+    };
+
+    //==============================================================================
+    class DelayBenchmark  : public BenchmarkStage
+    {
+    public:
+        DelayBenchmark (DelayEngine::Interpolation i, bool shouldModulate)
+            : interpolation (i), modulated (shouldModulate)
+        {
+        }
+
+        void prepare (const BenchmarkConfig& config) override
+        {
+            automation = config.automation;
+            sampleRate = config.sampleRate;
+
+            delay.setDelayRampTime (0.05);
+            delay.prepare (config.sampleRate, config.blockSize, config.numChannels, (int) (config.sampleRate * 0.5) + 1);
+            delay.setInterpolation (interpolation);
+            delay.setFeedbackGain (0.5f);
+            delay.setModulation (modulated ? 0.5f : 0.0f, modulated ? (float) (sampleRate * 0.002) : 0.0f);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int blockIndex) override
+        {
+            delay.setDelay (delayMsFor (getAutomationValue (automation, blockIndex, 0.5f)) * (float) sampleRate * 0.001f);
+            delay.process (getBlock (buffer));
+        }
+
+    private:
+        const DelayEngine::Interpolation interpolation;
+        const bool modulated;
+        Automation automation = Automation::none;
+        double sampleRate = 48000.0;
+        DelayEngine delay;
+    };
+
+    //==============================================================================
+    class DistortionBenchmark  : public BenchmarkStage
+    {
+    public:
+        DistortionBenchmark (int t, DistortionStage::Antialiasing aa, int oversamplingOrder)
+            : type (t), antialiasing (aa), order (oversamplingOrder)
+        {
+        }
+
+        void prepare (const BenchmarkConfig& config) override
+        {
+            automation = config.automation;
+            distortion.setOversampling (order, DistortionStage::OversamplingFilter::polyphaseIIR);
+            distortion.setAntialiasing (antialiasing);
+            distortion.prepare (config.sampleRate, config.blockSize, config.numChannels);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int blockIndex) override
+        {
+            distortion.setParameters (type, getAutomationValue (automation, blockIndex, 0.5f), 1.0f);
+            distortion.process (getBlock (buffer));
+        }
+
+        juce::NamedValueSet analyse (const BenchmarkConfig& config) override
+        {
+            distortion.setParameters (type, 0.5f, 1.0f);
+
+            juce::NamedValueSet results;
+            results.set ("aliasDb", measureAliasDb (config));
+            return results;
+        }
+
+    private:
+        /** Power outside the harmonics of a full-scale 5 kHz sine, in dB relative to the sine.
+
+            The tone is put exactly on an odd bin of the DFT, so it and each harmonic below
+            Nyquist land on a bin of their own without leakage, and a harmonic folded back
+            from above Nyquist can never land on one of them. Everything else, DC aside,
+            is aliasing, or whatever the oversampling filters let through. One DFT length
+            runs first so the ADAA history and oversampling filters have settled, and the
+            tone is periodic in the DFT length, so no window is needed.
+        */
+        double measureAliasDb (const BenchmarkConfig& config)
+        {
+            constexpr int fftOrder = 14, fftSize = 1 << fftOrder;
+            const auto toneBin = juce::roundToInt (fftSize * 5000.0 / config.sampleRate) | 1;
+
+            juce::AudioBuffer<float> buffer (config.numChannels, config.blockSize);
+            std::vector<float> captured ((size_t) fftSize * 2);     // the transform works in place on 2N floats
+
+            distortion.reset();
+
+            for (int done = 0; done < 2 * fftSize; done += config.blockSize)
+            {
+                const auto numSamples = juce::jmin (config.blockSize, 2 * fftSize - done);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const auto phase = (double) (((juce::int64) (done + i) * toneBin) % fftSize) / fftSize;
+                    const auto sample = (float) std::sin (juce::MathConstants<double>::twoPi * phase);
+
+                    for (int ch = 0; ch < config.numChannels; ++ch)
+                        buffer.setSample (ch, i, sample);
+                }
+
+                distortion.process (getBlock (buffer).getSubBlock (0, (size_t) numSamples));
+
+                for (int i = 0; i < numSamples; ++i)
+                    if (done + i >= fftSize)
+                        captured[(size_t) (done + i - fftSize)] = buffer.getSample (0, i);
+            }
+
+            juce::dsp::FFT fft (fftOrder);
+            fft.performFrequencyOnlyForwardTransform (captured.data());
+
+            auto tonePower = 0.0, aliasPower = 0.0;
+
+            for (int bin = 1; bin < fftSize / 2; ++bin)
+            {
+                const auto power = (double) captured[(size_t) bin] * captured[(size_t) bin];
+
+                if (bin == toneBin)
+                    tonePower = power;
+                else if (bin % toneBin != 0)
+                    aliasPower += power;
+            }
+
+            return 10.0 * std::log10 (juce::jmax (aliasPower, 1.0e-30) / juce::jmax (tonePower, 1.0e-30));
+        }
+
+        const int type;
+        const DistortionStage::Antialiasing antialiasing;
+        const int order;
+        Automation automation = Automation::none;
+        DistortionStage distortion;
+    };
+
+    //==============================================================================
+    /** Gain, filter, delay and distortion as the processor sets them up each block. */
+    class ChainBenchmark  : public BenchmarkStage
+    {
+    public:
+        void prepare (const BenchmarkConfig& config) override
+        {
+            automation = config.automation;
+            sampleRate = config.sampleRate;
+            chain.prepare (config.sampleRate, config.blockSize, config.numChannels, (int) (config.sampleRate * 0.5) + 1);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int blockIndex) override
+        {
+            const auto value = getAutomationValue (automation, blockIndex, 0.5f);
+
+            chain.setFilter (cutoffFor (value), 0.707f);
+            chain.setGainDecibels (-6.0f);
+            chain.setDelayMix (0.3f);
+
+            chain.forEachDelay ([this] (DelayEngine& delay)
+            {
+                delay.setDelay (delayMsFor (0.5f) * (float) sampleRate * 0.001f);
+                delay.setFeedbackGain (0.5f);
+            });
+
+            chain.forEachDistortion ([value] (DistortionStage& distortion)
+            {
+                distortion.setParameters (DistortionStage::softClip, value, 1.0f);
+            });
+
+            auto block = getBlock (buffer);
+            chain.pushDrySamples (block);
+            chain.process (block);
+        }
+
+    private:
+        Automation automation = Automation::none;
+        double sampleRate = 48000.0;
+        EffectChain chain;
+    };
+
+    //==============================================================================
+    /** The whole plug-in, every stage switched on, automated through its parameters like a host would. */
+    class ProcessorBenchmark  : public BenchmarkStage
+    {
+    public:
+        explicit ProcessorBenchmark (bool shouldRunInParallel)
+            : parallel (shouldRunInParallel)
+        {
+        }
+
+        bool supports (const BenchmarkConfig& config) const override
+        {
+            return config.numChannels <= AudioProcessor2AudioProcessor::maxBusChannels
+                    && (! parallel || config.numChannels > ParallelEffectChain::channelsPerGroup);
+        }
+
+        void prepare (const BenchmarkConfig& config) override
+        {
+            automation = config.automation;
+            processor = std::make_unique<AudioProcessor2AudioProcessor>();
+            processor->setParallelProcessingEnabled (parallel);
+
+            const auto channelSet = juce::AudioChannelSet::canonicalChannelSet (config.numChannels);
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add (channelSet);
+            layout.outputBuses.add (channelSet);
+            processor->setBusesLayout (layout);
+
+            setParameter (ParamIDs::gain, -6.0f);
+            setParameter (ParamIDs::cutoff, 2000.0f);
+            setParameter (ParamIDs::resonance, 0.707f);
+            setParameter (ParamIDs::rate, 250.0f);
+            setParameter (ParamIDs::feedback, -6.0f);
+            setParameter (ParamIDs::mix, 0.3f);
+            setParameter (ParamIDs::distType, (float) DistortionStage::softClip);
+            setParameter (ParamIDs::threshold, 0.5f);
+            setParameter (ParamIDs::distMix, 1.0f);
+
+            cutoff = processor->apvts.getParameter (ParamIDs::cutoff);
+            threshold = processor->apvts.getParameter (ParamIDs::threshold);
+
+            processor->setRateAndBufferSizeDetails (config.sampleRate, config.blockSize);
+            processor->prepareToPlay (config.sampleRate, config.blockSize);
+        }
+
+        void process (juce::AudioBuffer<float>& buffer, int blockIndex) override
+        {
+            if (automation != Automation::none)
+            {
+                const auto value = getAutomationValue (automation, blockIndex, 0.5f);
+                cutoff->setValueNotifyingHost (value);
+                threshold->setValueNotifyingHost (value);
+            }
+
+            processor->processBlock (buffer, midi);
+        }
+
+        void release() override
+        {
+            processor->releaseResources();
+            processor.reset();
+        }
+
+    private:
+        void setParameter (const char* id, float value)
+        {
+            if (auto* parameter = processor->apvts.getParameter (id))
+                parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+        }
+
+        const bool parallel;
+        Automation automation = Automation::none;
+        std::unique_ptr<AudioProcessor2AudioProcessor> processor;
+        juce::RangedAudioParameter* cutoff = nullptr;
+        juce::RangedAudioParameter* threshold = nullptr;
+        juce::MidiBuffer midi;
+    };
+
+    //==============================================================================
+    template <typename StageType, typename... Args>
+    BenchmarkCase makeCase (const juce::String& name, Args... args)
+    {
+        return { name, [=] { return std::unique_ptr<BenchmarkStage> (new StageType (args...)); } };
+    }
+}
+
+//==============================================================================
+std::vector<BenchmarkCase> createBenchmarkCases()
+{
+    using Kernel = MultiChannelBiquad::Kernel;
+    using Interpolation = DelayEngine::Interpolation;
+    using Antialiasing = DistortionStage::Antialiasing;
+    using Source = PlaybackBenchmark::Source;
+
+    std::vector<BenchmarkCase> cases;
+
+    cases.push_back (makeCase<CopyBenchmark> ("copy"));
+
+    cases.push_back (makeCase<PlaybackBenchmark> ("playback/reader", Source::reader));
+    cases.push_back (makeCase<PlaybackBenchmark> ("playback/mapped", Source::mapped));
+    cases.push_back (makeCase<PlaybackBenchmark> ("playback/streamed", Source::streamed));
+    cases.push_back (makeCase<PlaybackBenchmark> ("playback/resampled", Source::resampled));
+
+    cases.push_back (makeCase<FilterBenchmark> ("filter/scalar", Kernel::scalar));
+    cases.push_back (makeCase<FilterBenchmark> ("filter/sse", Kernel::sse));
+    cases.push_back (makeCase<FilterBenchmark> ("filter/avx", Kernel::avx));
+    cases.push_back (makeCase<FilterBenchmark> ("filter/neon", Kernel::neon));
+
+    cases.push_back (makeCase<DelayBenchmark> ("delay/linear", Interpolation::linear, false));
+    cases.push_back (makeCase<DelayBenchmark> ("delay/lagrange", Interpolation::lagrange3, false));
+    cases.push_back (makeCase<DelayBenchmark> ("delay/thiran", Interpolation::thiran, false));
+    cases.push_back (makeCase<DelayBenchmark> ("delay/linear-modulated", Interpolation::linear, true));
+
+    static const char* const typeNames[] = { "hardClip", "softClip", "halfWave", "tanh", "cubic", "asymmetric", "foldback" };
+    static_assert (juce::numElementsInArray (typeNames) == DistortionStage::numTypes, "one name per distortion type");
+
+    for (int type = 0; type < DistortionStage::numTypes; ++type)
+    {
+        const auto name = "distortion/" + juce::String (typeNames[type]);
+        cases.push_back (makeCase<DistortionBenchmark> (name, type, Antialiasing::off, 0));
+        cases.push_back (makeCase<DistortionBenchmark> (name + "/adaa1", type, Antialiasing::firstOrder, 0));
+        cases.push_back (makeCase<DistortionBenchmark> (name + "/adaa2", type, Antialiasing::secondOrder, 0));
+    }
+
+    for (int order = 1; order <= DistortionStage::maxOversamplingOrder; ++order)
+        cases.push_back (makeCase<DistortionBenchmark> ("distortion/hardClip/os" + juce::String (1 << order) + "x",
+                                                        (int) DistortionStage::hardClip, Antialiasing::off, order));
+
+    cases.push_back (makeCase<ChainBenchmark> ("chain"));
+    cases.push_back (makeCase<ProcessorBenchmark> ("processBlock", false));
+    cases.push_back (makeCase<ProcessorBenchmark> ("processBlock/parallel", true));
+
+    return cases;
+}
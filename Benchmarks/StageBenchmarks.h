@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+
+    The stages of the plug-in, wrapped for the benchmark harness.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Benchmark.h"
+
+/** Every benchmark, in the order they're run:
+    - copy: the harness's own input fill, the floor under every other figure.
+    - playback/...: file playback through each source the loader can build.
+    - filter/...: the low-pass stage with each SIMD kernel the CPU supports.
+    - delay/...: each interpolation, plus a modulated one.
+    - distortion/...: every mode plain and with each ADAA order, plus hard clip at each oversampling factor.
+      Each also reports aliasDb, the power a 5 kHz tone aliases into, relative to the tone.
+    - chain: the fused EffectChain in its default layout.
+    - processBlock and processBlock/parallel: the whole plug-in, with channel groups run serially or on the worker pool.
+*/
+std::vector<BenchmarkCase> createBenchmarkCases();
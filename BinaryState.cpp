@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    Compact, versioned encoding of the plugin state.
+
+  ==============================================================================
+*/
+
+#include "BinaryState.h"
+
+constexpr juce::uint32 BinaryState::magic;
+constexpr juce::uint32 BinaryState::currentVersion;
+
+bool BinaryState::isBinaryState (const void* data, size_t size) noexcept
+{
+    return data != nullptr && size >= 8
+            && juce::ByteOrder::littleEndianInt (data) == magic;
+}
+
+void BinaryState::writeHeader (juce::OutputStream& out)
+{
+    out.writeInt ((int) magic);
+    out.writeInt ((int) currentVersion);
+}
+
+void BinaryState::writeChunk (juce::OutputStream& out, juce::uint32 tag, const juce::MemoryBlock& payload)
+{
+    out.writeInt ((int) tag);
+    out.writeInt ((int) payload.getSize());
+    out.write (payload.getData(), payload.getSize());
+}
+
+//==============================================================================
+BinaryState::Writer::Writer (juce::MemoryBlock& destination)
+    : out (destination, false)
+{
+    writeHeader (out);
+}
+
+juce::OutputStream& BinaryState::Writer::beginChunk (juce::uint32 tag)
+{
+    jassert (sizePosition < 0);     // chunks don't nest
+
+    out.writeInt ((int) tag);
+    sizePosition = out.getPosition();
+    out.writeInt (0);               // patched by endChunk()
+    return out;
+}
+
+void BinaryState::Writer::endChunk()
+{
+    jassert (sizePosition >= 0);
+
+    const auto end = out.getPosition();
+    out.setPosition (sizePosition);
+    out.writeInt ((int) (end - sizePosition - 4));
+    out.setPosition (end);
+    sizePosition = -1;
+}
+
+//==============================================================================
+BinaryState::Reader::Reader (const void* d, size_t s) noexcept
+    : data (static_cast<const char*> (d)), size (s)
+{
+    if (isBinaryState (data, size))
+    {
+        version = juce::ByteOrder::littleEndianInt (data + 4);
+        valid = version <= currentVersion;
+        position = 8;
+    }
+}
+
+bool BinaryState::Reader::next() noexcept
+{
+    if (! valid || size - position < 8)
+        return false;
+
+    const auto nextSize = (size_t) juce::ByteOrder::littleEndianInt (data + position + 4);
+
+    if (nextSize > size - position - 8)
+        return false;
+
+    tag = juce::ByteOrder::littleEndianInt (data + position);
+    chunkSize = nextSize;
+    chunkData = data + position + 8;
+    position += 8 + chunkSize;
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    Compact, versioned encoding of the plugin state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The plugin state is a short header followed by tagged chunks:
+
+        header:  uint32 magic, uint32 format version
+        chunk:   uint32 tag, uint32 payload size, payload
+
+    All integers are little-endian. A reader skips chunks whose tag it doesn't
+    know. Within a chunk it reads the fields it knows and ignores whatever
+    follows. So a newer build can add chunks, or fields at the end of a chunk,
+    and older builds still load the rest. The version is bumped only when an
+    existing field changes meaning, and a reader refuses any state newer than
+    it understands.
+
+    Reading never copies the data or parses text; each chunk is read in place
+    through a MemoryInputStream.
+*/
+struct BinaryState
+{
+    static constexpr juce::uint32 magic = 0x53325041;      // "AP2S"
+    static constexpr juce::uint32 currentVersion = 1;
+
+    /** Builds a tag from four characters, e.g. makeTag ('p', 'a', 'r', 'm'). */
+    static constexpr juce::uint32 makeTag (char a, char b, char c, char d) noexcept
+    {
+        return (juce::uint32) (juce::uint8) a
+             | ((juce::uint32) (juce::uint8) b << 8)
+             | ((juce::uint32) (juce::uint8) c << 16)
+             | ((juce::uint32) (juce::uint8) d << 24);
+    }
+
+    /** True if the data starts like something a Writer produced. */
+    static bool isBinaryState (const void* data, size_t size) noexcept;
+
+    /** Writes just the header, for a file that chunks are then appended to. */
+    static void writeHeader (juce::OutputStream& out);
+
+    /** Writes one complete chunk, for appending to an existing state. */
+    static void writeChunk (juce::OutputStream& out, juce::uint32 tag, const juce::MemoryBlock& payload);
+
+    //==============================================================================
+    /** Replaces the block's contents with a header, then one chunk per
+        beginChunk()/endChunk() pair. The block is only trimmed to size once
+        the writer has gone out of scope.
+    */
+    class Writer
+    {
+    public:
+        explicit Writer (juce::MemoryBlock& destination);
+
+        /** Returns the stream to write this chunk's payload to. */
+        juce::OutputStream& beginChunk (juce::uint32 tag);
+        void endChunk();
+
+    private:
+        juce::MemoryOutputStream out;
+        juce::int64 sizePosition = -1;
+
+        JUCE_DECLARE_NON_COPYABLE (Writer)
+    };
+
+    //==============================================================================
+    /** Steps through the chunks of a state without copying it. */
+    class Reader
+    {
+    public:
+        Reader (const void* data, size_t size) noexcept;
+
+        /** False if the header is missing or the state is newer than this build understands. */
+        bool isValid() const noexcept                   { return valid; }
+        juce::uint32 getVersion() const noexcept        { return version; }
+
+        /** Moves to the next chunk. False at the end, or at a chunk cut short. */
+        bool next() noexcept;
+
+        /** The end of the last complete chunk read. */
+        size_t getPosition() const noexcept             { return position; }
+
+        juce::uint32 getTag() const noexcept            { return tag; }
+        const void* getChunkData() const noexcept       { return chunkData; }
+        size_t getChunkSize() const noexcept            { return chunkSize; }
+
+    private:
+        const char* const data;
+        const size_t size;
+        size_t position = 0;
+
+        bool valid = false;
+        juce::uint32 version = 0, tag = 0;
+        const void* chunkData = nullptr;
+        size_t chunkSize = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+};
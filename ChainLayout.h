@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    Order, bypass and duplication of the modules in the effect chain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Which module sits in each slot of the effect chain, and whether it's
+    bypassed. Slots are processed front to back; empty slots are skipped.
+
+    A module may appear up to maxInstancesPerModule times. Each copy has its
+    own state (filter memory, delay line, oversamplers) but follows the same
+    parameters, so two filters make a steeper slope and two distortions
+    clip twice.
+
+    pack() squeezes a layout into one 32-bit word so it can be handed to the
+    audio thread through an atomic. toString() is the form kept in the plugin
+    state, e.g. "filter,delay:bypassed,distortion".
+*/
+struct ChainLayout
+{
+    enum class Module
+    {
+        none,
+        filter,
+        delay,
+        distortion
+    };
+
+    struct Slot
+    {
+        Module module = Module::none;
+        bool bypassed = false;
+    };
+
+    static constexpr int maxSlots = 6;
+    static constexpr int maxInstancesPerModule = 2;
+
+    /** Name of the property the layout is stored under in the plugin state. */
+    static constexpr auto propertyID = "chainLayout";
+
+    std::array<Slot, maxSlots> slots;
+
+    /** The original fixed order: filter, delay, distortion. */
+    static ChainLayout getDefault() noexcept
+    {
+        ChainLayout layout;
+        layout.add (Module::filter);
+        layout.add (Module::delay);
+        layout.add (Module::distortion);
+        return layout;
+    }
+
+    int count (Module module) const noexcept
+    {
+        return (int) std::count_if (slots.begin(), slots.end(), [module] (const Slot& s) { return s.module == module; });
+    }
+
+    /** Appends a module to the first free slot. Returns false if the chain is
+        full or that module already appears maxInstancesPerModule times.
+    */
+    bool add (Module module, bool bypassed = false) noexcept
+    {
+        if (module == Module::none || count (module) >= maxInstancesPerModule)
+            return false;
+
+        for (auto& slot : slots)
+        {
+            if (slot.module == Module::none)
+            {
+                slot = { module, bypassed };
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //==============================================================================
+    juce::uint32 pack() const noexcept
+    {
+        juce::uint32 packed = 0;
+
+        for (int i = 0; i < maxSlots; ++i)
+        {
+            const auto& slot = slots[(size_t) i];
+            packed |= (juce::uint32) (((int) slot.module) | (slot.bypassed ? 4 : 0)) << (i * 3);
+        }
+
+        return packed;
+    }
+
+    static ChainLayout unpack (juce::uint32 packed) noexcept
+    {
+        ChainLayout layout;
+
+        for (int i = 0; i < maxSlots; ++i)
+        {
+            const auto bits = (packed >> (i * 3)) & 7u;
+            layout.add ((Module) (bits & 3u), (bits & 4u) != 0);
+        }
+
+        return layout;
+    }
+
+    //==============================================================================
+    juce::String toString() const
+    {
+        juce::StringArray tokens;
+
+        for (const auto& slot : slots)
+            if (slot.module != Module::none)
+                tokens.add (juce::String (getName (slot.module)) + (slot.bypassed ? ":bypassed" : ""));
+
+        // Written out so that an empty chain doesn't read back as "no layout saved".
+        return tokens.isEmpty() ? "none" : tokens.joinIntoString (",");
+    }
+
+    /** Unknown names and anything past the limits are dropped. An empty string gives the default layout. */
+    static ChainLayout fromString (const juce::String& text)
+    {
+        if (text.trim().isEmpty())
+            return getDefault();
+
+        ChainLayout layout;
+
+        for (const auto& token : juce::StringArray::fromTokens (text, ",", {}))
+        {
+            const auto name = token.upToFirstOccurrenceOf (":", false, false).trim();
+            const auto bypassed = token.fromFirstOccurrenceOf (":", false, false).trim() == "bypassed";
+
+            for (auto module : { Module::filter, Module::delay, Module::distortion })
+                if (name == getName (module))
+                    layout.add (module, bypassed);
+        }
+
+        return layout;
+    }
+
+    static const char* getName (Module module) noexcept
+    {
+        switch (module)
+        {
+            case Module::filter:        return "filter";
+            case Module::delay:         return "delay";
+            case Module::distortion:    return "distortion";
+            case Module::none:
+            default:                    return "";
+        }
+    }
+
+    bool operator== (const ChainLayout& other) const noexcept     { return pack() == other.pack(); }
+    bool operator!= (const ChainLayout& other) const noexcept     { return pack() != other.pack(); }
+};
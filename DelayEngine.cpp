@@ -0,0 +1,401 @@
+/*
+  ==============================================================================
+
+    Block-based circular-buffer feedback delay.
+
+  ==============================================================================
+*/
+
+#include "DelayEngine.h"
+
+//==============================================================================
+void DelayEngine::prepare (double newSampleRate, int maximumBlockSize, int numChannels, int maximumDelayInSamples,
+                           bool allocateLineNow)
+{
+    sampleRate = newSampleRate;
+    maxBlockSize = juce::jmax (1, maximumBlockSize);
+    numPreparedChannels = juce::jmax (1, numChannels);
+    maxDelay = juce::jmax (1, maximumDelayInSamples);
+
+    // The oldest tap read is delay + maxExtraTaps samples back.
+    ringSize = maxDelay + maxExtraTaps + 1;
+    ring.setSize (numPreparedChannels, allocateLineNow ? ringSize : 0);
+
+    lastFeedback.assign ((size_t) numPreparedChannels, 0.0f);
+    allpassStates.assign ((size_t) numPreparedChannels, 0.0f);
+    delays.assign ((size_t) maxBlockSize, 0.0f);
+    gains.assign ((size_t) maxBlockSize, 0.0f);
+
+    delayTime.reset (sampleRate, delayRampSeconds);
+    feedbackGain.reset (sampleRate, 0.05);
+    modDepth.reset (sampleRate, 0.05);
+
+    reset();
+}
+
+void DelayEngine::reset() noexcept
+{
+    // The line is cleared lazily, as far back as each chunk reads; see clearBehind().
+    writePos = 0;
+    clearedReach = 0;
+    std::fill (lastFeedback.begin(), lastFeedback.end(), 0.0f);
+    std::fill (allpassStates.begin(), allpassStates.end(), 0.0f);
+
+    delayTime.setCurrentAndTargetValue (delayTime.getTargetValue());
+    feedbackGain.setCurrentAndTargetValue (feedbackGain.getTargetValue());
+    modDepth.setCurrentAndTargetValue (modDepth.getTargetValue());
+
+    lfoSin = 0.0f;
+    lfoCos = 1.0f;
+}
+
+void DelayEngine::allocateLine()
+{
+    if (hasLine() || ringSize == 0)
+        return;
+
+    // Nothing is read until it has been cleared, so the new memory can stay as it is.
+    ring.setSize (numPreparedChannels, ringSize);
+}
+
+void DelayEngine::setDelay (float newDelayInSamples) noexcept
+{
+    delayTime.setTargetValue (juce::jlimit (0.0f, (float) maxDelay, newDelayInSamples));
+}
+
+void DelayEngine::setDelayRampTime (double seconds) noexcept
+{
+    delayRampSeconds = juce::jmax (0.0, seconds);
+    delayTime.reset (sampleRate, delayRampSeconds);
+}
+
+void DelayEngine::setFeedbackGain (float newGain) noexcept
+{
+    feedbackGain.setTargetValue (newGain);
+}
+
+void DelayEngine::setInterpolation (Interpolation newInterpolation) noexcept
+{
+    interpolation = newInterpolation;
+}
+
+void DelayEngine::setModulation (float rateHz, float depthInSamples) noexcept
+{
+    const auto step = juce::MathConstants<double>::twoPi * juce::jmax (0.0f, rateHz) / sampleRate;
+    lfoStepSin = (float) std::sin (step);
+    lfoStepCos = (float) std::cos (step);
+
+    modDepth.setTargetValue (juce::jlimit (0.0f, (float) maxDelay, depthInSamples));
+}
+
+//==============================================================================
+void DelayEngine::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert (hasLine());
+
+    const auto numSamples = (int) block.getNumSamples();
+
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+        processChunk (block.getSubBlock ((size_t) start, (size_t) juce::jmin (maxBlockSize, numSamples - start)));
+}
+
+void DelayEngine::processChunk (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+    const auto numChannels = juce::jmin ((int) block.getNumChannels(), numPreparedChannels);
+
+    // Ramps are worked out once per chunk and shared, so every channel follows the same curve.
+    const auto modulating = modDepth.isSmoothing() || modDepth.getTargetValue() > 0.0f;
+    const auto delayMoving = modulating || delayTime.isSmoothing();
+    const auto gainMoving = feedbackGain.isSmoothing();
+
+    if (delayMoving)
+        for (int i = 0; i < numSamples; ++i)
+            delays[(size_t) i] = delayTime.getNextValue();
+
+    if (modulating)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            delays[(size_t) i] = juce::jlimit (0.0f, (float) maxDelay, delays[(size_t) i] + modDepth.getNextValue() * lfoSin);
+
+            const auto nextSin = lfoSin * lfoStepCos + lfoCos * lfoStepSin;
+            lfoCos = lfoCos * lfoStepCos - lfoSin * lfoStepSin;
+            lfoSin = nextSin;
+        }
+
+        const auto norm = 1.0f / std::sqrt (lfoSin * lfoSin + lfoCos * lfoCos);
+        lfoSin *= norm;
+        lfoCos *= norm;
+    }
+
+    if (gainMoving)
+        for (int i = 0; i < numSamples; ++i)
+            gains[(size_t) i] = feedbackGain.getNextValue();
+
+    // The furthest back any sample in this chunk reads; anything stale up to there is cleared first.
+    const auto longestDelay = delayMoving ? juce::FloatVectorOperations::findMaximum (delays.data(), numSamples)
+                                          : delayTime.getCurrentValue();
+    const auto reach = juce::jmin (ringSize, (int) std::ceil (longestDelay) + maxExtraTaps + 1);
+
+    if (reach > clearedReach)
+        clearBehind (reach);
+
+    // Lagrange and Thiran read one sample closer than the integer delay, so they need a longer minimum.
+    const auto minimumSpanDelay = interpolation == Interpolation::linear ? 1.0f : 2.0f;
+    const auto useSpans = ! delayMoving && delayTime.getCurrentValue() >= minimumSpanDelay;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* samples = block.getChannelPointer ((size_t) ch);
+
+        if (useSpans)
+            processSpans (ch, samples, numSamples, gainMoving);
+        else if (interpolation == Interpolation::lagrange3)
+            processPerSample<Interpolation::lagrange3> (ch, samples, numSamples, delayMoving, gainMoving);
+        else if (interpolation == Interpolation::thiran)
+            processPerSample<Interpolation::thiran> (ch, samples, numSamples, delayMoving, gainMoving);
+        else
+            processPerSample<Interpolation::linear> (ch, samples, numSamples, delayMoving, gainMoving);
+    }
+
+    writePos = (writePos + numSamples) % ringSize;
+    clearedReach = juce::jmin (ringSize, clearedReach + numSamples);
+}
+
+void DelayEngine::clearBehind (int reach) noexcept
+{
+    // From reach samples behind writePos up to where the written or cleared part begins.
+    auto start = writePos - reach;
+    if (start < 0) start += ringSize;
+
+    const auto numSamples = reach - clearedReach;
+    const auto first = juce::jmin (numSamples, ringSize - start);
+
+    for (int ch = 0; ch < ring.getNumChannels(); ++ch)
+    {
+        auto* data = ring.getWritePointer (ch);
+        juce::FloatVectorOperations::clear (data + start, first);
+
+        if (first < numSamples)
+            juce::FloatVectorOperations::clear (data, numSamples - first);
+    }
+
+    clearedReach = reach;
+}
+
+//==============================================================================
+void DelayEngine::processSpans (int channel, float* samples, int numSamples, bool gainMoving) noexcept
+{
+    const auto delay = delayTime.getCurrentValue();
+    auto delayInt = (int) delay;
+    auto delayFrac = delay - (float) delayInt;
+
+    // Same re-centring of the fractional part as DelayLine does for these interpolators.
+    if (interpolation == Interpolation::lagrange3 && delayInt >= 1)
+    {
+        delayFrac++;
+        delayInt--;
+    }
+    else if (interpolation == Interpolation::thiran && delayFrac < 0.618f && delayInt >= 1)
+    {
+        delayFrac++;
+        delayInt--;
+    }
+
+    const auto numTaps = interpolation == Interpolation::lagrange3 ? 4 : 2;
+    const auto steadyGain = feedbackGain.getCurrentValue();
+
+    auto* data = ring.getWritePointer (channel);
+    auto fed = lastFeedback[(size_t) channel];
+    auto& allpassState = allpassStates[(size_t) channel];
+    auto pos = writePos;
+
+    for (int done = 0; done < numSamples;)
+    {
+        // No longer than the delay, so every tap read here was written before this span.
+        const auto num = juce::jmin (numSamples - done, delayInt, spanSize);
+
+        // Tap k (k samples further back than the integer delay) for output i is spanTaps[i + numTaps - 1 - k].
+        readRing (data, pos - delayInt - (numTaps - 1), spanTaps, num + numTaps - 1);
+
+        const float* y = spanOut;
+
+        if (interpolation == Interpolation::lagrange3)
+        {
+            const auto d1 = delayFrac - 1.0f;
+            const auto d2 = delayFrac - 2.0f;
+            const auto d3 = delayFrac - 3.0f;
+
+            const auto c1 = -d1 * d2 * d3 / 6.0f;
+            const auto c2 = d2 * d3 * 0.5f;
+            const auto c3 = -d1 * d3 * 0.5f;
+            const auto c4 = d1 * d2 / 6.0f;
+
+            juce::FloatVectorOperations::copyWithMultiply (spanTemp, spanTaps + 2, c2, num);
+            juce::FloatVectorOperations::addWithMultiply (spanTemp, spanTaps + 1, c3, num);
+            juce::FloatVectorOperations::addWithMultiply (spanTemp, spanTaps, c4, num);
+            juce::FloatVectorOperations::multiply (spanTemp, delayFrac, num);
+            juce::FloatVectorOperations::copyWithMultiply (spanOut, spanTaps + 3, c1, num);
+            juce::FloatVectorOperations::add (spanOut, spanTemp, num);
+        }
+        else if (delayFrac == 0.0f)
+        {
+            y = spanTaps + 1;
+        }
+        else if (interpolation == Interpolation::thiran)
+        {
+            // The allpass is recursive in its output, so this part stays scalar.
+            const auto alpha = (1.0f - delayFrac) / (1.0f + delayFrac);
+
+            for (int i = 0; i < num; ++i)
+            {
+                spanOut[i] = spanTaps[i] + alpha * (spanTaps[i + 1] - allpassState);
+                allpassState = spanOut[i];
+            }
+        }
+        else
+        {
+            // Same arithmetic as DelayLine's linear interpolator: a + frac * (b - a).
+            juce::FloatVectorOperations::subtract (spanTemp, spanTaps, spanTaps + 1, num);
+            juce::FloatVectorOperations::multiply (spanTemp, delayFrac, num);
+            juce::FloatVectorOperations::add (spanOut, spanTaps + 1, spanTemp, num);
+        }
+
+        if (interpolation == Interpolation::thiran && delayFrac == 0.0f)
+            allpassState = y[num - 1];
+
+        // What goes in is the dry input minus the previous output scaled by feedback.
+        juce::FloatVectorOperations::copy (spanIn, samples + done, num);
+        spanIn[0] -= fed;
+
+        if (gainMoving)
+        {
+            juce::FloatVectorOperations::multiply (spanTemp, y, gains.data() + done, num);
+            juce::FloatVectorOperations::subtract (spanIn + 1, spanTemp, num - 1);
+            fed = spanTemp[num - 1];
+        }
+        else
+        {
+            juce::FloatVectorOperations::addWithMultiply (spanIn + 1, y, -steadyGain, num - 1);
+            fed = y[num - 1] * steadyGain;
+        }
+
+        writeRing (data, pos, spanIn, num);
+        juce::FloatVectorOperations::copy (samples + done, y, num);
+
+        pos = (pos + num) % ringSize;
+        done += num;
+    }
+
+    lastFeedback[(size_t) channel] = fed;
+}
+
+template <DelayEngine::Interpolation type>
+void DelayEngine::processPerSample (int channel, float* samples, int numSamples, bool delayMoving, bool gainMoving) noexcept
+{
+    const auto steadyDelay = delayTime.getCurrentValue();
+    const auto steadyGain = feedbackGain.getCurrentValue();
+
+    auto* data = ring.getWritePointer (channel);
+    auto fed = lastFeedback[(size_t) channel];
+    auto allpassState = allpassStates[(size_t) channel];
+    auto pos = writePos;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        data[pos] = samples[i] - fed;
+
+        const auto out = readInterpolated<type> (data, pos, delayMoving ? delays[(size_t) i] : steadyDelay, allpassState);
+
+        fed = out * (gainMoving ? gains[(size_t) i] : steadyGain);
+        samples[i] = out;
+
+        if (++pos == ringSize)
+            pos = 0;
+    }
+
+    lastFeedback[(size_t) channel] = fed;
+    allpassStates[(size_t) channel] = allpassState;
+}
+
+template <DelayEngine::Interpolation type>
+float DelayEngine::readInterpolated (const float* data, int pos, float delay, float& allpassState) const noexcept
+{
+    auto delayInt = (int) delay;
+    auto delayFrac = delay - (float) delayInt;
+
+    const auto tap = [&] (int k)
+    {
+        const auto index = pos - delayInt - k;
+        return data[index < 0 ? index + ringSize : index];
+    };
+
+    if (type == Interpolation::lagrange3)
+    {
+        if (delayInt >= 1)
+        {
+            delayFrac++;
+            delayInt--;
+        }
+
+        const auto value1 = tap (0);
+        const auto value2 = tap (1);
+        const auto value3 = tap (2);
+        const auto value4 = tap (3);
+
+        const auto d1 = delayFrac - 1.0f;
+        const auto d2 = delayFrac - 2.0f;
+        const auto d3 = delayFrac - 3.0f;
+
+        const auto c1 = -d1 * d2 * d3 / 6.0f;
+        const auto c2 = d2 * d3 * 0.5f;
+        const auto c3 = -d1 * d3 * 0.5f;
+        const auto c4 = d1 * d2 / 6.0f;
+
+        return value1 * c1 + delayFrac * (value2 * c2 + value3 * c3 + value4 * c4);
+    }
+
+    if (type == Interpolation::thiran)
+    {
+        if (delayFrac < 0.618f && delayInt >= 1)
+        {
+            delayFrac++;
+            delayInt--;
+        }
+
+        const auto alpha = (1.0f - delayFrac) / (1.0f + delayFrac);
+        const auto value1 = tap (0);
+        const auto value2 = tap (1);
+
+        const auto output = delayFrac == 0.0f ? value1 : value2 + alpha * (value1 - allpassState);
+        allpassState = output;
+        return output;
+    }
+
+    const auto value1 = tap (0);
+    const auto value2 = tap (1);
+    return value1 + delayFrac * (value2 - value1);
+}
+
+//==============================================================================
+void DelayEngine::readRing (const float* data, int start, float* dest, int numSamples) const noexcept
+{
+    start %= ringSize;
+    if (start < 0) start += ringSize;
+
+    const auto first = juce::jmin (numSamples, ringSize - start);
+    juce::FloatVectorOperations::copy (dest, data + start, first);
+
+    if (first < numSamples)
+        juce::FloatVectorOperations::copy (dest + first, data, numSamples - first);
+}
+
+void DelayEngine::writeRing (float* data, int start, const float* src, int numSamples) const noexcept
+{
+    const auto first = juce::jmin (numSamples, ringSize - start);
+    juce::FloatVectorOperations::copy (data + start, src, first);
+
+    if (first < numSamples)
+        juce::FloatVectorOperations::copy (data, src + first, numSamples - first);
+}
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    Block-based circular-buffer feedback delay.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Feedback delay with the same signal flow as the original per-sample
+    DelayLine loop (input minus the previous output times feedback), and the
+    same interpolators as juce::dsp::DelayLine, processed in spans.
+
+    While the delay time is steady, each channel is handled in contiguous runs
+    of its ring buffer no longer than the delay itself, so every read refers to
+    audio written before the run starts. Runs are split only where the ring
+    wraps, and the interpolation and feedback are done with FloatVectorOperations.
+    Only while the delay time is ramping or modulated (or under one sample)
+    does it fall back to a per-sample loop, specialised per interpolator.
+
+    reset() doesn't wipe the line. Each chunk first clears whatever part of it
+    the chunk could read that hasn't been written or cleared since, so a reset
+    on the audio thread costs the current delay time's worth of samples, and a
+    longer delay clears the rest as it ramps out into it.
+*/
+class DelayEngine
+{
+public:
+    enum class Interpolation
+    {
+        linear,
+        lagrange3,
+        thiran
+    };
+
+    /** With allocateLineNow false, the delay line itself is left out until allocateLine(), so an
+        instance that may never run doesn't hold maximumDelayInSamples per channel.
+    */
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels, int maximumDelayInSamples,
+                  bool allocateLineNow = true);
+    void reset() noexcept;
+
+    /** Allocates the delay line if prepare() left it out. Not real-time safe, but it only touches the
+        line, so it may run while the audio thread calls the setters, as long as process() isn't called
+        until it returns.
+    */
+    void allocateLine();
+    bool hasLine() const noexcept       { return ring.getNumSamples() > 0; }
+
+    /** Sets the delay time target in samples; how fast it gets there is set by setDelayRampTime(). */
+    void setDelay (float newDelayInSamples) noexcept;
+
+    /** Ramp length used when the delay time changes; zero jumps straight to the new value. */
+    void setDelayRampTime (double seconds) noexcept;
+
+    void setFeedbackGain (float newGain) noexcept;
+
+    void setInterpolation (Interpolation newInterpolation) noexcept;
+
+    /** Sine LFO added to the delay time, for chorus and flanger sounds.
+        A depth of zero turns it off and puts the steady-delay path back in use.
+    */
+    void setModulation (float rateHz, float depthInSamples) noexcept;
+
+    /** Processes the block in place. */
+    void process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    void processChunk (const juce::dsp::AudioBlock<float>& block) noexcept;
+    void clearBehind (int reach) noexcept;
+    void processSpans (int channel, float* samples, int numSamples, bool gainMoving) noexcept;
+
+    template <Interpolation type>
+    void processPerSample (int channel, float* samples, int numSamples, bool delayMoving, bool gainMoving) noexcept;
+
+    template <Interpolation type>
+    float readInterpolated (const float* data, int pos, float delay, float& allpassState) const noexcept;
+
+    void readRing (const float* ring, int start, float* dest, int numSamples) const noexcept;
+    void writeRing (float* ring, int start, const float* src, int numSamples) const noexcept;
+
+    static constexpr int spanSize = 256;
+    static constexpr int maxExtraTaps = 3;      // Lagrange reads three samples beyond the integer delay
+
+    double sampleRate = 44100.0;
+    int maxBlockSize = 0, numPreparedChannels = 0, maxDelay = 0, ringSize = 0;
+
+    juce::AudioBuffer<float> ring;
+    int writePos = 0;
+
+    // How far back from writePos the ring holds samples written or cleared since the last reset().
+    int clearedReach = 0;
+    std::vector<float> lastFeedback, allpassStates;
+
+    Interpolation interpolation = Interpolation::linear;
+
+    juce::SmoothedValue<float> delayTime;
+    juce::LinearSmoothedValue<float> feedbackGain;
+    double delayRampSeconds = 0.0;
+
+    // Quadrature oscillator: one complex rotation per sample, renormalised per chunk.
+    juce::LinearSmoothedValue<float> modDepth;
+    float lfoSin = 0.0f, lfoCos = 1.0f, lfoStepSin = 0.0f, lfoStepCos = 1.0f;
+
+    // Per-block ramps shared by every channel, and per-span scratch.
+    std::vector<float> delays, gains;
+    float spanTaps[spanSize + maxExtraTaps], spanIn[spanSize], spanOut[spanSize], spanTemp[spanSize];
+
+    JUCE_LEAK_DETECTOR (DelayEngine)
+};
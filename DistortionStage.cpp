@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    Waveshaping distortion with optional oversampling around it.
+
+  ==============================================================================
+*/
+
+#include "DistortionStage.h"
+
+//==============================================================================
+void DistortionStage::prepare (double sampleRate, int maximumBlockSize, int numChannels)
+{
+    juce::ignoreUnused (sampleRate);
+
+    using Oversampling = juce::dsp::Oversampling<float>;
+
+    for (int i = 0; i < maxOversamplingOrder; ++i)
+    {
+        const auto factor = (size_t) (i + 1);
+
+        for (auto type : { OversamplingFilter::polyphaseIIR, OversamplingFilter::linearPhaseFIR })
+        {
+            const auto filterType = type == OversamplingFilter::polyphaseIIR ? Oversampling::filterHalfBandPolyphaseIIR
+                                                                             : Oversampling::filterHalfBandFIREquiripple;
+
+            auto& oversampler = oversamplers[(size_t) (i * 2 + (int) type)];
+            oversampler = std::make_unique<Oversampling> ((size_t) juce::jmax (1, numChannels), factor, filterType, true);
+            oversampler->initProcessing ((size_t) juce::jmax (1, maximumBlockSize));
+        }
+    }
+
+    adaaStates.assign ((size_t) juce::jmax (1, numChannels), {});
+
+    reset();
+}
+
+void DistortionStage::reset() noexcept
+{
+    for (auto& oversampler : oversamplers)
+        if (oversampler != nullptr)
+            oversampler->reset();
+
+    std::fill (adaaStates.begin(), adaaStates.end(), AdaaShapers::ChannelState{});
+}
+
+void DistortionStage::setOversampling (int newOrder, OversamplingFilter newFilter) noexcept
+{
+    newOrder = juce::jlimit (0, maxOversamplingOrder, newOrder);
+
+    if (newOrder == order && newFilter == filter)
+        return;
+
+    order = newOrder;
+    filter = newFilter;
+
+    // Don't let the newly selected filters start from whatever they held last time they were used.
+    if (auto* oversampler = getOversampler (order, filter))
+        oversampler->reset();
+}
+
+void DistortionStage::setAntialiasing (Antialiasing mode) noexcept
+{
+    if (mode == antialiasing)
+        return;
+
+    antialiasing = mode;
+    std::fill (adaaStates.begin(), adaaStates.end(), AdaaShapers::ChannelState{});
+}
+
+void DistortionStage::setParameters (int type, float newThreshold, float newMix) noexcept
+{
+    distortionType = type;
+    threshold = newThreshold;
+    mix = newMix;
+}
+
+int DistortionStage::getLatencySamples() const noexcept
+{
+    if (auto* oversampler = getOversampler (order, filter))
+        return juce::roundToInt (oversampler->getLatencyInSamples());
+
+    return 0;
+}
+
+juce::dsp::Oversampling<float>* DistortionStage::getOversampler (int forOrder, OversamplingFilter forFilter) const noexcept
+{
+    if (forOrder <= 0)
+        return nullptr;
+
+    return oversamplers[(size_t) ((forOrder - 1) * 2 + (int) forFilter)].get();
+}
+
+//==============================================================================
+void DistortionStage::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto* oversampler = getOversampler (order, filter);
+
+    if (oversampler == nullptr)
+    {
+        shape (block);
+        return;
+    }
+
+    auto upsampled = oversampler->processSamplesUp (block);
+    shape (upsampled);
+
+    auto output = block;
+    oversampler->processSamplesDown (output);
+}
+
+void DistortionStage::shape (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    switch (distortionType)
+    {
+        case hardClip:      shapeWith<Waveshapers::HardClip,   AdaaShapers::HardClip>   (block); break;
+        case softClip:      shapeWith<Waveshapers::SoftClip,   AdaaShapers::SoftClip>   (block); break;
+        case halfWave:      shapeWith<Waveshapers::HalfWave,   AdaaShapers::HalfWave>   (block); break;
+        case tanhClip:      shapeWith<Waveshapers::Tanh,       AdaaShapers::Tanh>       (block); break;
+        case cubicClip:     shapeWith<Waveshapers::Cubic,      AdaaShapers::Cubic>      (block); break;
+        case asymmetric:    shapeWith<Waveshapers::Asymmetric, AdaaShapers::Asymmetric> (block); break;
+        case foldback:      shapeWith<Waveshapers::Foldback,   AdaaShapers::Foldback>   (block); break;
+        default:            break;
+    }
+}
+
+template <typename Shaper, typename AdaaShape>
+void DistortionStage::shapeWith (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+    const auto numChannels = juce::jmin (block.getNumChannels(), adaaStates.size());
+
+    if (antialiasing == Antialiasing::off || numChannels == 0)
+    {
+        const auto settings = Waveshapers::Settings::make (threshold);
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+            Waveshapers::processBlock<Shaper> (block.getChannelPointer (channel), numSamples, settings, mix);
+
+        return;
+    }
+
+    const auto settings = AdaaShapers::Settings::make (threshold);
+
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto* samples = block.getChannelPointer (channel);
+
+        if (antialiasing == Antialiasing::firstOrder)
+            AdaaShapers::processFirstOrder<AdaaShape> (samples, numSamples, adaaStates[channel], settings, mix);
+        else
+            AdaaShapers::processSecondOrder<AdaaShape> (samples, numSamples, adaaStates[channel], settings, mix);
+    }
+}
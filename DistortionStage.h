@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    Waveshaping distortion with optional oversampling around it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Waveshapers.h"
+#include "AdaaShapers.h"
+
+//==============================================================================
+/**
+    Waveshaping distortion (see Waveshapers.h for the modes), optionally run
+    at 2x, 4x or 8x the session rate.
+
+    Only this stage is oversampled. The clean/distorted mix is taken at the
+    raised rate too, so both halves go through the same filters and stay
+    aligned. Every oversampler is built in prepare(), so changing the factor
+    or filter while playing allocates nothing; the new one is just reset.
+    The caller reports getLatencySamples() to the host.
+
+    Antiderivative anti-aliasing (AdaaShapers.h) is a cheaper, zero-latency
+    alternative. It can be used on its own or on top of oversampling.
+*/
+class DistortionStage
+{
+public:
+    /** Matches the order of the Distortion parameter's choices. */
+    enum Type
+    {
+        hardClip,
+        softClip,
+        halfWave,
+        tanhClip,
+        cubicClip,
+        asymmetric,
+        foldback,
+        numTypes
+    };
+
+    enum class OversamplingFilter
+    {
+        polyphaseIIR,       // low CPU, small non-linear-phase latency
+        linearPhaseFIR      // linear phase, more latency
+    };
+
+    enum class Antialiasing
+    {
+        off,
+        firstOrder,         // ADAA, half a sample of group delay
+        secondOrder         // ADAA, one sample of group delay, stronger suppression
+    };
+
+    static constexpr int maxOversamplingOrder = 3;     // 2^3 = 8x
+
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels);
+    void reset() noexcept;
+
+    /** order 0 turns oversampling off; 1, 2 and 3 give 2x, 4x and 8x. */
+    void setOversampling (int order, OversamplingFilter filter) noexcept;
+
+    /** Switching clears the previous-sample history the ADAA kernels keep. */
+    void setAntialiasing (Antialiasing mode) noexcept;
+
+    /** type is one of the Type values; mix is applied once per block. */
+    void setParameters (int type, float threshold, float mix) noexcept;
+
+    /** Latency of the current oversampling setting, rounded to whole samples. */
+    int getLatencySamples() const noexcept;
+
+    /** Processes the block in place. */
+    void process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    void shape (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    template <typename Shaper, typename AdaaShape>
+    void shapeWith (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    juce::dsp::Oversampling<float>* getOversampler (int order, OversamplingFilter filter) const noexcept;
+
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, 2 * maxOversamplingOrder> oversamplers;
+    int order = 0;
+    OversamplingFilter filter = OversamplingFilter::polyphaseIIR;
+
+    Antialiasing antialiasing = Antialiasing::off;
+    std::vector<AdaaShapers::ChannelState> adaaStates;
+
+    int distortionType = 0;
+    float threshold = 0.0f, mix = 0.0f;
+
+    JUCE_LEAK_DETECTOR (DistortionStage)
+};
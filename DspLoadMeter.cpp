@@ -0,0 +1,342 @@
+/*
+  ==============================================================================
+
+    Per-stage DSP load, timed on the audio thread and read on the message thread.
+
+  ==============================================================================
+*/
+
+#include "DspLoadMeter.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+const char* DspLoadMeter::getStageName (int stage) noexcept
+{
+    switch (stage)
+    {
+        case setup:         return "Setup";
+        case playback:      return "Playback";
+        case gain:          return "Gain";
+        case filter:        return "Filter";
+        case delay:         return "Delay";
+        case distortion:    return "Distortion";
+        default:            return "";
+    }
+}
+
+DspLoadMeter::Ticks DspLoadMeter::now() noexcept
+{
+   #if JUCE_INTEL
+    return (Ticks) __rdtsc();
+   #else
+    return (Ticks) juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+double DspLoadMeter::getTicksPerSecond()
+{
+   #if JUCE_INTEL
+    // The time-stamp counter runs at a constant rate on every CPU the plug-in supports,
+    // but that rate isn't reported anywhere portable, so measure it once.
+    static const double ticksPerSecond = []
+    {
+        const auto startTime = juce::Time::getHighResolutionTicks();
+        const auto startTicks = now();
+
+        juce::Thread::sleep (20);
+
+        const auto elapsedTicks = now() - startTicks;
+        const auto elapsedSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTime);
+        return (double) elapsedTicks / elapsedSeconds;
+    }();
+
+    return ticksPerSecond;
+   #else
+    return (double) juce::Time::getHighResolutionTicksPerSecond();
+   #endif
+}
+
+//==============================================================================
+DspLoadMeter::DspLoadMeter()
+    : records ((size_t) fifoSize),
+      instanceNumber ([]
+      {
+          static std::atomic<int> numInstancesCreated { 0 };
+          return ++numInstancesCreated;
+      }())
+{
+    for (auto& s : worstStages)
+        s.store (0, std::memory_order_relaxed);
+}
+
+void DspLoadMeter::prepare (double newSampleRate)
+{
+    sampleRate.store (newSampleRate, std::memory_order_relaxed);
+    ticksPerSample.store (getTicksPerSecond() / newSampleRate, std::memory_order_relaxed);
+
+    // Blocks from the old rate would be judged against the wrong budget.
+    resetWorstBlock();
+}
+
+juce::String DspLoadMeter::getInstanceName() const
+{
+    const juce::ScopedLock sl (trackNameLock);
+    const auto number = "#" + juce::String (instanceNumber);
+    return trackName.isEmpty() ? number : number + " " + trackName;
+}
+
+void DspLoadMeter::setTrackName (const juce::String& name)
+{
+    const juce::ScopedLock sl (trackNameLock);
+    trackName = name;
+}
+
+//==============================================================================
+void DspLoadMeter::beginBlock() noexcept
+{
+    current.stages.fill (0);
+    lastMark = now();
+    current.total = lastMark;
+}
+
+void DspLoadMeter::endStage (Stage stage) noexcept
+{
+    const auto mark = now();
+    current.stages[(size_t) stage] += mark - lastMark;
+    lastMark = mark;
+}
+
+void DspLoadMeter::addStageTicks (const StageTicks& ticks) noexcept
+{
+    for (size_t i = 0; i < ticks.size(); ++i)
+        current.stages[i] += ticks[i];
+
+    // Whatever the caller timed happened since the last mark; don't charge it twice.
+    lastMark = now();
+}
+
+void DspLoadMeter::endBlock (int numSamples) noexcept
+{
+    current.total = now() - current.total;
+    current.numSamples = numSamples;
+
+    if (resetRequested.exchange (false, std::memory_order_relaxed))
+    {
+        worstTotal = 0;
+        worstSamples = 0;
+        numOverruns.store (0, std::memory_order_relaxed);
+        numDropped.store (0, std::memory_order_relaxed);
+        publishWorst ({});
+    }
+
+    if ((double) current.total > numSamples * ticksPerSample.load (std::memory_order_relaxed))
+        numOverruns.fetch_add (1, std::memory_order_relaxed);
+
+    // Heaviest relative to its own budget, so a long block doesn't win just for being long.
+    if (numSamples > 0 && (worstSamples == 0 || current.total * (Ticks) worstSamples > worstTotal * (Ticks) numSamples))
+    {
+        worstTotal = current.total;
+        worstSamples = numSamples;
+        publishWorst (current);
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        numDropped.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    records[(size_t) start1] = current;
+    fifo.finishedWrite (1);
+}
+
+void DspLoadMeter::publishWorst (const BlockTiming& timing) noexcept
+{
+    const auto sequence = worstSequence.load (std::memory_order_relaxed);
+    worstSequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    for (size_t i = 0; i < worstStages.size(); ++i)
+        worstStages[i].store (timing.stages[i], std::memory_order_relaxed);
+
+    worstBlockTotal.store (timing.total, std::memory_order_relaxed);
+    worstBlockSamples.store (timing.numSamples, std::memory_order_relaxed);
+
+    worstSequence.store (sequence + 2, std::memory_order_release);
+}
+
+//==============================================================================
+bool DspLoadMeter::pop (BlockTiming& timing) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    timing = records[(size_t) start1];
+    fifo.finishedRead (1);
+    return true;
+}
+
+DspLoadMeter::BlockTiming DspLoadMeter::getWorstBlock() const noexcept
+{
+    BlockTiming timing;
+
+    for (;;)
+    {
+        const auto sequence = worstSequence.load (std::memory_order_acquire);
+
+        if ((sequence & 1) != 0)
+            continue;
+
+        for (size_t i = 0; i < worstStages.size(); ++i)
+            timing.stages[i] = worstStages[i].load (std::memory_order_relaxed);
+
+        timing.total = worstBlockTotal.load (std::memory_order_relaxed);
+        timing.numSamples = worstBlockSamples.load (std::memory_order_relaxed);
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if (worstSequence.load (std::memory_order_relaxed) == sequence)
+            return timing;
+    }
+}
+
+//==============================================================================
+double DspLoadHistory::getLoad (const DspLoadMeter::BlockTiming& timing, double ticksPerSecond, double sampleRate) noexcept
+{
+    if (timing.numSamples <= 0 || ticksPerSecond <= 0.0)
+        return 0.0;
+
+    return (double) timing.total * sampleRate / (ticksPerSecond * timing.numSamples);
+}
+
+int DspLoadHistory::getHistogramBin (double load) noexcept
+{
+    return juce::jlimit (0, numHistogramBins - 1, load > 1.0 ? numHistogramBins - 1 : (int) (load * 10.0));
+}
+
+bool DspLoadHistory::update (DspLoadMeter& meter)
+{
+    if (history.empty())
+    {
+        history.resize ((size_t) historySize);
+        ticksPerSecond = DspLoadMeter::getTicksPerSecond();
+    }
+
+    if (meter.getSampleRate() != sampleRate)
+    {
+        reset();
+        sampleRate = meter.getSampleRate();
+    }
+
+    auto anythingNew = false;
+    DspLoadMeter::BlockTiming timing;
+
+    while (meter.pop (timing))
+    {
+        add (timing);
+        anythingNew = true;
+    }
+
+    return anythingNew;
+}
+
+void DspLoadHistory::reset()
+{
+    nextInHistory = numInHistory = 0;
+    numBlocksSeen = 0;
+    stageLoad.fill (0.0);
+    totalLoad = 0.0;
+    histogram.fill (0);
+}
+
+void DspLoadHistory::add (const DspLoadMeter::BlockTiming& timing)
+{
+    if (timing.numSamples <= 0)
+        return;
+
+    const auto budget = ticksPerSecond * timing.numSamples / sampleRate;
+
+    // One-pole smoothing with a 300 ms time constant, whatever the block size.
+    const auto alpha = 1.0 - std::exp (-timing.numSamples / (0.3 * sampleRate));
+
+    for (size_t i = 0; i < stageLoad.size(); ++i)
+        stageLoad[i] += alpha * ((double) timing.stages[i] / budget - stageLoad[i]);
+
+    totalLoad += alpha * ((double) timing.total / budget - totalLoad);
+
+    // The block falling out of the window leaves the histogram as the new one joins it.
+    auto& slot = history[(size_t) nextInHistory];
+
+    if (numInHistory == historySize)
+        --histogram[(size_t) getHistogramBin (getLoad (slot, ticksPerSecond, sampleRate))];
+    else
+        ++numInHistory;
+
+    slot = timing;
+    ++histogram[(size_t) getHistogramBin (getLoad (slot, ticksPerSecond, sampleRate))];
+
+    nextInHistory = (nextInHistory + 1) % historySize;
+    ++numBlocksSeen;
+}
+
+//==============================================================================
+void DspLoadHistory::writeCsv (juce::OutputStream& out, const DspLoadMeter& meter) const
+{
+    const auto instance = meter.getInstanceName().replaceCharacter (',', ' ');
+    const auto microsecondsPerTick = 1.0e6 / ticksPerSecond;
+
+    out << "instance,block,samples,sample_rate,budget_us,total_us,load_percent";
+
+    for (int stage = 0; stage < DspLoadMeter::numStages; ++stage)
+        out << "," << juce::String (DspLoadMeter::getStageName (stage)).toLowerCase() << "_us";
+
+    out << "\n";
+
+    const auto first = (nextInHistory - numInHistory + historySize) % historySize;
+
+    for (int i = 0; i < numInHistory; ++i)
+    {
+        const auto& timing = history[(size_t) ((first + i) % historySize)];
+
+        out << instance
+            << "," << juce::String (numBlocksSeen - numInHistory + i)
+            << "," << timing.numSamples
+            << "," << juce::String (sampleRate, 0)
+            << "," << juce::String (1.0e6 * timing.numSamples / sampleRate, 2)
+            << "," << juce::String ((double) timing.total * microsecondsPerTick, 2)
+            << "," << juce::String (100.0 * getLoad (timing, ticksPerSecond, sampleRate), 2);
+
+        for (auto ticks : timing.stages)
+            out << "," << juce::String ((double) ticks * microsecondsPerTick, 2);
+
+        out << "\n";
+    }
+}
+
+bool DspLoadHistory::exportCsv (const juce::File& file, const DspLoadMeter& meter) const
+{
+    juce::FileOutputStream out (file);
+
+    if (! out.openedOk())
+        return false;
+
+    out.setPosition (0);
+    out.truncate();
+
+    writeCsv (out, meter);
+    out.flush();
+    return out.getStatus().wasOk();
+}
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    Per-stage DSP load, timed on the audio thread and read on the message thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Times each stage of processBlock with the CPU's cycle counter and passes
+    the figures to the message thread.
+
+    The audio thread brackets each block with beginBlock() and endBlock(). In
+    between, endStage() charges the time since the previous mark to a stage,
+    and addStageTicks() adds time measured elsewhere, e.g. by the effect
+    chain. endBlock() pushes one BlockTiming into a single-producer,
+    single-consumer FIFO. If nobody drains the FIFO, the record is dropped
+    and counted. Nothing on the audio side allocates, locks or waits.
+
+    Two figures survive even when nobody reads the FIFO: the heaviest block
+    since the last reset, with its stage breakdown, and the number of blocks
+    that overran their real-time budget. An engineer can open the editor
+    after an overload and still see which stage caused it.
+
+    The budget for a block is numSamples / sampleRate. Stage times are CPU
+    time. When channel groups run on worker threads, the stage times add up
+    across threads, so together they can exceed the block's wall-clock total.
+*/
+class DspLoadMeter
+{
+public:
+    enum Stage
+    {
+        setup,          // parameter snapshot, smoothing targets and the delay's dry copy
+        playback,       // file playback, including any streaming and resampling on the audio thread
+        gain,
+        filter,         // coefficient updates and the biquads
+        delay,          // delay lines and their dry/wet mix
+        distortion,     // waveshaping and oversampling
+        numStages
+    };
+
+    static const char* getStageName (int stage) noexcept;
+
+    using Ticks = juce::uint64;
+    using StageTicks = std::array<Ticks, numStages>;
+
+    /** A timestamp from the cheapest clock available: the time-stamp counter
+        on x86, the high-resolution timer elsewhere.
+    */
+    static Ticks now() noexcept;
+
+    /** Rate of now(). The first call calibrates the counter over ~20 ms, so make it off the audio thread. */
+    static double getTicksPerSecond();
+
+    struct BlockTiming
+    {
+        StageTicks stages {};
+        Ticks total = 0;        // wall-clock time of the whole block
+        int numSamples = 0;
+    };
+
+    DspLoadMeter();
+
+    /** Call before playback starts, off the audio thread. */
+    void prepare (double sampleRate);
+    double getSampleRate() const noexcept                   { return sampleRate.load (std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Audio thread. */
+    void beginBlock() noexcept;
+    void endStage (Stage stage) noexcept;
+    void addStageTicks (const StageTicks& ticks) noexcept;
+    void endBlock (int numSamples) noexcept;
+
+    //==============================================================================
+    /** Message thread: takes the oldest record from the FIFO, or returns false when it's empty. */
+    bool pop (BlockTiming& timing) noexcept;
+
+    /** The heaviest block relative to its budget since the last reset; numSamples is 0 if there's been none. */
+    BlockTiming getWorstBlock() const noexcept;
+    int getNumOverruns() const noexcept                     { return numOverruns.load (std::memory_order_relaxed); }
+    int getNumDroppedBlocks() const noexcept                { return numDropped.load (std::memory_order_relaxed); }
+
+    /** Clears the worst block and the counters; the audio thread applies it at the end of its next block. */
+    void resetWorstBlock() noexcept                         { resetRequested.store (true, std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Identifies this instance in the editor and the CSV export. The number is
+        unique within the process; the track name is whatever the host reported.
+    */
+    int getInstanceNumber() const noexcept                  { return instanceNumber; }
+    juce::String getInstanceName() const;
+    void setTrackName (const juce::String& name);
+
+private:
+    void publishWorst (const BlockTiming& timing) noexcept;
+
+    static constexpr int fifoSize = 1024;     // over a second of 64-sample blocks at 48 kHz
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::vector<BlockTiming> records;
+
+    // Audio thread only.
+    BlockTiming current;
+    Ticks lastMark = 0;
+    Ticks worstTotal = 0;
+    int worstSamples = 0;
+
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<double> ticksPerSample { 0.0 };
+
+    // A sequence lock: odd while the audio thread is writing, so readers retry instead of seeing half a record.
+    std::atomic<juce::uint32> worstSequence { 0 };
+    std::array<std::atomic<Ticks>, numStages> worstStages;
+    std::atomic<Ticks> worstBlockTotal { 0 };
+    std::atomic<int> worstBlockSamples { 0 };
+
+    std::atomic<int> numOverruns { 0 }, numDropped { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    const int instanceNumber;
+    juce::String trackName;
+    juce::CriticalSection trackNameLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DspLoadMeter)
+};
+
+//==============================================================================
+/**
+    The message-thread side: drains a DspLoadMeter and keeps what the editor
+    shows and the CSV export writes.
+
+    It keeps:
+    - smoothed per-stage loads as fractions of the real-time budget;
+    - the last historySize blocks, for a rolling histogram of block load;
+    - the same blocks as rows for the CSV.
+
+    A change of sample rate clears the history, so every row shares one budget.
+
+    Nothing is allocated until the first update(), so an instance whose
+    editor is never opened doesn't pay for the history.
+*/
+class DspLoadHistory
+{
+public:
+    static constexpr int historySize = 4096;
+
+    /** 10% wide from 0 to 100%, then one bin for every block that overran. */
+    static constexpr int numHistogramBins = 11;
+
+    DspLoadHistory() = default;
+
+    /** Drains the meter; returns true if anything new arrived. */
+    bool update (DspLoadMeter& meter);
+    void reset();
+
+    /** Smoothed over roughly the last 300 ms, as a fraction of the budget (1.0 = all of it). */
+    double getStageLoad (int stage) const noexcept          { return stageLoad[(size_t) stage]; }
+    double getTotalLoad() const noexcept                    { return totalLoad; }
+
+    /** Block counts per load bin over the blocks in the history. */
+    const std::array<int, numHistogramBins>& getHistogram() const noexcept   { return histogram; }
+    int getNumBlocks() const noexcept                       { return numInHistory; }
+
+    static double getLoad (const DspLoadMeter::BlockTiming& timing, double ticksPerSecond, double sampleRate) noexcept;
+
+    /** One row per block in the history, oldest first, times in microseconds. */
+    void writeCsv (juce::OutputStream& out, const DspLoadMeter& meter) const;
+    bool exportCsv (const juce::File& file, const DspLoadMeter& meter) const;
+
+private:
+    static int getHistogramBin (double load) noexcept;
+    void add (const DspLoadMeter::BlockTiming& timing);
+
+    std::vector<DspLoadMeter::BlockTiming> history;
+    double sampleRate = 0.0;        // of every block in the history; a change starts it afresh
+    int nextInHistory = 0, numInHistory = 0;
+    juce::int64 numBlocksSeen = 0;
+
+    std::array<double, DspLoadMeter::numStages> stageLoad {};
+    double totalLoad = 0.0;
+    std::array<int, numHistogramBins> histogram {};
+    double ticksPerSecond = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DspLoadHistory)
+};
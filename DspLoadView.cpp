@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    Editor panel showing the per-stage DSP load.
+
+  ==============================================================================
+*/
+
+#include "DspLoadView.h"
+
+namespace
+{
+    constexpr int rowHeight = 14;
+    constexpr int headerHeight = 22;
+    constexpr int textLineHeight = 15;
+
+    juce::Colour getLoadColour (double load)
+    {
+        if (load >= 1.0)    return juce::Colours::red;
+        if (load >= 0.7)    return juce::Colours::orange;
+        return juce::Colours::limegreen;
+    }
+}
+
+//==============================================================================
+DspLoadView::DspLoadView (DspLoadMeter& m, DspLoadHistory& h)
+    : ShowingTimerComponent (refreshRateHz), meter (m), history (h)
+{
+    exportButton.onClick = [this] { exportCsv(); };
+    addAndMakeVisible (exportButton);
+
+    resetButton.onClick = [this]
+    {
+        history.reset();
+        meter.resetWorstBlock();
+        repaint();
+    };
+    addAndMakeVisible (resetButton);
+
+    setOpaque (true);
+}
+
+void DspLoadView::timerCallback()
+{
+    auto changed = history.update (meter);
+
+    // The worst block and the counters are kept by the audio thread, so they can
+    // change even when the FIFO had nothing new.
+    const auto worstTotal = meter.getWorstBlock().total;
+    const auto overruns = meter.getNumOverruns();
+    const auto dropped = meter.getNumDroppedBlocks();
+
+    if (worstTotal != shownWorstTotal || overruns != shownOverruns || dropped != shownDropped)
+    {
+        shownWorstTotal = worstTotal;
+        shownOverruns = overruns;
+        shownDropped = dropped;
+        changed = true;
+    }
+
+    if (changed)
+        repaint();
+}
+
+//==============================================================================
+void DspLoadView::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colour::fromRGB (30, 34, 38));
+
+    auto area = getLocalBounds().reduced (6);
+    auto header = area.removeFromTop (headerHeight);
+
+    g.setColour (juce::Colours::white);
+    g.setFont (13.0f);
+    g.drawText ("DSP load  " + meter.getInstanceName(), header.withTrimmedRight (180), juce::Justification::centredLeft, true);
+
+    area.removeFromTop (4);
+    paintBars (g, area.removeFromLeft (area.getWidth() / 2).withTrimmedRight (8));
+
+    auto text = area.removeFromBottom (2 * textLineHeight);
+    paintHistogram (g, area.withTrimmedBottom (4));
+
+    g.setColour (juce::Colours::white);
+    g.setFont (12.0f);
+    g.drawText (describeWorstBlock(), text.removeFromTop (textLineHeight), juce::Justification::centredLeft, true);
+    g.drawText ("Overruns " + juce::String (meter.getNumOverruns()) + "   Dropped " + juce::String (meter.getNumDroppedBlocks()),
+                text, juce::Justification::centredLeft, true);
+}
+
+void DspLoadView::paintBars (juce::Graphics& g, juce::Rectangle<int> area)
+{
+    const auto labelWidth = 64;
+    const auto valueWidth = 44;
+
+    g.setFont (11.0f);
+
+    auto drawRow = [&] (const juce::String& name, double load)
+    {
+        auto row = area.removeFromTop (rowHeight);
+        auto label = row.removeFromLeft (labelWidth);
+        auto value = row.removeFromRight (valueWidth);
+        auto bar = row.reduced (0, 2);
+
+        g.setColour (juce::Colours::white);
+        g.drawText (name, label, juce::Justification::centredLeft, false);
+        g.drawText (juce::String (load * 100.0, 1) + "%", value, juce::Justification::centredRight, false);
+
+        g.setColour (juce::Colours::white.withAlpha (0.15f));
+        g.fillRect (bar);
+
+        g.setColour (getLoadColour (load));
+        g.fillRect (bar.withWidth (juce::roundToInt (bar.getWidth() * juce::jlimit (0.0, 1.0, load))));
+    };
+
+    drawRow ("Total", history.getTotalLoad());
+
+    for (int stage = 0; stage < DspLoadMeter::numStages; ++stage)
+        drawRow (DspLoadMeter::getStageName (stage), history.getStageLoad (stage));
+}
+
+void DspLoadView::paintHistogram (juce::Graphics& g, juce::Rectangle<int> area)
+{
+    const auto& bins = history.getHistogram();
+    const auto peak = juce::jmax (1, *std::max_element (bins.begin(), bins.end()));
+
+    auto labels = area.removeFromBottom (12);
+    const auto binWidth = (float) area.getWidth() / DspLoadHistory::numHistogramBins;
+
+    g.setColour (juce::Colours::white.withAlpha (0.15f));
+    g.fillRect (area);
+
+    for (int i = 0; i < DspLoadHistory::numHistogramBins; ++i)
+    {
+        // Square root, so a handful of slow blocks still shows next to thousands of normal ones.
+        const auto height = area.getHeight() * std::sqrt ((float) bins[(size_t) i] / (float) peak);
+        const auto x = area.getX() + i * binWidth;
+
+        g.setColour (getLoadColour (i * 0.1 + 0.05));
+        g.fillRect (juce::Rectangle<float> (x + 1.0f, area.getBottom() - height, binWidth - 2.0f, height));
+    }
+
+    g.setColour (juce::Colours::white);
+    g.setFont (10.0f);
+    g.drawText ("0%", labels, juce::Justification::centredLeft, false);
+    g.drawText ("50%", labels, juce::Justification::centred, false);
+    g.drawText (">100%", labels, juce::Justification::centredRight, false);
+}
+
+juce::String DspLoadView::describeWorstBlock() const
+{
+    const auto worst = meter.getWorstBlock();
+
+    if (worst.numSamples == 0)
+        return "Worst block: none yet";
+
+    const auto ticksPerSecond = DspLoadMeter::getTicksPerSecond();
+    const auto heaviest = std::max_element (worst.stages.begin(), worst.stages.end());
+    const auto load = DspLoadHistory::getLoad (worst, ticksPerSecond, meter.getSampleRate());
+
+    // Time no stage accounts for means the audio thread was held up outside the DSP, e.g. preempted.
+    const auto timedTicks = std::accumulate (worst.stages.begin(), worst.stages.end(), (DspLoadMeter::Ticks) 0);
+    const auto untimedTicks = worst.total > timedTicks ? worst.total - timedTicks : 0;
+
+    const auto culprit = untimedTicks > *heaviest ? juce::String ("outside the stages")
+                                                  : juce::String (DspLoadMeter::getStageName ((int) std::distance (worst.stages.begin(), heaviest)));
+
+    return "Worst block: " + juce::String (1000.0 * worst.total / ticksPerSecond, 2) + " ms ("
+           + juce::String (juce::roundToInt (load * 100.0)) + "%) for " + juce::String (worst.numSamples)
+           + " samples, mostly " + culprit;
+}
+
+void DspLoadView::resized()
+{
+    auto header = getLocalBounds().reduced (6).removeFromTop (headerHeight);
+
+    exportButton.setBounds (header.removeFromRight (100));
+    header.removeFromRight (6);
+    resetButton.setBounds (header.removeFromRight (60));
+}
+
+//==============================================================================
+void DspLoadView::exportCsv()
+{
+    const auto defaultName = "dsp-load-" + juce::String (meter.getInstanceNumber())
+                              + juce::Time::getCurrentTime().formatted ("-%Y%m%d-%H%M%S") + ".csv";
+
+    juce::FileChooser fileChooser{ "Export DSP load", juce::File::getSpecialLocation (juce::File::userDocumentsDirectory).getChildFile (defaultName), "*.csv" };
+
+    if (! fileChooser.browseForFileToSave (true))
+        return;
+
+    history.update (meter);
+
+    if (! history.exportCsv (fileChooser.getResult(), meter))
+        juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon, "Export DSP load",
+                                                "Couldn't write " + fileChooser.getResult().getFullPathName());
+}
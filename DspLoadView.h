@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    Editor panel showing the per-stage DSP load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspLoadMeter.h"
+#include "ShowingTimerComponent.h"
+
+//==============================================================================
+/**
+    Shows which stage of processBlock costs what, against the real-time budget
+    for the current block size:
+    - one bar per stage and one for the whole block, smoothed over ~300 ms;
+    - a histogram of block load over the last few thousand blocks;
+    - the worst block since the last reset, with its heaviest stage;
+    - the overrun and dropped-record counts.
+
+    The bars show CPU time, so with parallel groups they can add up to more
+    than the total bar.
+
+    The view drains the history a few times a second, and only while it is
+    showing. It repaints only when something it shows has changed, so an
+    idle instance costs the message thread nothing but the timer.
+
+    "Export CSV" saves the blocks in the history; "Reset" clears the history,
+    the worst block and the counters.
+*/
+class DspLoadView  : public ShowingTimerComponent
+{
+public:
+    DspLoadView (DspLoadMeter& meter, DspLoadHistory& history);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void exportCsv();
+
+    void paintBars (juce::Graphics& g, juce::Rectangle<int> area);
+    void paintHistogram (juce::Graphics& g, juce::Rectangle<int> area);
+    juce::String describeWorstBlock() const;
+
+    static constexpr int refreshRateHz = 15;
+
+    DspLoadMeter& meter;
+    DspLoadHistory& history;
+
+    DspLoadMeter::Ticks shownWorstTotal = 0;
+    int shownOverruns = 0, shownDropped = 0;
+
+    juce::TextButton exportButton { "Export CSV..." };
+    juce::TextButton resetButton { "Reset" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DspLoadView)
+};
@@ -0,0 +1,481 @@
+/*
+  ==============================================================================
+
+    Low-pass, gain, delay and distortion run as one fused pass.
+
+  ==============================================================================
+*/
+
+#include "EffectChain.h"
+
+//==============================================================================
+EffectChain::EffectChain()
+    : pendingLayout (ChainLayout::getDefault().pack())
+{
+}
+
+void EffectChain::prepare (double sampleRate, int maximumBlockSize, int numChannels, int maximumDelayInSamples)
+{
+    numChannels = juce::jmax (1, numChannels);
+    maximumBlockSize = juce::jmax (1, maximumBlockSize);
+
+    // Every instance is prepared, so a layout change while playing only ever allocates a delay line.
+    for (auto& filter : filters)
+        filter.prepare (numChannels);
+
+    filterCoefficients.prepare (sampleRate);
+
+    gain.reset (sampleRate, 0.02);
+
+    {
+        const juce::ScopedLock sl (delayLineLock);
+
+        for (auto& delay : delays)
+        {
+            delay.setDelayRampTime (0.05);
+            delay.prepare (sampleRate, maximumBlockSize, numChannels, maximumDelayInSamples, false);
+        }
+    }
+
+    allocateDelayLines (getLayout());
+
+    dryBuffer.setSize (numChannels, maximumBlockSize);
+    dryTap.setSize (numChannels, subBlockSize);
+    delayWet.reset (sampleRate, 0.05);
+
+    for (auto& distortion : distortions)
+        distortion.prepare (sampleRate, maximumBlockSize, numChannels);
+
+    reset();
+    updateLayout();
+    updateLatency();
+}
+
+void EffectChain::reset() noexcept
+{
+    for (auto& filter : filters)
+        filter.reset();
+
+    for (auto& delay : delays)
+        delay.reset();
+
+    for (auto& distortion : distortions)
+        distortion.reset();
+
+    dryBuffer.clear();
+
+    // The first block after this starts at its parameter values instead of ramping up from the last ones.
+    snapSmoothers = true;
+}
+
+void EffectChain::setLayout (const ChainLayout& newLayout)
+{
+    allocateDelayLines (newLayout);
+    pendingLayout.store (newLayout.pack(), std::memory_order_release);
+}
+
+void EffectChain::allocateDelayLines (const ChainLayout& layout)
+{
+    const juce::ScopedLock sl (delayLineLock);
+    size_t instance = 0;
+
+    // Bypassed slots count too, so switching one back in doesn't allocate.
+    for (const auto& slot : layout.slots)
+        if (slot.module == Module::delay)
+            delays[instance++].allocateLine();
+}
+
+void EffectChain::setGainDecibels (float gainDb) noexcept
+{
+    setTarget (gain, juce::Decibels::decibelsToGain (gainDb));
+}
+
+void EffectChain::setDelayMix (float wetProportion) noexcept
+{
+    setTarget (delayWet, juce::jlimit (0.0f, 1.0f, wetProportion));
+}
+
+void EffectChain::setTarget (juce::LinearSmoothedValue<float>& value, float target) const noexcept
+{
+    if (snapSmoothers)
+        value.setCurrentAndTargetValue (target);
+    else
+        value.setTargetValue (target);
+}
+
+void EffectChain::setFilterKernel (MultiChannelBiquad::Kernel kernel) noexcept
+{
+    for (auto& filter : filters)
+        filter.setKernel (kernel);
+}
+
+int EffectChain::getLatencySamples() const noexcept
+{
+    return latencySamples.load (std::memory_order_relaxed);
+}
+
+//==============================================================================
+template <ChainLayout::Module... modules>
+void EffectChain::processFixed (juce::dsp::AudioBlock<float>& block, int offset) noexcept
+{
+    // Expands to one direct call per module, in order.
+    using Expand = int[];
+    (void) Expand { 0, (processModule<modules> (block, offset, 0), endStage (getMeterStage (modules)), 0)... };
+    juce::ignoreUnused (block, offset);
+}
+
+template <>
+void EffectChain::processModule<ChainLayout::Module::filter> (juce::dsp::AudioBlock<float>& block, int, int instance) noexcept
+{
+    auto& filter = filters[(size_t) instance];
+
+    if (numFilterPieces == 1)
+    {
+        filter.setCoefficients (pieceCoefficients[0]);
+        filter.process (block);
+        return;
+    }
+
+    for (int piece = 0; piece < numFilterPieces; ++piece)
+    {
+        const auto start = piece * LowPassCoefficientEngine::updateInterval;
+        const auto length = juce::jmin (LowPassCoefficientEngine::updateInterval, (int) block.getNumSamples() - start);
+
+        filter.setCoefficients (pieceCoefficients[(size_t) piece]);
+        auto subBlock = block.getSubBlock ((size_t) start, (size_t) length);
+        filter.process (subBlock);
+    }
+}
+
+template <>
+void EffectChain::processModule<ChainLayout::Module::delay> (juce::dsp::AudioBlock<float>& block, int offset, int instance) noexcept
+{
+    delays[(size_t) instance].process (block);
+    mixDelay (block, offset);
+
+    if (delayFeedsTap[(size_t) instance])
+        captureDryTap (block);
+}
+
+template <>
+void EffectChain::processModule<ChainLayout::Module::distortion> (juce::dsp::AudioBlock<float>& block, int, int instance) noexcept
+{
+    distortions[(size_t) instance].process (block);
+
+    if (distortionFeedsTap[(size_t) instance])
+        captureDryTap (block);
+}
+
+void EffectChain::processGeneric (juce::dsp::AudioBlock<float>& block, int offset) noexcept
+{
+    for (int i = 0; i < numStages; ++i)
+    {
+        const auto& stage = stages[(size_t) i];
+
+        switch (stage.module)
+        {
+            case Module::filter:        processModule<Module::filter>     (block, offset, stage.instance); break;
+            case Module::delay:         processModule<Module::delay>      (block, offset, stage.instance); break;
+            case Module::distortion:    processModule<Module::distortion> (block, offset, stage.instance); break;
+            case Module::none:
+            default:                    break;
+        }
+
+        endStage (getMeterStage (stage.module));
+    }
+}
+
+DspLoadMeter::Stage EffectChain::getMeterStage (Module module) noexcept
+{
+    switch (module)
+    {
+        case Module::filter:        return DspLoadMeter::filter;
+        case Module::delay:         return DspLoadMeter::delay;
+        case Module::distortion:    return DspLoadMeter::distortion;
+        case Module::none:
+        default:                    return DspLoadMeter::gain;
+    }
+}
+
+void EffectChain::endStage (DspLoadMeter::Stage stage) noexcept
+{
+    const auto mark = DspLoadMeter::now();
+    stageTicks[(size_t) stage] += mark - lastMark;
+    lastMark = mark;
+}
+
+//==============================================================================
+void EffectChain::updateLayout() noexcept
+{
+    const auto packed = pendingLayout.load (std::memory_order_acquire);
+
+    if (packed == activeLayout && processStages != nullptr)
+        return;
+
+    const auto previous = stages;
+    const auto numPrevious = numStages;
+
+    const auto wasRunning = [&] (Module module, int instance)
+    {
+        for (int i = 0; i < numPrevious; ++i)
+            if (previous[(size_t) i].module == module && previous[(size_t) i].instance == instance)
+                return true;
+
+        return false;
+    };
+
+    const auto layout = ChainLayout::unpack (packed);
+    int instanceCounts[4] = {};
+    numStages = 0;
+
+    for (const auto& slot : layout.slots)
+    {
+        if (slot.module == Module::none)
+            continue;
+
+        const auto instance = instanceCounts[(int) slot.module]++;
+
+        if (slot.bypassed)
+            continue;
+
+        stages[(size_t) numStages++] = { slot.module, instance };
+
+        if (! wasRunning (slot.module, instance))
+        {
+            switch (slot.module)
+            {
+                case Module::filter:        filters[(size_t) instance].reset(); break;
+                case Module::delay:         delays[(size_t) instance].reset(); break;
+                case Module::distortion:    distortions[(size_t) instance].reset(); break;
+                case Module::none:
+                default:                    break;
+            }
+        }
+    }
+
+    // A delay or distortion only needs to leave a copy behind if a delay further on will mix against it.
+    delayFeedsTap.fill (false);
+    distortionFeedsTap.fill (false);
+    auto delayFollows = false;
+
+    for (int i = numStages; --i >= 0;)
+    {
+        const auto& stage = stages[(size_t) i];
+
+        if (stage.module == Module::distortion)
+            distortionFeedsTap[(size_t) stage.instance] = delayFollows;
+
+        if (stage.module == Module::delay)
+        {
+            delayFeedsTap[(size_t) stage.instance] = delayFollows;
+            delayFollows = true;
+        }
+    }
+
+    activeLayout = packed;
+    processStages = findSpecialisedProcessor();
+}
+
+EffectChain::SubBlockProcessor EffectChain::findSpecialisedProcessor() const noexcept
+{
+    using M = Module;
+
+    struct Specialisation
+    {
+        int numModules;
+        Module order[3];
+        SubBlockProcessor process;
+    };
+
+    static const Specialisation specialisations[] =
+    {
+        { 0, { M::none, M::none, M::none },               &EffectChain::processFixed<> },
+        { 1, { M::filter, M::none, M::none },             &EffectChain::processFixed<M::filter> },
+        { 1, { M::delay, M::none, M::none },              &EffectChain::processFixed<M::delay> },
+        { 1, { M::distortion, M::none, M::none },         &EffectChain::processFixed<M::distortion> },
+        { 2, { M::filter, M::delay, M::none },            &EffectChain::processFixed<M::filter, M::delay> },
+        { 2, { M::filter, M::distortion, M::none },       &EffectChain::processFixed<M::filter, M::distortion> },
+        { 2, { M::delay, M::filter, M::none },            &EffectChain::processFixed<M::delay, M::filter> },
+        { 2, { M::delay, M::distortion, M::none },        &EffectChain::processFixed<M::delay, M::distortion> },
+        { 2, { M::distortion, M::filter, M::none },       &EffectChain::processFixed<M::distortion, M::filter> },
+        { 2, { M::distortion, M::delay, M::none },        &EffectChain::processFixed<M::distortion, M::delay> },
+        { 3, { M::filter, M::delay, M::distortion },      &EffectChain::processFixed<M::filter, M::delay, M::distortion> },
+        { 3, { M::filter, M::distortion, M::delay },      &EffectChain::processFixed<M::filter, M::distortion, M::delay> },
+        { 3, { M::delay, M::filter, M::distortion },      &EffectChain::processFixed<M::delay, M::filter, M::distortion> },
+        { 3, { M::delay, M::distortion, M::filter },      &EffectChain::processFixed<M::delay, M::distortion, M::filter> },
+        { 3, { M::distortion, M::filter, M::delay },      &EffectChain::processFixed<M::distortion, M::filter, M::delay> },
+        { 3, { M::distortion, M::delay, M::filter },      &EffectChain::processFixed<M::distortion, M::delay, M::filter> },
+    };
+
+    // The fixed paths always use the first instance of each module.
+    for (int i = 0; i < numStages; ++i)
+        if (stages[(size_t) i].instance != 0)
+            return &EffectChain::processGeneric;
+
+    for (const auto& s : specialisations)
+        if (s.numModules == numStages
+             && std::equal (s.order, s.order + s.numModules, stages.begin(),
+                            [] (Module m, const Stage& stage) { return m == stage.module; }))
+            return s.process;
+
+    return &EffectChain::processGeneric;
+}
+
+//==============================================================================
+void EffectChain::pushDrySamples (const juce::dsp::AudioBlock<float>& input) noexcept
+{
+    const auto numSamples = juce::jmin ((int) input.getNumSamples(), dryBuffer.getNumSamples());
+    const auto numChannels = juce::jmin ((int) input.getNumChannels(), dryBuffer.getNumChannels());
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        dryBuffer.copyFrom (channel, 0, input.getChannelPointer ((size_t) channel), numSamples);
+}
+
+void EffectChain::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+    jassert (numSamples <= dryBuffer.getNumSamples());
+
+    stageTicks.fill (0);
+    lastMark = DspLoadMeter::now();
+
+    updateLayout();
+
+    for (int offset = 0; offset < numSamples; offset += subBlockSize)
+    {
+        const auto length = juce::jmin (subBlockSize, numSamples - offset);
+        auto subBlock = block.getSubBlock ((size_t) offset, (size_t) length);
+
+        // Everything that moves per sample is advanced once here, however many instances use it.
+        advanceFilterCoefficients (length);
+        endStage (DspLoadMeter::filter);
+
+        advanceSmoothers (length);
+        applyGain (subBlock);
+        endStage (DspLoadMeter::gain);
+
+        dryTapValid = false;
+
+        (this->*processStages) (subBlock, offset);
+    }
+
+    snapSmoothers = false;
+    updateLatency();
+}
+
+void EffectChain::updateLatency() noexcept
+{
+    auto latency = 0;
+
+    for (int i = 0; i < numStages; ++i)
+        if (stages[(size_t) i].module == Module::distortion)
+            latency += distortions[(size_t) stages[(size_t) i].instance].getLatencySamples();
+
+    latencySamples.store (latency, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void EffectChain::advanceFilterCoefficients (int numSamples) noexcept
+{
+    // Settled: at most one coefficient update for the whole sub-block.
+    if (! filterCoefficients.isSmoothing())
+    {
+        if (filterCoefficients.advance (numSamples))
+            latestCoefficients = filterCoefficients.get();
+
+        pieceCoefficients[0] = latestCoefficients;
+        numFilterPieces = 1;
+        return;
+    }
+
+    // Ramping: a fresh set every updateInterval samples.
+    numFilterPieces = 0;
+
+    for (int start = 0; start < numSamples; start += LowPassCoefficientEngine::updateInterval)
+    {
+        if (filterCoefficients.advance (juce::jmin (LowPassCoefficientEngine::updateInterval, numSamples - start)))
+            latestCoefficients = filterCoefficients.get();
+
+        pieceCoefficients[(size_t) numFilterPieces++] = latestCoefficients;
+    }
+}
+
+void EffectChain::advanceSmoothers (int numSamples) noexcept
+{
+    gainRamping = gain.isSmoothing();
+
+    if (gainRamping)
+        for (int i = 0; i < numSamples; ++i)
+            gainRamp[i] = gain.getNextValue();
+
+    wetRamping = delayWet.isSmoothing();
+
+    if (wetRamping)
+        for (int i = 0; i < numSamples; ++i)
+            wetRamp[i] = delayWet.getNextValue();
+}
+
+void EffectChain::applyGain (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    using FVO = juce::FloatVectorOperations;
+
+    const auto numSamples = (int) block.getNumSamples();
+
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        if (gainRamping)
+            FVO::multiply (block.getChannelPointer (channel), gainRamp, numSamples);
+        else
+            FVO::multiply (block.getChannelPointer (channel), gain.getTargetValue(), numSamples);
+    }
+}
+
+void EffectChain::mixDelay (const juce::dsp::AudioBlock<float>& block, int offset) noexcept
+{
+    using FVO = juce::FloatVectorOperations;
+
+    const auto numSamples = (int) block.getNumSamples();
+    const auto numChannels = juce::jmin ((int) block.getNumChannels(), dryBuffer.getNumChannels());
+
+    const auto dryPointer = [this, offset] (int channel)
+    {
+        return dryTapValid ? dryTap.getReadPointer (channel) : dryBuffer.getReadPointer (channel, offset);
+    };
+
+    // Linear rule, as DryWetMixer's default: wet * w + dry * (1 - w).
+    if (! wetRamping)
+    {
+        const auto wet = delayWet.getTargetValue();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = block.getChannelPointer ((size_t) channel);
+            FVO::multiply (samples, wet, numSamples);
+            FVO::addWithMultiply (samples, dryPointer (channel), 1.0f - wet, numSamples);
+        }
+
+        return;
+    }
+
+    // dry + w * (wet - dry)
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* samples = block.getChannelPointer ((size_t) channel);
+        const auto* dry = dryPointer (channel);
+
+        FVO::subtract (scratch, samples, dry, numSamples);
+        FVO::multiply (scratch, wetRamp, numSamples);
+        FVO::add (samples, scratch, dry, numSamples);
+    }
+}
+
+void EffectChain::captureDryTap (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+    const auto numChannels = juce::jmin ((int) block.getNumChannels(), dryTap.getNumChannels());
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        dryTap.copyFrom (channel, 0, block.getChannelPointer ((size_t) channel), numSamples);
+
+    dryTapValid = true;
+}
@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    Low-pass, gain, delay and distortion run as one fused pass.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainLayout.h"
+#include "FilterCoefficients.h"
+#include "MultiChannelBiquad.h"
+#include "DelayEngine.h"
+#include "DistortionStage.h"
+#include "DspLoadMeter.h"
+
+//==============================================================================
+/**
+    The effect stages that follow file playback: gain, then the low-pass filter,
+    the feedback delay with its dry/wet mix, and distortion in the order given
+    by a ChainLayout.
+
+    Instead of walking the whole host buffer once per stage, process() takes the
+    block in sub-blocks of subBlockSize samples and runs every stage over each
+    one before moving on. The audio stays in L1 across the chain, however large
+    the host buffer is.
+
+    Gain comes first. It commutes with the filter, so the default layout sounds
+    as the old fixed filter-gain-delay-distortion order did. Every ordering of
+    up to one filter, delay and distortion, bypassed modules left out, has its
+    own instantiation of processFixed(), so the modules are called directly
+    with no per-module dispatch. Layouts with duplicates go through a short
+    loop that switches once per module per sub-block. A bypassed module is not
+    in the list at all, so it costs nothing.
+
+    setLayout() may be called from any thread but the audio thread. A delay
+    line is only allocated once a layout has that delay in it, before the layout
+    is published, so a duplicate delay costs no memory until it's used. The
+    audio thread picks the new layout up at the start of the next block and
+    resets any module that was not running before, so it doesn't replay stale
+    state; for a delay that is cheap, since its line is only cleared as far
+    back as it reads.
+
+    process() also times each module for the DSP load meter. It reads the
+    cycle counter once at every stage boundary, a handful of reads per
+    sub-block. The totals for the last block are in getStageTicks().
+
+    The delay mix is done here instead of with juce::dsp::DryWetMixer, which
+    always reads its dry buffer from the start and so can't be fed in pieces.
+    The mixing rule and 50 ms ramp are the same. A delay's dry half is the
+    signal as the last delay or distortion before it left it, or the host input
+    captured by pushDrySamples() if there is none. A filter in between stays on
+    the wet side, so the default filter-delay-distortion order mixes against the
+    unfiltered input as it always has, while distortion-delay keeps the
+    distortion at mix 0 and a second delay crossfades against the first one's
+    output. The copy is only taken where a later delay will read it.
+*/
+class EffectChain
+{
+public:
+    /** Multiple of the filter's coefficient update interval, so coefficient ramps land where they used to. */
+    static constexpr int subBlockSize = 64;
+
+    EffectChain();
+
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels, int maximumDelayInSamples);
+    void reset() noexcept;
+
+    //==============================================================================
+    /** Allocates the delay lines the layout needs, so not real-time safe. */
+    void setLayout (const ChainLayout& newLayout);
+    ChainLayout getLayout() const noexcept                      { return ChainLayout::unpack (pendingLayout.load (std::memory_order_acquire)); }
+
+    /** Called once per block, before process(). */
+    void setFilter (float cutoffHz, float resonance) noexcept      { filterCoefficients.setTarget (cutoffHz, resonance); }
+    void setGainDecibels (float gainDb) noexcept;
+    void setDelayMix (float wetProportion) noexcept;
+
+    /** Applies fn to every delay or distortion instance, running or not, so a duplicate starts with the same settings. */
+    template <typename Fn> void forEachDelay (Fn&& fn)              { for (auto& d : delays) fn (d); }
+    template <typename Fn> void forEachDistortion (Fn&& fn)         { for (auto& d : distortions) fn (d); }
+
+    void setFilterKernel (MultiChannelBiquad::Kernel kernel) noexcept;
+    MultiChannelBiquad::Kernel getFilterKernel() const noexcept         { return filters[0].getKernel(); }
+
+    /** Total latency of the distortion stages in the current layout. */
+    int getLatencySamples() const noexcept;
+
+    //==============================================================================
+    /** Keeps a copy of the signal the delay mix uses as its dry half. Call before
+        anything overwrites the block, then process() the same number of samples.
+    */
+    void pushDrySamples (const juce::dsp::AudioBlock<float>& input) noexcept;
+
+    /** Runs the whole chain in place. */
+    void process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /** Time spent in each stage during the last process(); only the chain's own stages are non-zero. */
+    const DspLoadMeter::StageTicks& getStageTicks() const noexcept      { return stageTicks; }
+
+private:
+    using Module = ChainLayout::Module;
+    using SubBlockProcessor = void (EffectChain::*) (juce::dsp::AudioBlock<float>&, int);
+
+    struct Stage
+    {
+        Module module;
+        int instance;
+    };
+
+    void allocateDelayLines (const ChainLayout& layout);
+    void updateLayout() noexcept;
+    void updateLatency() noexcept;
+    SubBlockProcessor findSpecialisedProcessor() const noexcept;
+
+    template <Module... modules>
+    void processFixed (juce::dsp::AudioBlock<float>& block, int offset) noexcept;
+    void processGeneric (juce::dsp::AudioBlock<float>& block, int offset) noexcept;
+
+    template <Module module>
+    void processModule (juce::dsp::AudioBlock<float>& block, int offset, int instance) noexcept;
+
+    static DspLoadMeter::Stage getMeterStage (Module module) noexcept;
+    void endStage (DspLoadMeter::Stage stage) noexcept;
+
+    void advanceFilterCoefficients (int numSamples) noexcept;
+    void advanceSmoothers (int numSamples) noexcept;
+    void applyGain (const juce::dsp::AudioBlock<float>& block) noexcept;
+    void mixDelay (const juce::dsp::AudioBlock<float>& block, int offset) noexcept;
+    void captureDryTap (const juce::dsp::AudioBlock<float>& block) noexcept;
+    void setTarget (juce::LinearSmoothedValue<float>& value, float target) const noexcept;
+
+    static constexpr auto maxInstances = (size_t) ChainLayout::maxInstancesPerModule;
+
+    std::atomic<juce::uint32> pendingLayout;
+    juce::uint32 activeLayout = 0;
+    std::array<Stage, ChainLayout::maxSlots> stages;
+    int numStages = 0;
+    SubBlockProcessor processStages = nullptr;
+    std::atomic<int> latencySamples { 0 };
+
+    std::array<MultiChannelBiquad, maxInstances> filters;
+    LowPassCoefficientEngine filterCoefficients;
+
+    // Coefficients for each updateInterval piece of the current sub-block, shared by every filter instance.
+    static constexpr int maxFilterPieces = subBlockSize / LowPassCoefficientEngine::updateInterval;
+    std::array<BiquadCoefficients, maxFilterPieces> pieceCoefficients;
+    int numFilterPieces = 0;
+    BiquadCoefficients latestCoefficients;
+
+    juce::LinearSmoothedValue<float> gain;
+
+    std::array<DelayEngine, maxInstances> delays;
+    juce::CriticalSection delayLineLock;    // never taken on the audio thread
+    juce::AudioBuffer<float> dryBuffer;
+
+    // The current sub-block's dry half for the next delay, once a stage has moved it on from dryBuffer.
+    juce::AudioBuffer<float> dryTap;
+    bool dryTapValid = false;
+    std::array<bool, maxInstances> delayFeedsTap {}, distortionFeedsTap {};
+    juce::LinearSmoothedValue<float> delayWet;
+    bool snapSmoothers = true;
+
+    std::array<DistortionStage, maxInstances> distortions;
+
+    // Per-sample values for the current sub-block, shared by every channel and instance; empty while settled.
+    float gainRamp[subBlockSize], wetRamp[subBlockSize], scratch[subBlockSize];
+    bool gainRamping = false, wetRamping = false;
+
+    DspLoadMeter::StageTicks stageTicks {};
+    DspLoadMeter::Ticks lastMark = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EffectChain)
+};
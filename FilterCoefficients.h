@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    Change-driven, allocation-free coefficient engine for the low-pass stage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Normalised biquad coefficients (a0 == 1): b0, b1, b2, a1, a2. */
+struct BiquadCoefficients
+{
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+
+    /** Same design as juce::dsp::IIR::Coefficients<float>::makeLowPass, but
+        written into plain storage instead of a new heap object.
+    */
+    static BiquadCoefficients makeLowPass (double sampleRate, float frequency, float Q) noexcept
+    {
+        jassert (sampleRate > 0.0);
+        jassert (Q > 0.0f);
+
+        frequency = juce::jlimit (1.0f, (float) (sampleRate * 0.49), frequency);
+
+        const auto n = 1.0 / std::tan (juce::MathConstants<double>::pi * frequency / sampleRate);
+        const auto nSquared = n * n;
+        const auto invQ = 1.0 / Q;
+        const auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+        BiquadCoefficients c;
+        c.b0 = (float) c1;
+        c.b1 = (float) (c1 * 2.0);
+        c.b2 = (float) c1;
+        c.a1 = (float) (c1 * 2.0 * (1.0 - nSquared));
+        c.a2 = (float) (c1 * (1.0 - invQ * n + nSquared));
+        return c;
+    }
+};
+
+//==============================================================================
+/** Tracks cutoff and resonance targets and only recomputes coefficients when
+    one of them moves.
+
+    Cutoff is smoothed multiplicatively (i.e. linearly in pitch) and Q linearly.
+    While either is ramping, a fresh coefficient set is produced every
+    updateInterval samples, so automation sweeps without zipper noise and a
+    parked knob costs nothing.
+*/
+class LowPassCoefficientEngine
+{
+public:
+    static constexpr int updateInterval = 32;
+
+    void prepare (double newSampleRate, double rampSeconds = 0.02) noexcept
+    {
+        sampleRate = newSampleRate;
+        cutoff.reset (sampleRate, rampSeconds);
+        resonance.reset (sampleRate, rampSeconds);
+        needsSnap = true;
+    }
+
+    /** Called once per block from the snapshot; cheap when nothing changed. */
+    void setTarget (float cutoffHz, float Q) noexcept
+    {
+        cutoffHz = juce::jmax (1.0f, cutoffHz);
+
+        if (needsSnap)
+        {
+            cutoff.setCurrentAndTargetValue (cutoffHz);
+            resonance.setCurrentAndTargetValue (Q);
+            needsSnap = false;
+            dirty = true;
+            return;
+        }
+
+        if (cutoffHz != cutoff.getTargetValue())
+            cutoff.setTargetValue (cutoffHz);
+
+        if (Q != resonance.getTargetValue())
+            resonance.setTargetValue (Q);
+    }
+
+    bool isSmoothing() const noexcept     { return cutoff.isSmoothing() || resonance.isSmoothing(); }
+
+    /** Advances the ramps by numSamples and recomputes the coefficients if they
+        moved. Returns true when get() holds a new set that must be applied.
+    */
+    bool advance (int numSamples) noexcept
+    {
+        if (! (dirty || isSmoothing()))
+            return false;
+
+        const auto f = cutoff.skip (numSamples);
+        const auto q = resonance.skip (numSamples);
+
+        current = BiquadCoefficients::makeLowPass (sampleRate, f, q);
+        dirty = false;
+        return true;
+    }
+
+    const BiquadCoefficients& get() const noexcept    { return current; }
+
+private:
+    double sampleRate = 44100.0;
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> cutoff { 1000.0f };
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> resonance { 0.1f };
+
+    BiquadCoefficients current;
+    bool needsSnap = true, dirty = true;
+};
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    Playback source for uncompressed WAV/AIFF that reads straight from a
+    memory-mapped file, with background page prefetch ahead of the playhead.
+
+  ==============================================================================
+*/
+
+#include "MappedAudioFileSource.h"
+
+namespace
+{
+    constexpr int pageSize = 4096;
+
+    juce::int64 getSamplesPerPage (const juce::AudioFormatReader& r)
+    {
+        const auto bytesPerFrame = juce::jmax (1, (int) r.numChannels * (int) r.bitsPerSample / 8);
+        return juce::jmax (1, pageSize / bytesPerFrame);
+    }
+}
+
+//==============================================================================
+std::unique_ptr<juce::MemoryMappedAudioFormatReader> MappedAudioFileSource::createReaderFor (juce::AudioFormatManager& formatManager,
+                                                                                             const juce::File& file)
+{
+    auto* format = formatManager.findFormatForFileExtension (file.getFileExtension());
+
+    if (dynamic_cast<juce::WavAudioFormat*> (format) == nullptr
+         && dynamic_cast<juce::AiffAudioFormat*> (format) == nullptr)
+        return {};
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+
+    if (mapped == nullptr || mapped->lengthInSamples <= 0 || ! mapped->mapEntireFile())
+        return {};
+
+    // A partial mapping (e.g. a truncated or oddly chunked file) isn't worth special-casing.
+    if (mapped->getMappedSection() != juce::Range<juce::int64> (0, mapped->lengthInSamples))
+        return {};
+
+    return mapped;
+}
+
+MappedAudioFileSource::MappedAudioFileSource (std::unique_ptr<juce::MemoryMappedAudioFormatReader> r,
+                                              juce::TimeSliceThread& t,
+                                              double prefetchSeconds)
+    : reader (std::move (r)),
+      thread (t),
+      prefetchSamples ((juce::int64) (prefetchSeconds * reader->sampleRate)),
+      samplesPerPage (getSamplesPerPage (*reader))
+{
+    jassert (reader != nullptr);
+}
+
+MappedAudioFileSource::~MappedAudioFileSource()
+{
+    thread.removeTimeSliceClient (this);
+}
+
+//==============================================================================
+void MappedAudioFileSource::prepareToPlay (int, double)
+{
+    prefetchedFrom = prefetchedUpTo = playhead.load();
+    thread.addTimeSliceClient (this);
+}
+
+void MappedAudioFileSource::releaseResources()
+{
+    thread.removeTimeSliceClient (this);
+}
+
+void MappedAudioFileSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    // No real-time context here: behind a resampler this runs on the read-ahead thread, and
+    // played directly it runs inside processBlock(), which has already opened one.
+    if (info.numSamples <= 0)
+        return;
+
+    const auto length = reader->lengthInSamples;
+    const auto shouldLoop = looping.load (std::memory_order_relaxed);
+    auto position = playhead.load (std::memory_order_relaxed);
+
+    auto destStart = info.startSample;
+    auto remaining = info.numSamples;
+
+    while (remaining > 0)
+    {
+        if (shouldLoop && position >= length)
+            position %= length;
+
+        const auto available = (int) juce::jlimit ((juce::int64) 0, (juce::int64) remaining, length - position);
+
+        if (available == 0)
+        {
+            info.buffer->clear (destStart, remaining);
+            position += remaining;
+            break;
+        }
+
+        reader->read (info.buffer, destStart, available, position, true, true);
+
+        position += available;
+        destStart += available;
+        remaining -= available;
+    }
+
+    playhead.store (position, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void MappedAudioFileSource::setNextReadPosition (juce::int64 newPosition)
+{
+    playhead.store (newPosition, std::memory_order_relaxed);
+}
+
+juce::int64 MappedAudioFileSource::getNextReadPosition() const
+{
+    const auto position = playhead.load (std::memory_order_relaxed);
+    return looping.load (std::memory_order_relaxed) && reader->lengthInSamples > 0 ? position % reader->lengthInSamples
+                                                                                    : position;
+}
+
+juce::int64 MappedAudioFileSource::getTotalLength() const
+{
+    return reader->lengthInSamples;
+}
+
+bool MappedAudioFileSource::isLooping() const
+{
+    return looping.load (std::memory_order_relaxed);
+}
+
+void MappedAudioFileSource::setLooping (bool shouldLoop)
+{
+    looping.store (shouldLoop, std::memory_order_relaxed);
+}
+
+void MappedAudioFileSource::prefetch (juce::int64 startSample, juce::int64 numSamples) const
+{
+    const auto end = juce::jmin (reader->lengthInSamples, startSample + numSamples);
+
+    for (auto sample = juce::jmax ((juce::int64) 0, startSample); sample < end; sample += samplesPerPage)
+        reader->touchSample (sample);
+}
+
+//==============================================================================
+int MappedAudioFileSource::useTimeSlice()
+{
+    const auto length = reader->lengthInSamples;
+    auto position = playhead.load (std::memory_order_relaxed);
+
+    if (looping.load (std::memory_order_relaxed) && length > 0)
+        position %= length;
+
+    // A seek outside the window starts prefetching again from the new playhead.
+    if (position < prefetchedFrom || position > prefetchedUpTo)
+        prefetchedFrom = prefetchedUpTo = position;
+
+    prefetchedFrom = position;
+
+    const auto target = juce::jmin (length, position + prefetchSamples);
+
+    // Touch at most ~1MB per slice so one instance can't hog the shared thread.
+    const auto pagesPerSlice = (juce::int64) 256;
+    const auto end = juce::jmin (target, prefetchedUpTo + pagesPerSlice * samplesPerPage);
+
+    for (auto sample = prefetchedUpTo; sample < end; sample += samplesPerPage)
+        reader->touchSample (sample);
+
+    prefetchedUpTo = juce::jmax (prefetchedUpTo, end);
+
+    return prefetchedUpTo < target ? 1 : 20;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    Playback source for uncompressed WAV/AIFF that reads straight from a
+    memory-mapped file, with background page prefetch ahead of the playhead.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Plays a MemoryMappedAudioFormatReader with the whole file mapped, so each
+    block is converted directly out of the page cache with no stream read or
+    intermediate decode buffer. Several instances playing the same file share
+    the same physical pages.
+
+    A TimeSliceClient on the read-ahead thread touches every page in a window
+    ahead of the playhead, so page faults are taken there rather than in the
+    audio callback.
+*/
+class MappedAudioFileSource  : public juce::PositionableAudioSource,
+                               private juce::TimeSliceClient
+{
+public:
+    /** Returns a fully mapped reader for PCM WAV or AIFF files, or nullptr for
+        anything else (compressed formats, files that can't be mapped), in
+        which case the caller should use the streamed path instead.
+    */
+    static std::unique_ptr<juce::MemoryMappedAudioFormatReader> createReaderFor (juce::AudioFormatManager& formatManager,
+                                                                                 const juce::File& file);
+
+    MappedAudioFileSource (std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader,
+                           juce::TimeSliceThread& prefetchThread,
+                           double prefetchSeconds = 4.0);
+
+    ~MappedAudioFileSource() override;
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;
+
+    void setNextReadPosition (juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping (bool shouldLoop) override;
+
+    /** Touches every page in the given range; used to pre-buffer before playback starts. */
+    void prefetch (juce::int64 startSample, juce::int64 numSamples) const;
+
+    juce::AudioFormatReader& getReader() noexcept       { return *reader; }
+
+private:
+    int useTimeSlice() override;
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+    juce::TimeSliceThread& thread;
+
+    const juce::int64 prefetchSamples, samplesPerPage;
+
+    std::atomic<juce::int64> playhead { 0 };
+    std::atomic<bool> looping { false };
+
+    // Prefetch thread only.
+    juce::int64 prefetchedFrom = 0, prefetchedUpTo = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MappedAudioFileSource)
+};
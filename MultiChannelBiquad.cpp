@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    Second-order IIR filter that runs several channels side by side in SIMD
+    lanes, replacing the one-filter-per-channel ProcessorDuplicator.
+
+  ==============================================================================
+*/
+
+#include "MultiChannelBiquad.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define BIQUAD_SSE 1
+ #if defined (__AVX__)
+  #define BIQUAD_AVX 1
+ #endif
+#elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define BIQUAD_NEON 1
+#endif
+
+namespace
+{
+    // Same denormal guard juce::dsp::IIR::Filter applies to its state after each block.
+    inline void snapToZero (float& x) noexcept
+    {
+        if (! (x < -1.0e-8f || x > 1.0e-8f))
+            x = 0.0f;
+    }
+
+   #if BIQUAD_SSE
+    struct SSEOps
+    {
+        using Vec = __m128;
+        static constexpr int lanes = 4;
+
+        static Vec broadcast (float x) noexcept               { return _mm_set1_ps (x); }
+        static Vec load (const float* p) noexcept             { return _mm_load_ps (p); }
+        static Vec loadUnaligned (const float* p) noexcept    { return _mm_loadu_ps (p); }
+        static void store (float* p, Vec v) noexcept          { _mm_store_ps (p, v); }
+        static void storeUnaligned (float* p, Vec v) noexcept { _mm_storeu_ps (p, v); }
+        static Vec add (Vec a, Vec b) noexcept                { return _mm_add_ps (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                { return _mm_sub_ps (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                { return _mm_mul_ps (a, b); }
+    };
+   #endif
+
+   #if BIQUAD_AVX
+    struct AVXOps
+    {
+        using Vec = __m256;
+        static constexpr int lanes = 8;
+
+        static Vec broadcast (float x) noexcept               { return _mm256_set1_ps (x); }
+        static Vec load (const float* p) noexcept             { return _mm256_load_ps (p); }
+        static Vec loadUnaligned (const float* p) noexcept    { return _mm256_loadu_ps (p); }
+        static void store (float* p, Vec v) noexcept          { _mm256_store_ps (p, v); }
+        static void storeUnaligned (float* p, Vec v) noexcept { _mm256_storeu_ps (p, v); }
+        static Vec add (Vec a, Vec b) noexcept                { return _mm256_add_ps (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                { return _mm256_sub_ps (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                { return _mm256_mul_ps (a, b); }
+    };
+   #endif
+
+   #if BIQUAD_NEON
+    struct NEONOps
+    {
+        using Vec = float32x4_t;
+        static constexpr int lanes = 4;
+
+        static Vec broadcast (float x) noexcept               { return vdupq_n_f32 (x); }
+        static Vec load (const float* p) noexcept             { return vld1q_f32 (p); }
+        static Vec loadUnaligned (const float* p) noexcept    { return vld1q_f32 (p); }
+        static void store (float* p, Vec v) noexcept          { vst1q_f32 (p, v); }
+        static void storeUnaligned (float* p, Vec v) noexcept { vst1q_f32 (p, v); }
+        static Vec add (Vec a, Vec b) noexcept                { return vaddq_f32 (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                { return vsubq_f32 (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                { return vmulq_f32 (a, b); }
+    };
+   #endif
+}
+
+//==============================================================================
+MultiChannelBiquad::MultiChannelBiquad()
+{
+    kernel.store (getBestKernel());
+}
+
+void MultiChannelBiquad::prepare (int numChannels)
+{
+    jassert (numChannels <= maxChannels);
+
+    numPreparedChannels = numChannels;
+
+    const auto padded = ((numChannels + maxLanes - 1) / maxLanes) * maxLanes;
+    state1.assign ((size_t) padded, 0.0f);
+    state2.assign ((size_t) padded, 0.0f);
+}
+
+void MultiChannelBiquad::reset() noexcept
+{
+    std::fill (state1.begin(), state1.end(), 0.0f);
+    std::fill (state2.begin(), state2.end(), 0.0f);
+}
+
+bool MultiChannelBiquad::isKernelAvailable (Kernel k) noexcept
+{
+    switch (k)
+    {
+        case Kernel::scalar:  return true;
+       #if BIQUAD_SSE
+        case Kernel::sse:     return juce::SystemStats::hasSSE2();
+       #endif
+       #if BIQUAD_AVX
+        case Kernel::avx:     return juce::SystemStats::hasAVX();
+       #endif
+       #if BIQUAD_NEON
+        case Kernel::neon:    return true;
+       #endif
+        default:              return false;
+    }
+}
+
+MultiChannelBiquad::Kernel MultiChannelBiquad::getBestKernel() noexcept
+{
+    for (auto k : { Kernel::avx, Kernel::sse, Kernel::neon })
+        if (isKernelAvailable (k))
+            return k;
+
+    return Kernel::scalar;
+}
+
+void MultiChannelBiquad::setKernel (Kernel newKernel) noexcept
+{
+    kernel.store (isKernelAvailable (newKernel) ? newKernel : Kernel::scalar, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void MultiChannelBiquad::process (float* const* channels, int numChannels, int numSamples) noexcept
+{
+    jassert (numChannels <= numPreparedChannels);
+    numChannels = juce::jmin (numChannels, numPreparedChannels);
+
+    if (numChannels <= 0 || numSamples <= 0)
+        return;
+
+    // A single channel gains nothing from the interleave round trip.
+    if (numChannels == 1)
+    {
+        processScalar (channels, numChannels, numSamples);
+        return;
+    }
+
+    switch (kernel.load (std::memory_order_relaxed))
+    {
+       #if BIQUAD_AVX
+        case Kernel::avx:   processLanes<AVXOps>  (channels, numChannels, numSamples); break;
+       #endif
+       #if BIQUAD_SSE
+        case Kernel::sse:   processLanes<SSEOps>  (channels, numChannels, numSamples); break;
+       #endif
+       #if BIQUAD_NEON
+        case Kernel::neon:  processLanes<NEONOps> (channels, numChannels, numSamples); break;
+       #endif
+        default:            processScalar (channels, numChannels, numSamples); break;
+    }
+}
+
+void MultiChannelBiquad::processScalar (float* const* channels, int numChannels, int numSamples) noexcept
+{
+    const auto b0 = coefficients.b0, b1 = coefficients.b1, b2 = coefficients.b2;
+    const auto a1 = coefficients.a1, a2 = coefficients.a2;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* samples = channels[ch];
+        auto lv1 = state1[(size_t) ch];
+        auto lv2 = state2[(size_t) ch];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = samples[i];
+            const auto output = (input * b0) + lv1;
+            samples[i] = output;
+
+            lv1 = (input * b1) - (output * a1) + lv2;
+            lv2 = (input * b2) - (output * a2);
+        }
+
+        snapToZero (lv1);
+        snapToZero (lv2);
+        state1[(size_t) ch] = lv1;
+        state2[(size_t) ch] = lv2;
+    }
+}
+
+template <typename Ops>
+void MultiChannelBiquad::processLanes (float* const* channels, int numChannels, int numSamples) noexcept
+{
+    constexpr auto lanes = Ops::lanes;
+
+    const auto b0 = Ops::broadcast (coefficients.b0);
+    const auto b1 = Ops::broadcast (coefficients.b1);
+    const auto b2 = Ops::broadcast (coefficients.b2);
+    const auto a1 = Ops::broadcast (coefficients.a1);
+    const auto a2 = Ops::broadcast (coefficients.a2);
+
+    for (int group = 0; group < numChannels; group += lanes)
+    {
+        const auto lanesUsed = juce::jmin (lanes, numChannels - group);
+
+        auto lv1 = Ops::loadUnaligned (state1.data() + group);
+        auto lv2 = Ops::loadUnaligned (state2.data() + group);
+
+        // Idle lanes see silence with zero state, so they stay at exactly zero.
+        if (lanesUsed < lanes)
+            std::fill (scratch, scratch + chunkSize * lanes, 0.0f);
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto length = juce::jmin (chunkSize, numSamples - start);
+
+            for (int lane = 0; lane < lanesUsed; ++lane)
+            {
+                const auto* src = channels[group + lane] + start;
+
+                for (int i = 0; i < length; ++i)
+                    scratch[i * lanes + lane] = src[i];
+            }
+
+            for (int i = 0; i < length; ++i)
+            {
+                auto* frame = scratch + i * lanes;
+
+                const auto input = Ops::load (frame);
+                const auto output = Ops::add (Ops::mul (input, b0), lv1);
+                Ops::store (frame, output);
+
+                lv1 = Ops::add (Ops::sub (Ops::mul (input, b1), Ops::mul (output, a1)), lv2);
+                lv2 = Ops::sub (Ops::mul (input, b2), Ops::mul (output, a2));
+            }
+
+            for (int lane = 0; lane < lanesUsed; ++lane)
+            {
+                auto* dest = channels[group + lane] + start;
+
+                for (int i = 0; i < length; ++i)
+                    dest[i] = scratch[i * lanes + lane];
+            }
+        }
+
+        Ops::storeUnaligned (state1.data() + group, lv1);
+        Ops::storeUnaligned (state2.data() + group, lv2);
+
+        for (int lane = 0; lane < lanesUsed; ++lane)
+        {
+            snapToZero (state1[(size_t) (group + lane)]);
+            snapToZero (state2[(size_t) (group + lane)]);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Second-order IIR filter that runs several channels side by side in SIMD
+    lanes, replacing the one-filter-per-channel ProcessorDuplicator.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterCoefficients.h"
+
+//==============================================================================
+/**
+    Transposed direct form II biquad, numerically identical to
+    juce::dsp::IIR::Filter<float> (same operation order, no fused multiply-add),
+    with the per-sample recursion evaluated for up to eight channels at once.
+
+    Channels are copied in short chunks into an interleaved scratch buffer so
+    every sample of every lane is one aligned vector load; stereo fits in a
+    single SSE/NEON register.
+
+    The kernel is chosen at runtime with setKernel(), which may be called from
+    any thread; asking for one that was not compiled in or that the CPU lacks
+    falls back to the scalar path.
+*/
+class MultiChannelBiquad
+{
+public:
+    enum class Kernel
+    {
+        scalar,
+        sse,        // 4 lanes, x86
+        avx,        // 8 lanes, x86 builds compiled with AVX enabled
+        neon        // 4 lanes, ARM
+    };
+
+    MultiChannelBiquad();
+
+    /** Sizes the per-channel state; must be called before process(). */
+    void prepare (int numChannels);
+    void reset() noexcept;
+
+    void setCoefficients (const BiquadCoefficients& newCoefficients) noexcept   { coefficients = newCoefficients; }
+
+    static bool isKernelAvailable (Kernel kernel) noexcept;
+    static Kernel getBestKernel() noexcept;
+
+    void setKernel (Kernel newKernel) noexcept;
+    Kernel getKernel() const noexcept                                            { return kernel.load (std::memory_order_relaxed); }
+
+    /** Filters the channels in place. */
+    void process (float* const* channels, int numChannels, int numSamples) noexcept;
+
+    void process (juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        jassert (block.getNumChannels() <= maxChannels);
+
+        float* channels[maxChannels];
+        const auto numChannels = juce::jmin ((int) block.getNumChannels(), numPreparedChannels);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[ch] = block.getChannelPointer ((size_t) ch);
+
+        process (channels, numChannels, (int) block.getNumSamples());
+    }
+
+    static constexpr int maxLanes = 8;
+    static constexpr int maxChannels = 64;
+    static constexpr int chunkSize = 64;
+
+private:
+    void processScalar (float* const* channels, int numChannels, int numSamples) noexcept;
+
+    template <typename Ops>
+    void processLanes (float* const* channels, int numChannels, int numSamples) noexcept;
+
+    BiquadCoefficients coefficients;
+    std::atomic<Kernel> kernel { Kernel::scalar };
+
+    int numPreparedChannels = 0;
+
+    // Padded to a whole number of lane groups so vector loads never run off the end.
+    std::vector<float> state1, state2;
+
+    alignas (32) float scratch[chunkSize * maxLanes];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiChannelBiquad)
+};
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    Splits wide buses into channel groups and runs them on worker threads.
+
+  ==============================================================================
+*/
+
+#include "ParallelEffectChain.h"
+#include "RealtimeSafetyGuard.h"
+
+//==============================================================================
+ParallelEffectChain::ParallelEffectChain()
+    : layout (ChainLayout::getDefault().pack())
+{
+    setNumChannels (2);
+}
+
+void ParallelEffectChain::setNumChannels (int newNumChannels)
+{
+    numChannels = juce::jmax (1, newNumChannels);
+    const auto numGroups = (size_t) ((numChannels + channelsPerGroup - 1) / channelsPerGroup);
+
+    if (groups.size() == numGroups)
+        return;
+
+    std::vector<std::unique_ptr<EffectChain>> newGroups;
+
+    for (size_t i = 0; i < numGroups; ++i)
+    {
+        auto group = std::make_unique<EffectChain>();
+        group->setLayout (getLayout());
+
+        if (! groups.empty())
+            group->setFilterKernel (getFilterKernel());
+
+        newGroups.push_back (std::move (group));
+    }
+
+    groups = std::move (newGroups);
+}
+
+void ParallelEffectChain::prepare (double sampleRate, int maximumBlockSize, int newNumChannels, int maximumDelayInSamples)
+{
+    setNumChannels (newNumChannels);
+
+    for (int i = 0; i < getNumGroups(); ++i)
+    {
+        const auto channelsInGroup = juce::jmin (channelsPerGroup, numChannels - i * channelsPerGroup);
+        groups[(size_t) i]->prepare (sampleRate, maximumBlockSize, channelsInGroup, maximumDelayInSamples);
+    }
+
+    // The audio thread takes a share of the groups itself, and there's no point in more threads than cores.
+    const auto numWorkers = juce::jmin (getNumGroups() - 1, juce::SystemStats::getNumCpus() - 1);
+
+    if (isParallelProcessingEnabled() && numWorkers > 0)
+    {
+        const auto pin = isCorePinningEnabled();
+
+        if (pool.getNumWorkers() != numWorkers || poolPinned != pin)
+        {
+            pool.start (numWorkers, pin);
+            poolPinned = pin;
+        }
+    }
+    else
+    {
+        pool.stop();
+    }
+}
+
+void ParallelEffectChain::releaseResources()
+{
+    pool.stop();
+}
+
+void ParallelEffectChain::reset() noexcept
+{
+    forEachGroup ([] (EffectChain& g) { g.reset(); });
+}
+
+//==============================================================================
+void ParallelEffectChain::setLayout (const ChainLayout& newLayout)
+{
+    layout.store (newLayout.pack(), std::memory_order_release);
+    forEachGroup ([&newLayout] (EffectChain& g) { g.setLayout (newLayout); });
+}
+
+void ParallelEffectChain::setFilterKernel (MultiChannelBiquad::Kernel kernel) noexcept
+{
+    forEachGroup ([kernel] (EffectChain& g) { g.setFilterKernel (kernel); });
+}
+
+//==============================================================================
+juce::dsp::AudioBlock<float> ParallelEffectChain::getGroupBlock (const juce::dsp::AudioBlock<float>& block, int group) const noexcept
+{
+    const auto first = (size_t) (group * channelsPerGroup);
+    const auto count = juce::jmin ((size_t) channelsPerGroup, block.getNumChannels() - first);
+    return block.getSubsetChannelBlock (first, count);
+}
+
+void ParallelEffectChain::pushDrySamples (const juce::dsp::AudioBlock<float>& input) noexcept
+{
+    jassert ((int) input.getNumChannels() <= numChannels);
+
+    for (int i = 0; i < getNumGroups() && (size_t) (i * channelsPerGroup) < input.getNumChannels(); ++i)
+        groups[(size_t) i]->pushDrySamples (getGroupBlock (input, i));
+}
+
+void ParallelEffectChain::process (const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert ((int) block.getNumChannels() <= numChannels);
+
+    const auto numGroupsInBlock = juce::jmin (getNumGroups(), ((int) block.getNumChannels() + channelsPerGroup - 1) / channelsPerGroup);
+    numGroupsProcessed = numGroupsInBlock;
+
+    if (isParallelProcessingEnabled() && (int) block.getNumSamples() >= minParallelBlockSize)
+    {
+        currentBlock = block;
+        pool.run (processGroup, this, numGroupsInBlock);
+        return;
+    }
+
+    for (int i = 0; i < numGroupsInBlock; ++i)
+        groups[(size_t) i]->process (getGroupBlock (block, i));
+}
+
+DspLoadMeter::StageTicks ParallelEffectChain::getStageTicks() const noexcept
+{
+    DspLoadMeter::StageTicks total {};
+
+    // The pool's completion count orders the workers' writes before this read.
+    for (int i = 0; i < numGroupsProcessed; ++i)
+    {
+        const auto& ticks = groups[(size_t) i]->getStageTicks();
+
+        for (size_t stage = 0; stage < total.size(); ++stage)
+            total[stage] += ticks[stage];
+    }
+
+    return total;
+}
+
+void ParallelEffectChain::processGroup (void* context, int group) noexcept
+{
+    // Worker threads are part of the audio callback too.
+    const RealtimeSafetyGuard::ScopedRealtimeContext realtimeContext;
+
+    auto& self = *static_cast<ParallelEffectChain*> (context);
+    self.groups[(size_t) group]->process (self.getGroupBlock (self.currentBlock, group));
+}
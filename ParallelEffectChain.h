@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Splits wide buses into channel groups and runs them on worker threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EffectChain.h"
+#include "RealtimeWorkerPool.h"
+
+//==============================================================================
+/**
+    The effect chain for any number of channels, cut into groups of up to
+    channelsPerGroup channels. Each group is a complete EffectChain with its
+    own filter memory, delay lines and oversamplers. Every stage in the chain
+    is per-channel, so the groups never share data and can run on different
+    cores. A 7.1.4 bus makes two groups; third-order ambisonics makes two;
+    a 64-channel bus makes eight.
+
+    All groups get the same parameters in the same order, so their smoothers,
+    delay modulation and coefficient ramps move in step, and the output is
+    the same as processing every channel in one chain.
+
+    Groups go to a RealtimeWorkerPool only when that can pay for the hand-off:
+    there are at least two groups and the block holds at least
+    minParallelBlockSize samples. Otherwise, or with parallel processing
+    switched off, the groups run one after another on the audio thread.
+
+    Hosts that already spread plug-ins across cores can switch parallel
+    processing off. Switching it off takes effect at the next block. Switching
+    it back on needs the next prepare(), since that is where the worker threads
+    are started.
+*/
+class ParallelEffectChain
+{
+public:
+    /** One AVX register's worth of filter lanes. */
+    static constexpr int channelsPerGroup = 8;
+
+    /** Below this, waking the workers costs more than the groups take to process. */
+    static constexpr int minParallelBlockSize = 128;
+
+    ParallelEffectChain();
+
+    /** Rebuilds the groups if their number changes. New groups start with the
+        current layout and filter kernel; other settings must be applied again
+        afterwards, before prepare().
+    */
+    void setNumChannels (int numChannels);
+
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels, int maximumDelayInSamples);
+
+    /** Stops the worker threads. */
+    void releaseResources();
+
+    void reset() noexcept;
+
+    //==============================================================================
+    void setParallelProcessingEnabled (bool shouldBeEnabled) noexcept   { parallelEnabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+    bool isParallelProcessingEnabled() const noexcept                   { return parallelEnabled.load (std::memory_order_relaxed); }
+
+    /** Off by default. When on, workers are pinned to cores of their own from the next prepare(). */
+    void setCorePinningEnabled (bool shouldPin) noexcept                { corePinning.store (shouldPin, std::memory_order_relaxed); }
+    bool isCorePinningEnabled() const noexcept                          { return corePinning.load (std::memory_order_relaxed); }
+
+    int getNumGroups() const noexcept                                   { return (int) groups.size(); }
+    int getNumWorkers() const noexcept                                  { return pool.getNumWorkers(); }
+
+    //==============================================================================
+    void setLayout (const ChainLayout& newLayout);
+    ChainLayout getLayout() const noexcept                              { return ChainLayout::unpack (layout.load (std::memory_order_acquire)); }
+
+    void setFilter (float cutoffHz, float resonance) noexcept           { forEachGroup ([=] (EffectChain& g) { g.setFilter (cutoffHz, resonance); }); }
+    void setGainDecibels (float gainDb) noexcept                        { forEachGroup ([=] (EffectChain& g) { g.setGainDecibels (gainDb); }); }
+    void setDelayMix (float wetProportion) noexcept                     { forEachGroup ([=] (EffectChain& g) { g.setDelayMix (wetProportion); }); }
+
+    template <typename Fn> void forEachDelay (Fn&& fn)                  { forEachGroup ([&fn] (EffectChain& g) { g.forEachDelay (fn); }); }
+    template <typename Fn> void forEachDistortion (Fn&& fn)             { forEachGroup ([&fn] (EffectChain& g) { g.forEachDistortion (fn); }); }
+
+    void setFilterKernel (MultiChannelBiquad::Kernel kernel) noexcept;
+    MultiChannelBiquad::Kernel getFilterKernel() const noexcept         { return groups.front()->getFilterKernel(); }
+
+    /** Every group has the same layout and settings, so the same latency. */
+    int getLatencySamples() const noexcept                              { return groups.front()->getLatencySamples(); }
+
+    //==============================================================================
+    void pushDrySamples (const juce::dsp::AudioBlock<float>& input) noexcept;
+    void process (const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /** Stage times of the last process(), summed over the groups; CPU time, not wall-clock time, when they ran in parallel. */
+    DspLoadMeter::StageTicks getStageTicks() const noexcept;
+
+private:
+    template <typename Fn>
+    void forEachGroup (Fn&& fn)
+    {
+        for (auto& group : groups)
+            fn (*group);
+    }
+
+    juce::dsp::AudioBlock<float> getGroupBlock (const juce::dsp::AudioBlock<float>& block, int group) const noexcept;
+    static void processGroup (void* context, int group) noexcept;
+
+    std::vector<std::unique_ptr<EffectChain>> groups;
+    int numChannels = 0;
+
+    std::atomic<juce::uint32> layout;
+    std::atomic<bool> parallelEnabled { true };
+    std::atomic<bool> corePinning { false };
+    bool poolPinned = false;
+    RealtimeWorkerPool pool;
+
+    // The block being processed, read by the worker jobs.
+    juce::dsp::AudioBlock<float> currentBlock;
+    int numGroupsProcessed = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParallelEffectChain)
+};
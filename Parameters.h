@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    Parameter IDs and the per-block parameter snapshot used by processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+namespace ParamIDs
+{
+    constexpr auto play          = "Play";
+    constexpr auto gain          = "GAIN";
+    constexpr auto cutoff        = "cutoff";
+    constexpr auto resonance     = "resonance";
+    constexpr auto rate          = "RATE";
+    constexpr auto feedback      = "FEEDBACK";
+    constexpr auto mix           = "MIX";
+    constexpr auto delayInterp   = "DELAYINTERP";
+    constexpr auto modRate       = "MODRATE";
+    constexpr auto modDepth      = "MODDEPTH";
+    constexpr auto tempoSync     = "SYNC";
+    constexpr auto syncDivision  = "SYNCDIV";
+    constexpr auto distType      = "DISTTYPE";
+    constexpr auto threshold     = "THRESH";
+    constexpr auto distMix       = "DISTMIX";
+    constexpr auto oversampling  = "OVERSAMPLE";
+    constexpr auto oversamplingFilter = "OSFILTER";
+    constexpr auto antialiasing  = "ADAA";
+}
+
+//==============================================================================
+/** Plain copy of every parameter value, taken once at the top of processBlock
+    so the rest of the block never touches the value tree or a string key.
+*/
+struct ParameterSnapshot
+{
+    bool  play           = false;
+    float gainDb         = -20.0f;
+    float cutoff         = 100.0f;
+    float resonance      = 0.1f;
+    float rateMs         = 0.01f;
+    float feedbackDb     = -100.0f;
+    float delayMix       = 0.0f;
+    int   delayInterp    = 0;      // 0 = linear, 1 = Lagrange 3rd order, 2 = Thiran allpass
+    float modRateHz      = 0.5f;
+    float modDepthMs     = 0.0f;
+    bool  tempoSync      = false;
+    int   syncDivision   = 2;      // index into the Sync Division choices
+    int   distortionType = 0;      // DistortionStage::Type
+    float threshold      = 0.0f;
+    float distortionMix  = 0.0f;
+    int   oversampling   = 0;      // 0 = off, 1 = 2x, 2 = 4x, 3 = 8x
+    int   oversamplingFilter = 0;  // 0 = polyphase IIR, 1 = linear-phase FIR
+    int   antialiasing   = 0;      // 0 = off, 1 = first-order ADAA, 2 = second-order ADAA
+};
+
+//==============================================================================
+/** Holds the raw atomic value pointers for every parameter, looked up once at
+    construction, and builds a ParameterSnapshot from them without locking.
+*/
+class ParameterCache
+{
+public:
+    explicit ParameterCache (juce::AudioProcessorValueTreeState& state)
+        : play          (get (state, ParamIDs::play)),
+          gain          (get (state, ParamIDs::gain)),
+          cutoff        (get (state, ParamIDs::cutoff)),
+          resonance     (get (state, ParamIDs::resonance)),
+          rate          (get (state, ParamIDs::rate)),
+          feedback      (get (state, ParamIDs::feedback)),
+          mix           (get (state, ParamIDs::mix)),
+          delayInterp   (get (state, ParamIDs::delayInterp)),
+          modRate       (get (state, ParamIDs::modRate)),
+          modDepth      (get (state, ParamIDs::modDepth)),
+          tempoSync     (get (state, ParamIDs::tempoSync)),
+          syncDivision  (get (state, ParamIDs::syncDivision)),
+          distType      (get (state, ParamIDs::distType)),
+          threshold     (get (state, ParamIDs::threshold)),
+          distMix       (get (state, ParamIDs::distMix)),
+          oversampling  (get (state, ParamIDs::oversampling)),
+          oversamplingFilter (get (state, ParamIDs::oversamplingFilter)),
+          antialiasing  (get (state, ParamIDs::antialiasing))
+    {
+    }
+
+    ParameterSnapshot snapshot() const noexcept
+    {
+        constexpr auto order = std::memory_order_relaxed;
+
+        ParameterSnapshot s;
+        s.play           = play->load (order) >= 0.5f;
+        s.gainDb         = gain->load (order);
+        s.cutoff         = cutoff->load (order);
+        s.resonance      = resonance->load (order);
+        s.rateMs         = rate->load (order);
+        s.feedbackDb     = feedback->load (order);
+        s.delayMix       = mix->load (order);
+        s.delayInterp    = juce::roundToInt (delayInterp->load (order));
+        s.modRateHz      = modRate->load (order);
+        s.modDepthMs     = modDepth->load (order);
+        s.tempoSync      = tempoSync->load (order) >= 0.5f;
+        s.syncDivision   = juce::roundToInt (syncDivision->load (order));
+        s.distortionType = juce::roundToInt (distType->load (order));
+        s.threshold      = threshold->load (order);
+        s.distortionMix  = distMix->load (order);
+        s.oversampling   = juce::roundToInt (oversampling->load (order));
+        s.oversamplingFilter = juce::roundToInt (oversamplingFilter->load (order));
+        s.antialiasing   = juce::roundToInt (antialiasing->load (order));
+        return s;
+    }
+
+private:
+    static std::atomic<float>* get (juce::AudioProcessorValueTreeState& state, const char* id)
+    {
+        auto* value = state.getRawParameterValue (id);
+        jassert (value != nullptr);     // every ID above must exist in the layout
+        return value;
+    }
+
+    std::atomic<float>* play;
+    std::atomic<float>* gain;
+    std::atomic<float>* cutoff;
+    std::atomic<float>* resonance;
+    std::atomic<float>* rate;
+    std::atomic<float>* feedback;
+    std::atomic<float>* mix;
+    std::atomic<float>* delayInterp;
+    std::atomic<float>* modRate;
+    std::atomic<float>* modDepth;
+    std::atomic<float>* tempoSync;
+    std::atomic<float>* syncDivision;
+    std::atomic<float>* distType;
+    std::atomic<float>* threshold;
+    std::atomic<float>* distMix;
+    std::atomic<float>* oversampling;
+    std::atomic<float>* oversamplingFilter;
+    std::atomic<float>* antialiasing;
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterCache)
+};
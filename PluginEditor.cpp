@@ -11,19 +11,26 @@
 
 //==============================================================================
 AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioProcessor2AudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), presetBar (p.getStatePresets()), audioProcessor (p),
+      waveform (p),
+      analyserView (p.getAnalyserTap(), p.apvts),
+      loadView (p.getLoadMeter(), p.getLoadHistory())
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
 
-    juce::Timer::startTimerHz(60);
+    addAndMakeVisible(background);
+    addAndMakeVisible(presetBar);
 
     playButton.setToggleState(false, juce::NotificationType::dontSendNotification);
     playButton.setClickingTogglesState(true);
-    //playButton.onClick = [this]() { audioProcessor.timerCallback(); };
+    playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green);
+    playButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::red);
+    playButton.onClick = [this]() { updatePlayButton(); };
     addAndMakeVisible(playButton);
 
-    buttonState = std::make_unique <juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.params, "Play", playButton);
+    buttonState = std::make_unique <juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.apvts, ParamIDs::play, playButton);
+    updatePlayButton();
 
     openButton.onClick = [this]() { audioProcessor.openFile(); };
     addAndMakeVisible(openButton);
@@ -32,12 +39,11 @@ AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioP
     mGainSlider.setTextBoxStyle(juce::Slider::NoTextBox, true, 50, 20);
     GainLabel.setText("Volume", juce::dontSendNotification);
     //GainLabel.attachToComponent(&mGainSlider, false);
-    mGainSlider.setRange(-60.0f, 0.0f, 0.01f);
-    mGainSlider.setValue(-20.0f);
-    mGainSlider.addListener(this);
     addAndMakeVisible(mGainSlider);
     addAndMakeVisible(GainLabel);
 
+    gainValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, ParamIDs::gain, mGainSlider);
+
         filterCutoffDial.setSliderStyle(juce::Slider::SliderStyle::LinearVertical);
         filterCutoffDial.setRange(20.0f, 20000.0f, 0.01f);
         filterCutoffDial.setValue(20000.0f);
@@ -58,8 +64,8 @@ AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioP
         addAndMakeVisible(Reslabel);
         addAndMakeVisible(&filterResDial);
     
-    filterCutoffValue = new juce::AudioProcessorValueTreeState::SliderAttachment(audioProcessor.tree, "cutoff", filterCutoffDial);
-    filterResValue = new juce::AudioProcessorValueTreeState::SliderAttachment(audioProcessor.tree, "resonance", filterResDial);
+    filterCutoffValue = new juce::AudioProcessorValueTreeState::SliderAttachment(audioProcessor.apvts, ParamIDs::cutoff, filterCutoffDial);
+    filterResValue = new juce::AudioProcessorValueTreeState::SliderAttachment(audioProcessor.apvts, ParamIDs::resonance, filterResDial);
     //filterCutoffDial.setSkewFactorFromMidPoint(1000.0f);
 
     getLookAndFeel().setColour(juce::Slider::ColourIds::thumbColourId, juce::Colour::fromRGB(242, 202, 16));
@@ -97,9 +103,9 @@ AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioP
 
     auto& apvts = audioProcessor.apvts;
 
-    rateSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter("RATE"), rateSlider);
-    feedbackSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter("FEEDBACK"), feedbackSlider);
-    mixSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter("MIX"), mixSlider);
+    rateSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter(ParamIDs::rate), rateSlider);
+    feedbackSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter(ParamIDs::feedback), feedbackSlider);
+    mixSliderAttachment = std::make_unique<Attachment>(*apvts.getParameter(ParamIDs::mix), mixSlider);
 
     /*gSlider.setSliderStyle(SliderStyle::LinearVertical);
     gSlider.setRange(0.0f, 1.0f, 0.0f);
@@ -109,24 +115,28 @@ AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioP
         disChoice.addItem("Hard Clip", 1);
         disChoice.addItem("Soft Clip", 2);
         disChoice.addItem("Half-Wave Rect", 3);
-        disChoice.setSelectedId(1);
-        disChoice.addListener(this);
+        disChoice.addItem("Tanh", 4);
+        disChoice.addItem("Cubic", 5);
+        disChoice.addItem("Asymmetric", 6);
+        disChoice.addItem("Foldback", 7);
 
         addAndMakeVisible(&Threshold);
-        Threshold.setRange(0.0f, 1.0f, 0.001);
-        Threshold.addListener(this);
-
         addAndMakeVisible(&Mix);
-        Mix.setRange(0.0f, 1.0f, 0.001);
-        Mix.addListener(this);
+
+    disChoiceValue = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, ParamIDs::distType, disChoice);
+    thresholdValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ParamIDs::threshold, Threshold);
+    distMixValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ParamIDs::distMix, Mix);
     
 
     addAndMakeVisible(&theme);
     theme.addItem("Default", 4);
     theme.addItem("Dark", 5);
     theme.addItem("Light", 6);
-    theme.setSelectedId(4);
+    themechoice = audioProcessor.getEditorTheme();
+    theme.setSelectedId(themechoice, juce::dontSendNotification);
+    background.setTheme(themechoice);
     theme.addListener(this);
+    audioProcessor.addChangeListener(this);
 
     filt.setText("Filter", juce::dontSendNotification);
     dist.setText("Distortion", juce::dontSendNotification);
@@ -138,89 +148,37 @@ AudioProcessor2AudioProcessorEditor::AudioProcessor2AudioProcessorEditor (AudioP
     addAndMakeVisible(del);
     addAndMakeVisible(themelabel);
 
-    setSize (500, 550);
+    const auto tabColour = juce::Colour::fromRGB(30, 34, 38);
+    addAndMakeVisible(waveform);
+
+    bottomTabs.addTab("Analyser", tabColour, &analyserView, false);
+    bottomTabs.addTab("DSP load", tabColour, &loadView, false);
+    addAndMakeVisible(bottomTabs);
+
+    // The background covers every pixel, so the editor itself never paints.
+    setOpaque(true);
+    setResizable(false, false);
+    setSize (500, 550 + waveformHeight + bottomPanelHeight);
 }
 
 AudioProcessor2AudioProcessorEditor::~AudioProcessor2AudioProcessorEditor()
 {
+    audioProcessor.removeChangeListener(this);
 }
 
 //==============================================================================
 
-void AudioProcessor2AudioProcessorEditor::timerCallback()
+void AudioProcessor2AudioProcessorEditor::updatePlayButton()
 {
-    if (playButton.getToggleState() == false)
-    {
-        playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green);
-        playButton.setButtonText("Play");
-    }
-    else
-    {
-        playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red);
-        playButton.setButtonText("Stop");
-    }
-}
-
-
-void AudioProcessor2AudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-
-    //g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-    
-    //g.fillAll(juce::Colours::springgreen);
-
-    if (themechoice == 4)
-    {
-        g.fillAll(juce::Colours::springgreen);
-    }
-
-    if (themechoice == 5)
-    {
-        g.fillAll(juce::Colours::black);
-    }
-    
-    if (themechoice == 6)
-    {
-        g.fillAll(juce::Colours::orange);
-    }
-    
-    setResizable(false, false);
-
-
-    //g.setColour (juce::Colours::beige);
-    g.setFont (15.0f);
-
-    //juce::Rectangle<int> titleArea(0, 10, getWidth(), 20);
-
-    //g.fillAll(juce::Colours::black);
-    //g.setColour(juce::Colours::white);
-    //g.drawText("Filter", titleArea, juce::Justification::centredTop);
-    //g.drawText("Cutoff", 46, 70, 50, 25, juce::Justification::centredLeft);
-    //g.drawText("Resonance", 107, 70, 70, 25, juce::Justification::centredLeft);
-    
-    juce::Rectangle <float> area(50, 185, 145, 165);
-
-    g.setColour(juce::Colours::red);
-    g.drawRoundedRectangle(area, 1.0f, 2.0f);
-
-    juce::Rectangle <float> drect(240, 185, 210, 165);
-
-    g.setColour(juce::Colours::red);
-    g.drawRoundedRectangle(drect, 1.0f, 2.0f);
-    
-    juce::Rectangle <float> dlrect(50, 380, 400, 145);
-
-    g.setColour(juce::Colours::red);
-    g.drawRoundedRectangle(dlrect, 1.0f, 2.0f);
-
-    //g.drawFittedText ("", getLocalBounds(), juce::Justification::centred, 1);
-
+    // The colours come from buttonColourId and buttonOnColourId; only the label needs setting.
+    playButton.setButtonText(playButton.getToggleState() ? "Stop" : "Play");
 }
 
 void AudioProcessor2AudioProcessorEditor::resized()
 {
     juce::Rectangle<int> bounds = getLocalBounds();
+
+    background.setBounds(bounds);
     juce::FlexBox flexbox;
 
     flexbox.flexDirection = juce::FlexBox::Direction::column;
@@ -232,6 +190,7 @@ void AudioProcessor2AudioProcessorEditor::resized()
     //flexbox.items.add(juce::FlexItem(50, 50, playButton));
     //flexbox.performLayout(bounds);
 
+    presetBar.setBounds(10, 2, 480, 26);
     openButton.setBounds(190, 30, 100, 25);
     playButton.setBounds(190, 70, 100, 25);
     mGainSlider.setBounds(170, 120, 145, 20);
@@ -284,35 +243,63 @@ void AudioProcessor2AudioProcessorEditor::resized()
     del.setBounds(50, 357, 100, 25);
     themelabel.setBounds(350, 90, 100, 25);
 
+    auto lowerArea = getLocalBounds().removeFromBottom(waveformHeight + bottomPanelHeight);
+    waveform.setBounds(lowerArea.removeFromTop(waveformHeight).reduced(50, 8));
+    bottomTabs.setBounds(lowerArea);
+
     //effect.setBounds(310, 90, 100, 30);
 
 }
 
 void AudioProcessor2AudioProcessorEditor::comboBoxChanged(juce::ComboBox* comboBoxThatWasChanged)
 {
+    // The distortion menu is driven by its parameter attachment; only the theme is handled here.
+    if (comboBoxThatWasChanged == &theme)
+    {
+        themechoice = theme.getSelectedId();
+        background.setTheme(themechoice);
+        audioProcessor.setEditorTheme(themechoice);
+    }
+}
 
-    audioProcessor.menuChoice = comboBoxThatWasChanged->getSelectedId();
+void AudioProcessor2AudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    // A restored state may carry a different theme; the menu's listener applies it.
+    theme.setSelectedId(audioProcessor.getEditorTheme());
+}
 
-    themechoice = comboBoxThatWasChanged->getSelectedId();
 
-   
+//==============================================================================
+EditorBackground::EditorBackground()
+{
+    setOpaque(true);
+    setInterceptsMouseClicks(false, false);
+    setBufferedToImage(true);
 }
 
-void AudioProcessor2AudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
+void EditorBackground::setTheme(int themeId)
 {
-    if (slider == &mGainSlider)
-    {
-        audioProcessor.mGain = mGainSlider.getValue();
-    }
+    if (themeId == theme)
+        return;
 
-    if (&Mix == slider)
-    {
-        audioProcessor.mix = Mix.getValue();
-    }
-    if (&Threshold == slider)
-    {
-        audioProcessor.thresh = Threshold.getValue();
-    }   
+    theme = themeId;
+    repaint();      // throws the cached image away
+}
+
+void EditorBackground::paint(juce::Graphics& g)
+{
+    if (theme == 5)
+        g.fillAll(juce::Colours::black);
+    else if (theme == 6)
+        g.fillAll(juce::Colours::orange);
+    else
+        g.fillAll(juce::Colours::springgreen);
+
+    // Filter, distortion and delay sections.
+    g.setColour(juce::Colours::red);
+    g.drawRoundedRectangle(juce::Rectangle<float>(50, 185, 145, 165), 1.0f, 2.0f);
+    g.drawRoundedRectangle(juce::Rectangle<float>(240, 185, 210, 165), 1.0f, 2.0f);
+    g.drawRoundedRectangle(juce::Rectangle<float>(50, 380, 400, 145), 1.0f, 2.0f);
 }
 
 
@@ -320,23 +307,18 @@ void AudioProcessor2AudioProcessorEditor::sliderValueChanged(juce::Slider* slide
 
 //=============================================================================================================
 
-/*StateComponent::StateComponent(StateAB& sab, StatePresets& sp)
-    : procStateAB{ sab },
-    procStatePresets{ sp },
-    toggleABButton{ "A-B" },
-    copyABButton{ "Copy" },
+StateComponent::StateComponent(StatePresets& sp)
+    : procStatePresets{ sp },
     savePresetButton{ "Save preset" },
     deletePresetButton{ "Delete preset" }
 {
-    addAndMakeVisible(toggleABButton);
-    addAndMakeVisible(copyABButton);
-    toggleABButton.addListener(this);
-    copyABButton.addListener(this);
+    addAndMakeVisible(searchBox);
+    searchBox.setTextToShowWhenEmpty("Search presets", juce::Colour(0xff808080));
+    searchBox.onTextChange = [this] { refreshPresetBox(); };
 
     addAndMakeVisible(presetBox);
     presetBox.setTextWhenNothingSelected("Load preset...");
-    refreshPresetBox();
-    ifPresetActiveShowInBox();
+    presetBox.setTextWhenNoChoicesAvailable("No matching presets");
     presetBox.addListener(this);
 
     addAndMakeVisible(savePresetButton);
@@ -344,42 +326,36 @@ void AudioProcessor2AudioProcessorEditor::sliderValueChanged(juce::Slider* slide
     addAndMakeVisible(deletePresetButton);
     deletePresetButton.addListener(this);
 
-
-    toggleABButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xff373737));    // possibly set in custom Look instead???
-    toggleABButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff808080));
-    copyABButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xff373737));
-    copyABButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff808080));
     savePresetButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xff373737));
     savePresetButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff808080));
     deletePresetButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xff373737));
     deletePresetButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff808080));
 
-    //setSize (400, 200); // remember to set before xtor finished
+    // The first editor opened in the process is what reads the library's index.
+    procStatePresets.getLibrary().addChangeListener(this);
+    refreshPresetBox();
 }
 
-void StateComponent::paint(juce::Graphics& /)
+StateComponent::~StateComponent()
 {
-    //g.fillAll (Colours::lightgrey);
+    procStatePresets.getLibrary().removeChangeListener(this);
 }
 
 void StateComponent::resized()
 {
     juce::Rectangle<int> r(getLocalBounds());
 
-    const int numComponents{ 6 };
-    const int componentWidth{ getWidth() / numComponents };
+    const int numColumns{ 7 };
+    const int columnWidth{ getWidth() / numColumns };
 
-    toggleABButton.setBounds(r.removeFromLeft(componentWidth).reduced(2));
-    copyABButton.setBounds(r.removeFromLeft(componentWidth).reduced(2));
-    presetBox.setBounds(r.removeFromLeft(componentWidth * 2).reduced(2));
-    savePresetButton.setBounds(r.removeFromLeft(componentWidth).reduced(2));
-    deletePresetButton.setBounds(r.removeFromLeft(componentWidth).reduced(2));
+    searchBox.setBounds(r.removeFromLeft(columnWidth * 2).reduced(2));
+    presetBox.setBounds(r.removeFromLeft(columnWidth * 3).reduced(2));
+    savePresetButton.setBounds(r.removeFromLeft(columnWidth).reduced(2));
+    deletePresetButton.setBounds(r.reduced(2));
 }
 
 void StateComponent::buttonClicked(juce::Button* clickedButton)
 {
-    if (clickedButton == &toggleABButton)     procStateAB.toggleAB();
-    if (clickedButton == &copyABButton)       procStateAB.copyAB();
     if (clickedButton == &savePresetButton)   savePresetAlertWindow();
     if (clickedButton == &deletePresetButton) deletePresetAndRefresh();
 }
@@ -387,55 +363,62 @@ void StateComponent::buttonClicked(juce::Button* clickedButton)
 void StateComponent::comboBoxChanged(juce::ComboBox* changedComboBox)
 {
     const int selectedId{ changedComboBox->getSelectedId() };
-    procStatePresets.loadPreset(selectedId);
+
+    // Item IDs are preset IDs; 0 means the menu was just cleared.
+    if (selectedId != 0 && selectedId != procStatePresets.getCurrentPresetId())
+    {
+        procStatePresets.loadPreset(selectedId);
+        deletePresetButton.setEnabled(procStatePresets.getCurrentPresetId() != 0);
+    }
 }
 
-void populateComboBox(juce::ComboBox& comboBox, const juce::StringArray& listItems)
+void StateComponent::changeListenerCallback(juce::ChangeBroadcaster*)
 {
-    for (int i = 0; i < listItems.size(); ++i)
-        comboBox.addItem(listItems[i], i + 1); // 1-indexed ID for ComboBox
+    refreshPresetBox();
 }
 
 void StateComponent::refreshPresetBox()
 {
-    presetBox.clear();
-    juce::StringArray presetNames{ procStatePresets.getPresetNames() };
+    presetBox.clear(juce::dontSendNotification);
 
-    populateComboBox(presetBox, presetNames);
-}
+    for (const auto& preset : procStatePresets.getLibrary().search(searchBox.getText()))
+        presetBox.addItem(preset.name, preset.id);
 
-void StateComponent::ifPresetActiveShowInBox()
-{
-    const int currentPreset{ procStatePresets.getCurrentPresetId() };
-    const int numPresets{ procStatePresets.getNumPresets() };
-    if (1 <= currentPreset && currentPreset <= numPresets)
-        presetBox.setSelectedId(currentPreset);
+    presetBox.setSelectedId(procStatePresets.getCurrentPresetId(), juce::dontSendNotification);
+    deletePresetButton.setEnabled(procStatePresets.getCurrentPresetId() != 0);
 }
 
 void StateComponent::deletePresetAndRefresh()
 {
+    // The library's change message refreshes the menu.
     procStatePresets.deletePreset();
-    refreshPresetBox();
+    deletePresetButton.setEnabled(false);
 }
 
 void StateComponent::savePresetAlertWindow()
 {
-    enum choice { ok, cancel };
+    enum choice { cancel, ok };
 
-    juce::AlertWindow alert{ "Save preset...", "", juce::AlertWindow::AlertIconType::NoIcon };
-    alert.addTextEditor("presetEditorID", "Enter preset name");
-    alert.addButton("OK", choice::ok, juce::KeyPress(juce::KeyPress::returnKey, 0, 0));
-    alert.addButton("Cancel", choice::cancel, juce::KeyPress(juce::KeyPress::escapeKey, 0, 0));
+    const auto current = procStatePresets.getLibrary().getPreset(procStatePresets.getCurrentPresetId());
 
-    if (alert.runModalLoop() == choice::ok)                                     // LEAKS when quit while open !!!
+    // Asynchronous, so closing the editor while it's open can't leave it dangling.
+    auto* alert = new juce::AlertWindow{ "Save preset...", "A preset with the same name is replaced.", juce::AlertWindow::NoIcon };
+    alert->addTextEditor("presetEditorID", current.name, "Name");
+    alert->addTextEditor("tagsEditorID", current.tags.joinIntoString(", "), "Tags, separated by commas");
+    alert->addButton("OK", choice::ok, juce::KeyPress(juce::KeyPress::returnKey, 0, 0));
+    alert->addButton("Cancel", choice::cancel, juce::KeyPress(juce::KeyPress::escapeKey, 0, 0));
+
+    juce::Component::SafePointer<StateComponent> safeThis{ this };
+
+    alert->enterModalState(true, juce::ModalCallbackFunction::create([safeThis, alert](int result)
     {
-       juce::String presetName{ alert.getTextEditorContents("presetEditorID") };
+        if (result != choice::ok || safeThis == nullptr)
+            return;
 
-        procStatePresets.savePreset(presetName);
-        refreshPresetBox();
-        presetBox.setSelectedId(procStatePresets.getNumPresets());
-    }
+        const auto presetName = alert->getTextEditorContents("presetEditorID");
+        const auto tags = juce::StringArray::fromTokens(alert->getTextEditorContents("tagsEditorID"), ",", "");
+
+        safeThis->procStatePresets.savePreset(presetName, tags);
+        safeThis->refreshPresetBox();
+    }), true);
 }
- // namespace state
- 
-*/
\ No newline at end of file
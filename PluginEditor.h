@@ -10,27 +10,90 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "DspLoadView.h"
+#include "AnalyserView.h"
+#include "WaveformView.h"
 
 //==============================================================================
 /**
+    The theme fill and the section outlines behind the controls. Nothing in it
+    moves, so it is buffered to an image. JUCE redraws that image only when
+    setTheme() repaints it or the component is resized. Controls repainting
+    over it just blit the cached pixels.
 */
-class AudioProcessor2AudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Timer, public juce::Slider::Listener, 
-                                            private juce::ComboBox::Listener
+class EditorBackground  : public juce::Component
+{
+public:
+    EditorBackground();
+
+    void paint (juce::Graphics&) override;
+
+    /** One of the theme menu's item IDs. */
+    void setTheme (int themeId);
+
+private:
+    int theme = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EditorBackground)
+};
+
+//==============================================================================
+/**
+    The preset bar: a search box that narrows the preset menu by name and
+    tags, the menu itself, and save and delete. The menu is filled from the
+    shared library's index when the editor opens. It follows that library, so
+    a preset saved in one instance shows up in the others straight away.
+*/
+class StateComponent  : public juce::Component,
+                        private juce::Button::Listener,
+                        private juce::ComboBox::Listener,
+                        private juce::ChangeListener
+{
+public:
+    explicit StateComponent(StatePresets& sp);
+    ~StateComponent() override;
+
+    void resized() override;
+
+private:
+    StatePresets& procStatePresets;
+
+    juce::TextEditor searchBox;
+    juce::ComboBox   presetBox;
+    juce::TextButton savePresetButton;
+    juce::TextButton deletePresetButton;
+
+    void buttonClicked(juce::Button* clickedButton) override;
+    void comboBoxChanged(juce::ComboBox* changedComboBox) override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    void refreshPresetBox();
+    void deletePresetAndRefresh();
+    void savePresetAlertWindow();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StateComponent)
+};
+
+//==============================================================================
+/**
+    Nothing here polls. The play button's look follows its parameter through
+    the button attachment, which fires onClick for host and automation
+    changes as well as for clicks. The background is cached; the views in
+    the bottom tabs repaint only when they have something new to show.
+*/
+class AudioProcessor2AudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                            private juce::ComboBox::Listener,
+                                            private juce::ChangeListener
 {
 public:
     AudioProcessor2AudioProcessorEditor (AudioProcessor2AudioProcessor&);
     ~AudioProcessor2AudioProcessorEditor() override;
 
     //==============================================================================
-    void paint (juce::Graphics&) override;
     void resized() override;
 
-    void timerCallback();
-
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonState;
 
-    void sliderValueChanged(juce::Slider* slider);
-
     
 
 
@@ -38,11 +101,16 @@ private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
 
+    EditorBackground background;
+    StateComponent presetBar;
+
     juce::TextButton playButton{ "Play" };
+    void updatePlayButton();
     juce::TextButton openButton{ "Open" };
 
     juce::Slider mGainSlider;
     juce::Label  GainLabel;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> gainValue;
 
     juce::Slider filterCutoffDial;
     juce::Slider filterResDial;
@@ -70,6 +138,7 @@ private:
     juce::Slider gSlider;
 
     void comboBoxChanged(juce::ComboBox* comboBoxThatHasChanged) override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     
 
 
@@ -77,8 +146,12 @@ private:
     juce::Slider Threshold;
     juce::Slider Mix;
 
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> disChoiceValue;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> thresholdValue;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> distMixValue;
+
     juce::ComboBox theme;
-    int themechoice;
+    int themechoice = 4;
 
     juce::Label filt;
     juce::Label dist;
@@ -87,6 +160,17 @@ private:
 
     AudioProcessor2AudioProcessor& audioProcessor;
 
+    // The loaded file, between the controls and the tabs.
+    WaveformView waveform;
+    static constexpr int waveformHeight = 64;
+
+    // Below the controls, one tab each: the analyser, and per-stage CPU against the real-time budget.
+    // Only the tab in front runs; the other's timer and audio tap are off.
+    AnalyserView analyserView;
+    DspLoadView loadView;
+    juce::TabbedComponent bottomTabs{ juce::TabbedButtonBar::TabsAtTop };
+    static constexpr int bottomPanelHeight = 200;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessor2AudioProcessorEditor)
 };
 
@@ -104,35 +188,4 @@ private:
     juce::XmlElement ab{ "AB" };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StateAB);
-};
-
-class StateComponent : public juce::Component,
-    public juce::Button::Listener,
-    public juce::ComboBox::Listener
-{
-public:
-    StateComponent(StateAB& sab, StatePresets& sp);
-
-    void paint(juce::Graphics&) override;
-    void resized() override;
-
-private:
-    StateAB& procStateAB;
-    StatePresets& procStatePresets;
-
-    juce::TextButton toggleABButton;
-    juce::TextButton copyABButton;
-    juce::ComboBox   presetBox;
-    juce::TextButton savePresetButton;
-    juce::TextButton deletePresetButton;
-
-    void buttonClicked(juce::Button* clickedButton) override;
-    void comboBoxChanged(juce::ComboBox* changedComboBox) override;
-
-    void refreshPresetBox();
-    void ifPresetActiveShowInBox();
-    void deletePresetAndRefresh();
-    void savePresetAlertWindow();
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StateComponent);
-};*/
\ No newline at end of file
+};*/
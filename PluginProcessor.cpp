@@ -8,6 +8,8 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeSafetyGuard.h"
+#include "BinaryState.h"
 
 //==============================================================================
 AudioProcessor2AudioProcessor::AudioProcessor2AudioProcessor()
@@ -19,23 +21,21 @@ AudioProcessor2AudioProcessor::AudioProcessor2AudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ), params(*this, nullptr, "Parameters", std::make_unique<juce::AudioParameterBool>("Play", "Play", false))
-                        , tree(*this, nullptr), lowPassFilter(juce::dsp::IIR::Coefficients<float>::makeLowPass(44100, 20000.0f, 0.1))
-                        , apvts(*this, nullptr, "Parameters", createParameters())
+                       ), apvts(*this, nullptr, "Parameters", createParameters())
+                        , parameters(apvts)
 #endif
 {
     audioFormatManager.registerBasicFormats();
     audioFile.getSpecialLocation(juce::File::SpecialLocationType::userHomeDirectory);
 
-    juce::NormalisableRange<float> cutoffRange(20.0f, 20000.0f);
-    juce::NormalisableRange<float> resRange(0.1f, 1.0f);
-
-    tree.createAndAddParameter("cutoff", "Cutoff", "cutoff", cutoffRange, 100.0f, nullptr, nullptr);
-    tree.createAndAddParameter("resonance", "Resonance", "resonance", resRange, 0.1f, nullptr, nullptr);
-
-    apvts.addParameterListener("RATE", this);
-    apvts.addParameterListener("FEEDBACK", this);
-    apvts.addParameterListener("MIX", this);
+    fileLoader.onLoadFinished = [this](const juce::File& file, bool succeeded)
+    {
+        if (succeeded && file != loadedFile)
+        {
+            loadedFile = file;
+            sendChangeMessage();
+        }
+    };
 
     //addParameter(gain = new juce::AudioParameterFloat("gain", "Gain", 0.0f, 1.0f, 0.0f));
     //addParameter(mS = new juce::AudioParameterFloat("mS", "MilliSeconds", 10.0f, 5000.0f, 500.0f));
@@ -44,9 +44,8 @@ AudioProcessor2AudioProcessor::AudioProcessor2AudioProcessor()
 
 AudioProcessor2AudioProcessor::~AudioProcessor2AudioProcessor()
 {
-    apvts.removeParameterListener("RATE", this);
-    apvts.removeParameterListener("FEEDBACK", this);
-    apvts.removeParameterListener("MIX", this);
+    cancelPendingUpdate();
+    delete currentFile;
 }
 
 //==============================================================================
@@ -124,17 +123,133 @@ void AudioProcessor2AudioProcessor::openFile()
 
 void AudioProcessor2AudioProcessor::loadFile(juce::File& file)
 {
-    transportSource.stop();
-    transportSource.setSource(nullptr);
-    audioFileSource = nullptr;
+    setSessionFile(file);
+    fileLoader.loadAsync(file);
+}
+
+void AudioProcessor2AudioProcessor::seek(juce::int64 position)
+{
+    pendingSeek.store(juce::jmax((juce::int64) 0, position), std::memory_order_relaxed);
+}
+
+void AudioProcessor2AudioProcessor::setStreamingEnabled(bool shouldStream)
+{
+    auto options = fileLoader.getOptions();
+    options.streaming = shouldStream;
+    fileLoader.setOptions(options);
+}
+
+void AudioProcessor2AudioProcessor::setMemoryMappingEnabled(bool shouldMap)
+{
+    auto options = fileLoader.getOptions();
+    options.memoryMapping = shouldMap;
+    fileLoader.setOptions(options);
+}
+
+void AudioProcessor2AudioProcessor::setResamplingQuality(PolyphaseResampler::Quality quality)
+{
+    auto options = fileLoader.getOptions();
+    options.resamplingQuality = quality;
+    fileLoader.setOptions(options);
+}
+
+void AudioProcessor2AudioProcessor::clearUnusedChannels(juce::AudioBuffer<float>& buffer, int numFileChannels, int numSamples)
+{
+    // JUCE's readers copy the last file channel into any extra ones; on a surround bus
+    // a stereo file should play from the front pair only.
+    for (int channel = juce::jmax(1, numFileChannels); channel < buffer.getNumChannels(); ++channel)
+        buffer.clear(channel, 0, numSamples);
+}
 
-    juce::AudioFormatReader* reader = audioFormatManager.createReaderFor(file);
+void AudioProcessor2AudioProcessor::renderFilePlayback(juce::AudioBuffer<float>& buffer, bool play)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto seekTarget = pendingSeek.exchange(-1, std::memory_order_relaxed);
+    auto crossfade = false;
 
-    if (reader != nullptr)
+    // Both a file swap and a seek mid-playback render one last block from where playback was,
+    // to fade out under the new audio.
+    const auto canCrossfade = [&]
     {
-        audioFileSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
-        transportSource.setSource(audioFileSource.get());
+        return play && currentFile != nullptr
+                && fadeBuffer.getNumSamples() >= numSamples && fadeBuffer.getNumChannels() >= buffer.getNumChannels();
+    };
+
+    // A seek aimed at the file being replaced is dropped.
+    if (auto* next = fileLoader.takePending())
+    {
+        if (canCrossfade())
+        {
+            currentFile->source->getNextAudioBlock(juce::AudioSourceChannelInfo(&fadeBuffer, 0, numSamples));
+            clearUnusedChannels(fadeBuffer, currentFile->numChannels, numSamples);
+            crossfade = true;
+        }
+
+        swapCurrentFile(next);
     }
+    else if (seekTarget >= 0 && currentFile != nullptr)
+    {
+        if (canCrossfade())
+        {
+            currentFile->source->getNextAudioBlock(juce::AudioSourceChannelInfo(&fadeBuffer, 0, numSamples));
+            clearUnusedChannels(fadeBuffer, currentFile->numChannels, numSamples);
+            crossfade = true;
+        }
+
+        // A streamed file plays silence until its reader has caught up, then fades in by itself.
+        currentFile->source->setNextReadPosition(juce::jmin(seekTarget, currentFile->source->getTotalLength()));
+    }
+
+    if (currentFile == nullptr || ! (play || wasPlaying))
+    {
+        buffer.clear();
+
+        // Unloaded mid-playback: the old file's last block fades out into silence.
+        if (crossfade)
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.addFromWithRamp(channel, 0, fadeBuffer.getReadPointer(channel), numSamples, 1.0f, 0.0f);
+
+        return;
+    }
+
+    currentFile->source->getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+    clearUnusedChannels(buffer, currentFile->numChannels, numSamples);
+
+    if (! play)
+    {
+        // Just stopped: fade the last block out and rewind for next time.
+        buffer.applyGainRamp(0, numSamples, 1.0f, 0.0f);
+        currentFile->source->setNextReadPosition(0);
+    }
+    else if (crossfade)
+    {
+        buffer.applyGainRamp(0, numSamples, 0.0f, 1.0f);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.addFromWithRamp(channel, 0, fadeBuffer.getReadPointer(channel), numSamples, 1.0f, 0.0f);
+    }
+
+    if (currentFile->streamingSource != nullptr)
+        streamingUnderruns.store(currentFile->streamingSource->getNumUnderruns(), std::memory_order_relaxed);
+}
+
+void AudioProcessor2AudioProcessor::swapCurrentFile(LoadedAudioFile* next) noexcept
+{
+    fileLoader.retire(currentFile);
+    currentFile = next;
+
+    // The empty entry an unload publishes has nothing to play; takePending() left room to retire it too.
+    if (currentFile->source == nullptr)
+    {
+        fileLoader.retire(currentFile);
+        currentFile = nullptr;
+    }
+}
+
+void AudioProcessor2AudioProcessor::publishPlaybackPosition() noexcept
+{
+    playbackPosition.store(currentFile != nullptr ? currentFile->source->getNextReadPosition() : 0, std::memory_order_relaxed);
+    playbackLength.store(currentFile != nullptr ? currentFile->source->getTotalLength() : 0, std::memory_order_relaxed);
 }
 
 
@@ -144,33 +259,42 @@ void AudioProcessor2AudioProcessor::prepareToPlay (double sampleRate, int sample
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..                                        //***************************************
-    transportSource.prepareToPlay(samplesPerBlock, sampleRate);
+    const auto numIOChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
 
-    lastSampleRate = sampleRate;
+    fileLoader.setPlaybackConfig(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
 
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
+    // Nothing is processing now, so a file published since the last block can be claimed and re-prepared here.
+    if (auto* next = fileLoader.takePending())
+        swapCurrentFile(next);
 
+    if (currentFile != nullptr)
+    {
+        currentFile->source->prepareToPlay(samplesPerBlock, sampleRate);
 
-    lowPassFilter.prepare(spec);
-    lowPassFilter.reset();
+        // A file that was loaded without a resampler now needs one: reload it in the background.
+        if (currentFile->resamplingSource == nullptr && currentFile->fileSampleRate != sampleRate)
+            fileLoader.loadAsync(currentFile->file);
+    }
 
-    //juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.sampleRate = sampleRate;
-    spec.numChannels = 2;
+    fileLoader.collectGarbage();
+    fadeBuffer.setSize(numIOChannels, samplesPerBlock);
 
-    delay.prepare(spec);
-    linear.prepare(spec);
-    mixer.prepare(spec);
+    lastSampleRate = sampleRate;
 
-    for (auto& volume : delayFeedbackVolume)
-        volume.reset(spec.sampleRate, 0.05);
+    // Sizes the channel groups first, so the settings below reach every group.
+    chain.setNumChannels(numIOChannels);
 
-    linear.reset();
-    std::fill(lastDelayOutput.begin(), lastDelayOutput.end(), 0.0f);
+    const auto snapshot = parameters.snapshot();
+    chain.forEachDistortion([&snapshot](DistortionStage& distortion)
+    {
+        distortion.setOversampling(snapshot.oversampling, (DistortionStage::OversamplingFilter) juce::jlimit(0, 1, snapshot.oversamplingFilter));
+    });
+
+    chain.prepare(sampleRate, samplesPerBlock, numIOChannels, effectDelaySamples);
+    setLatencySamples(chain.getLatencySamples());
+
+    loadMeter.prepare(sampleRate);
+    analyserTap.prepare(sampleRate, samplesPerBlock);
 
 }
 
@@ -178,7 +302,11 @@ void AudioProcessor2AudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
-    transportSource.releaseResources();
+    if (currentFile != nullptr)
+        currentFile->source->releaseResources();
+
+    chain.releaseResources();
+    fileLoader.collectGarbage();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -188,12 +316,12 @@ bool AudioProcessor2AudioProcessor::isBusesLayoutSupported (const BusesLayout& l
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout up to maxBusChannels works: mono, stereo, 5.1, 7.1, 7.1.4, ambisonics up to
+    // third order (16 channels), or plain discrete channels. Every stage sizes its per-channel
+    // state from the channel count in prepareToPlay.
+    const auto& output = layouts.getMainOutputChannelSet();
+
+    if (output.isDisabled() || output.size() > maxBusChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -207,17 +335,66 @@ bool AudioProcessor2AudioProcessor::isBusesLayoutSupported (const BusesLayout& l
 }
 #endif
 
-void AudioProcessor2AudioProcessor::updateFilter()
+void AudioProcessor2AudioProcessor::updateFilter(const ParameterSnapshot& snapshot)
 {
-    float freq = *tree.getRawParameterValue("cutoff");
-    float res = *tree.getRawParameterValue("resonance");
+    chain.setFilter(snapshot.cutoff, snapshot.resonance);
+}
+
+void AudioProcessor2AudioProcessor::updateDelay(const ParameterSnapshot& snapshot)
+{
+    const auto msToSamples = lastSampleRate / 1000.0f;
+
+    const auto delaySamples = getDelayTimeMs(snapshot) * msToSamples;
 
-    *lowPassFilter.state = *juce::dsp::IIR::Coefficients<float>::makeLowPass(lastSampleRate, freq, res);
+    // Time and depth are ramped per sample inside the engine, so knob moves glide instead of clicking.
+    chain.forEachDelay([&](DelayEngine& delay)
+    {
+        delay.setInterpolation((DelayEngine::Interpolation) juce::jlimit(0, 2, snapshot.delayInterp));
+        delay.setDelay(delaySamples);
+        delay.setModulation(snapshot.modRateHz, snapshot.modDepthMs * msToSamples);
+        delay.setFeedbackGain(juce::Decibels::decibelsToGain(snapshot.feedbackDb, -100.0f));
+    });
+
+    chain.setDelayMix(snapshot.delayMix);
+}
+
+float AudioProcessor2AudioProcessor::getDelayTimeMs(const ParameterSnapshot& snapshot)
+{
+    if (! snapshot.tempoSync)
+        return snapshot.rateMs;
+
+    if (auto* playHead = getPlayHead())
+    {
+        juce::AudioPlayHead::CurrentPositionInfo position;
+
+        if (playHead->getCurrentPosition(position) && position.bpm > 0.0)
+            hostBpm = position.bpm;
+    }
+
+    // Lengths in quarter notes, matching the Sync Division choices.
+    static constexpr float beats[] = { 4.0f, 2.0f, 1.0f, 0.5f, 0.25f, 1.5f, 0.75f, 2.0f / 3.0f, 1.0f / 3.0f };
+    const auto division = juce::jlimit(0, (int) juce::numElementsInArray(beats) - 1, snapshot.syncDivision);
+
+    return (float) (60000.0 / hostBpm) * beats[division];
+}
+
+void AudioProcessor2AudioProcessor::handleAsyncUpdate()
+{
+    setLatencySamples(chain.getLatencySamples());
+}
+
+void AudioProcessor2AudioProcessor::setChainLayout(const ChainLayout& layout)
+{
+    apvts.state.setProperty(ChainLayout::propertyID, layout.toString(), nullptr);
+    chain.setLayout(layout);
 }
 
 void AudioProcessor2AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    const RealtimeSafetyGuard::ScopedRealtimeContext realtimeContext;     // no-op unless REALTIME_SAFETY_GUARD is set
+    loadMeter.beginBlock();
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -233,59 +410,35 @@ void AudioProcessor2AudioProcessor::processBlock (juce::AudioBuffer<float>& buff
         const auto& output = context.getOutputBlock();
 
 
-    mixer.pushDrySamples(input);
-
-    if (params.getParameterAsValue("Play") == true)
-    {
-        if (audioFileSource != nullptr)
-        {
-            transportSource.start();
-        }
-    }
-    else
-    {
-        transportSource.stop();
-        transportSource.setPosition(0.0);
-    }
-
-
-    transportSource.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
-    
-    juce::dsp::AudioBlock <float> block(buffer);
-    updateFilter();
-    lowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(block));
-    
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
+    // Read every parameter once; nothing below this line looks anything up by name.
+    const auto snapshot = parameters.snapshot();
 
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            channelData[sample] = channelData[sample] * juce::Decibels::decibelsToGain(mGain);
-        }
+    updateDelay(snapshot);
+    updateFilter(snapshot);
+    chain.setGainDecibels(snapshot.gainDb);
 
-
-        // ..do something to the data...
-    }
-    for (size_t channel = 0; channel < numChannels; ++channel)
+    chain.forEachDistortion([&snapshot](DistortionStage& distortion)
     {
-        auto* samplesIn = input.getChannelPointer(channel);
-        auto* samplesOut = output.getChannelPointer(channel);
+        distortion.setOversampling(snapshot.oversampling, (DistortionStage::OversamplingFilter) juce::jlimit(0, 1, snapshot.oversamplingFilter));
+        distortion.setAntialiasing((DistortionStage::Antialiasing) juce::jlimit(0, 2, snapshot.antialiasing));
+        distortion.setParameters(snapshot.distortionType, snapshot.threshold, snapshot.distortionMix);
+    });
 
-        for (size_t sample = 0; sample < input.getNumSamples(); ++sample)
-        {
-            auto input = samplesIn[sample] - lastDelayOutput[channel];
-            auto delayAmount = delayValue[channel];
+    // The delay's dry signal is the host input, so it has to be kept before playback overwrites the buffer.
+    chain.pushDrySamples(input);
+    loadMeter.endStage(DspLoadMeter::setup);
 
-            linear.pushSample(int(channel), input);
-            linear.setDelay((float)delayAmount);
-            samplesOut[sample] = linear.popSample((int)channel);
+    renderFilePlayback(buffer, snapshot.play);
+    wasPlaying = snapshot.play;
+    publishPlaybackPosition();
+    loadMeter.endStage(DspLoadMeter::playback);
 
-            lastDelayOutput[channel] = samplesOut[sample] * delayFeedbackVolume[channel].getNextValue();
-        }
-    }
+    analyserTap.capturePre(output);
 
-    mixer.mixWetSamples(output);
+    // Gain, then the modules in the current layout, one sub-block at a time.
+    chain.process(output);
+    loadMeter.addStageTicks(chain.getStageTicks());
+    analyserTap.pushPost(output);
 
     /*auto* channeldataL = buffer.getWritePointer(0);
     auto* channeldataR = buffer.getWritePointer(1);
@@ -304,58 +457,17 @@ void AudioProcessor2AudioProcessor::processBlock (juce::AudioBuffer<float>& buff
         channeldataR[i] = inputR;
     }*/
 
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-    {
-        auto* channelData = buffer.getWritePointer(channel);
-
-        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+    // The host has to be told about latency changes from the message thread.
+    if (chain.getLatencySamples() != getLatencySamples())
+        triggerAsyncUpdate();
 
-            auto input = channelData[i];
-            auto cleanOut = channelData[i];
+    loadMeter.endBlock(buffer.getNumSamples());
+}
 
-            if (menuChoice == 1)
-                //Hard Clipping
-            {
-                if (input > thresh)
-                {
-                    input = thresh;
-                }
-                else if (input < -thresh)
-                {
-                    input = -thresh;
-                }
-                else
-                {
-                    input = input;
-                }
-            }
-            if (menuChoice == 2)
-                //Soft Clipping Exp
-            {
-                if (input > thresh)
-                {
-                    input = 1.0f - expf(-input);
-                }
-                else
-                {
-                    input = -1.0f + expf(input);
-                }
-            }
-            if (menuChoice == 3)
-                //Half-Wave Rectifier
-            {
-                if (input > thresh)
-                {
-                    input = input;
-                }
-                else
-                {
-                    input = 0;
-                }
-            }
-            channelData[i] = ((1 - mix) * cleanOut) + (mix * input);
-        }
-    }
+void AudioProcessor2AudioProcessor::updateTrackProperties(const TrackProperties& properties)
+{
+    // Lets the load display and its CSV say which track an overloaded instance sits on.
+    loadMeter.setTrackName(properties.name);
 }
 
 //==============================================================================
@@ -376,183 +488,284 @@ juce::AudioProcessorEditor* AudioProcessor2AudioProcessor::createEditor()
 }
 
 //==============================================================================
-void AudioProcessor2AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+namespace StateTags
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Each chunk reads what it knows and ignores the rest, so fields may only be appended.
+    constexpr auto parameters   = BinaryState::makeTag('p', 'a', 'r', 'm');    // { string id, float value } until the end
+    constexpr auto chain        = BinaryState::makeTag('c', 'h', 'a', 'n');    // uint32 packed layout, uint8 parallel
+    constexpr auto file         = BinaryState::makeTag('f', 'i', 'l', 'e');    // string absolute path, empty for none
+    constexpr auto editor       = BinaryState::makeTag('e', 'd', 'i', 't');    // int32 theme
 }
 
-void AudioProcessor2AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+void AudioProcessor2AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    writeState(destData, true);
 }
 
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+void AudioProcessor2AudioProcessor::getPresetState(juce::MemoryBlock& destData)
 {
-    return new AudioProcessor2AudioProcessor();
+    writeState(destData, false);
 }
 
-void AudioProcessor2AudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+void AudioProcessor2AudioProcessor::writeState(juce::MemoryBlock& destData, bool includeSession)
 {
-    if (parameterID == "RATE")
-        std::fill(delayValue.begin(), delayValue.end(), newValue / 1000.0 * getSampleRate());
+    BinaryState::Writer writer(destData);
 
-    if (parameterID == "MIX")
-        mixer.setWetMixProportion(newValue);
+    // Plain values rather than normalised ones, so a parameter whose range changes keeps its setting.
+    auto& parameterChunk = writer.beginChunk(StateTags::parameters);
 
-    if (parameterID == "FEEDBACK")
+    for (auto* parameter : getParameters())
     {
-        const auto feedbackGain = juce::Decibels::decibelsToGain(newValue, -100.0f);
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
 
-        for (auto& volume : delayFeedbackVolume)
-            volume.setTargetValue(feedbackGain);
+        // Play is transport rather than a setting, so only a session carries it.
+        if (ranged != nullptr && (includeSession || ranged->paramID != ParamIDs::play))
+        {
+            parameterChunk.writeString(ranged->paramID);
+            parameterChunk.writeFloat(ranged->convertFrom0to1(ranged->getValue()));
+        }
     }
-}
 
-juce::AudioProcessorValueTreeState::ParameterLayout AudioProcessor2AudioProcessor::createParameters()
-{
-    juce::AudioProcessorValueTreeState::ParameterLayout params;
+    writer.endChunk();
 
-    using Range = juce::NormalisableRange<float>;
+    auto& chainChunk = writer.beginChunk(StateTags::chain);
+    chainChunk.writeInt((int) chain.getLayout().pack());
+    chainChunk.writeByte(chain.isParallelProcessingEnabled() ? 1 : 0);
+    writer.endChunk();
 
-    params.add(std::make_unique<juce::AudioParameterFloat>("RATE", "Rate", 0.01f, 1000.0f, 0));
-    params.add(std::make_unique<juce::AudioParameterFloat>("FEEDBACK", "Feedback", -100.0f, 0.0f, -100.0f));
-    params.add(std::make_unique<juce::AudioParameterFloat>("MIX", "Mix", Range{ 0.0f, 1.0f, 0.01f }, 0.0f));
+    if (! includeSession)
+        return;
 
-    return params;
+    writer.beginChunk(StateTags::file).writeString(getSessionFile().getFullPathName());
+    writer.endChunk();
+
+    writer.beginChunk(StateTags::editor).writeInt(editorTheme.load(std::memory_order_relaxed));
+    writer.endChunk();
 }
-//**************************************************************************************************************************
 
-/*void saveStateToXml(const juce::AudioProcessor& proc, juce::XmlElement& xml)
+void AudioProcessor2AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    xml.removeAllAttributes(); // clear first
+    if (data == nullptr || sizeInBytes <= 0)
+        return;
 
-    for (const auto& param : proc.getParameters())
-        if (auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param))
-            xml.setAttribute(p->paramID, p->getValue()); // 0to1
-}
+    if (BinaryState::isBinaryState(data, (size_t) sizeInBytes))
+        restoreBinaryState(data, (size_t) sizeInBytes);
+    else
+        restoreXmlState(data, sizeInBytes);
 
-void loadStateFromXml(const juce::XmlElement& xml, juce::AudioProcessor& proc)
-{
-    for (const auto& param : proc.getParameters())
-        if (auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param))
-            // if not in xml set current
-            p->setValueNotifyingHost((float)xml.getDoubleAttribute(p->paramID, p->getValue()));
+    // Lets an open editor pick up the theme and file.
+    sendChangeMessage();
 }
 
-StateAB::StateAB(juce::AudioProcessor& p)
-    : pluginProcessor{ p }
+void AudioProcessor2AudioProcessor::restoreBinaryState(const void* data, size_t size)
 {
-    copyAB();
-}
+    BinaryState::Reader reader(data, size);
 
-void StateAB::toggleAB()
-{
-    juce::XmlElement temp{ "Temp" };
-    saveStateToXml(pluginProcessor, temp); // current to temp
-    loadStateFromXml(ab, pluginProcessor); // ab to current
-    ab = temp;                              // temp to ab
-}
+    if (! reader.isValid())
+        return;
 
-void StateAB::copyAB()
-{
-    saveStateToXml(pluginProcessor, ab);
+    const auto& allParameters = getParameters();
+    std::vector<bool> restored((size_t) allParameters.size(), false);
+
+    // Parameters and a layout the state doesn't mention go back to their defaults, as they would
+    // after replaceState(). The file, theme and play switch are left alone, so a preset doesn't touch them.
+    auto layout = ChainLayout::getDefault();
+    auto parallel = chain.isParallelProcessingEnabled();
+    auto theme = editorTheme.load(std::memory_order_relaxed);
+
+    while (reader.next())
+    {
+        juce::MemoryInputStream in(reader.getChunkData(), reader.getChunkSize(), false);
+
+        switch (reader.getTag())
+        {
+            case StateTags::parameters:
+                while (! in.isExhausted())
+                {
+                    const auto id = in.readString();
+
+                    if (in.getNumBytesRemaining() < (juce::int64) sizeof(float))
+                        break;
+
+                    const auto value = in.readFloat();
+
+                    // Parameters since removed are skipped.
+                    if (auto* parameter = apvts.getParameter(id))
+                    {
+                        setParameterIfChanged(*parameter, parameter->convertTo0to1(value));
+                        restored[(size_t) parameter->getParameterIndex()] = true;
+                    }
+                }
+                break;
+
+            case StateTags::chain:
+                if (in.getNumBytesRemaining() >= 4)
+                    layout = ChainLayout::unpack((juce::uint32) in.readInt());
+
+                if (! in.isExhausted())
+                    parallel = in.readByte() != 0;
+                break;
+
+            case StateTags::file:
+                restoreSessionFile(in.readString());
+                break;
+
+            case StateTags::editor:
+                if (in.getNumBytesRemaining() >= 4)
+                    theme = in.readInt();
+                break;
+
+            default:
+                break;  // from a newer build
+        }
+    }
+
+    for (size_t i = 0; i < restored.size(); ++i)
+        if (! restored[i])
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(allParameters[(int) i]))
+                if (ranged->paramID != ParamIDs::play)
+                    setParameterIfChanged(*ranged, ranged->getDefaultValue());
+
+    setChainLayout(layout);
+    setParallelProcessingEnabled(parallel);
+    editorTheme.store(theme, std::memory_order_relaxed);
 }
 
-void createFileIfNonExistant(const juce::File& file)
+void AudioProcessor2AudioProcessor::restoreXmlState(const void* data, int sizeInBytes)
 {
-    if (!file.exists())
-        file.create();
-    jassert(file.exists());
+    // Sessions saved before the binary format: parameters plus the layout as a property of the tree.
+    auto xml = getXmlFromBinary(data, sizeInBytes);
+
+    if (xml == nullptr || ! xml->hasTagName(apvts.state.getType()))
+        return;
+
+    apvts.replaceState(juce::ValueTree::fromXml(*xml));
+
+    // Sessions saved before the chain could be rearranged have no layout and get the original order.
+    chain.setLayout(ChainLayout::fromString(apvts.state.getProperty(ChainLayout::propertyID).toString()));
 }
 
-void parseFileToXmlElement(const juce::File& file, juce::XmlElement& xml)                  // what could go wrong here?
+void AudioProcessor2AudioProcessor::setParameterIfChanged(juce::RangedAudioParameter& parameter, float normalisedValue)
 {
-    std::unique_ptr<juce::XmlElement> parsed{ juce::XmlDocument::parse(file) };
-    if (parsed)
-        xml = *parsed;
+    // A template with hundreds of instances would otherwise flood the host with no-op changes.
+    if (parameter.getValue() != normalisedValue)
+        parameter.setValueNotifyingHost(normalisedValue);
 }
 
-void writeXmlElementToFile(const juce::XmlElement& xml, juce::File& file)
+void AudioProcessor2AudioProcessor::restoreSessionFile(const juce::String& path)
 {
-    createFileIfNonExistant(file);
-    xml.writeToFile(file, "");         // "" is DTD (unused)
+    // A state saved with no file loaded restores to no file loaded.
+    auto file = juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File();
+
+    // Hosts restore the same state repeatedly (undo, copying tracks); don't reload what's already playing.
+    if (file == getSessionFile())
+        return;
+
+    if (file.existsAsFile())
+    {
+        loadFile(file);
+        return;
+    }
+
+    // A missing file is still remembered, so saving again doesn't lose the reference,
+    // but whatever was playing before belongs to another session and stops.
+    setSessionFile(file);
+    fileLoader.unloadAsync();
 }
 
-juce::String getNextAvailablePresetID(const juce::XmlElement& presetXml)
+juce::File AudioProcessor2AudioProcessor::getSessionFile() const
 {
-    int newPresetIDNumber = presetXml.getNumChildElements() + 1; // 1 indexed to match ComboBox
-    return "preset" + static_cast<juce::String> (newPresetIDNumber);   // format: preset##
+    const juce::ScopedLock lock(sessionFileLock);
+    return sessionFile;
 }
 
-
-StatePresets::StatePresets(juce::AudioProcessor& proc, const juce::String& presetFileLocation)
-    : pluginProcessor{ proc },
-    presetFile{ juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
-                  .getChildFile(presetFileLocation) }
+void AudioProcessor2AudioProcessor::setSessionFile(const juce::File& file)
 {
-    parseFileToXmlElement(presetFile, presetXml);
+    const juce::ScopedLock lock(sessionFileLock);
+    sessionFile = file;
 }
 
-StatePresets::~StatePresets()
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
-    writeXmlElementToFile(presetXml, presetFile);
+    return new AudioProcessor2AudioProcessor();
 }
 
-void StatePresets::savePreset(const juce::String& presetName)
+juce::AudioProcessorValueTreeState::ParameterLayout AudioProcessor2AudioProcessor::createParameters()
 {
-    juce::String newPresetID = getNextAvailablePresetID(presetXml); // presetID format: "preset##"
+    juce::AudioProcessorValueTreeState::ParameterLayout params;
+
+    using Range = juce::NormalisableRange<float>;
 
-    std::unique_ptr<juce::XmlElement> currentState{ new juce::XmlElement {newPresetID} };    // must be pointer as
-    saveStateToXml(pluginProcessor, *currentState);                            // parent takes ownership
-    currentState->setAttribute("presetName", presetName);
+    params.add(std::make_unique<juce::AudioParameterBool>(ParamIDs::play, "Play", false));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::gain, "Volume", Range{ -60.0f, 0.0f, 0.01f }, -20.0f));
+
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::cutoff, "Cutoff", Range{ 20.0f, 20000.0f }, 100.0f));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::resonance, "Resonance", Range{ 0.1f, 1.0f }, 0.1f));
+
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::rate, "Rate", 0.01f, 1000.0f, 0));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::feedback, "Feedback", -100.0f, 0.0f, -100.0f));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::mix, "Mix", Range{ 0.0f, 1.0f, 0.01f }, 0.0f));
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::delayInterp, "Delay Interpolation",
+                                                            juce::StringArray{ "Linear", "Lagrange", "Thiran" }, 0));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::modRate, "Mod Rate", Range{ 0.05f, 10.0f, 0.01f, 0.5f }, 0.5f));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::modDepth, "Mod Depth", Range{ 0.0f, 10.0f, 0.01f }, 0.0f));
+    params.add(std::make_unique<juce::AudioParameterBool>(ParamIDs::tempoSync, "Tempo Sync", false));
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::syncDivision, "Sync Division",
+                                                            juce::StringArray{ "1/1", "1/2", "1/4", "1/8", "1/16",
+                                                                               "1/4 Dotted", "1/8 Dotted", "1/4 Triplet", "1/8 Triplet" }, 2));
+
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::distType, "Distortion",
+                                                            juce::StringArray{ "Hard Clip", "Soft Clip", "Half-Wave Rect",
+                                                                               "Tanh", "Cubic", "Asymmetric", "Foldback" }, 0));
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::oversampling, "Oversampling",
+                                                            juce::StringArray{ "Off", "2x", "4x", "8x" }, 0));
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::oversamplingFilter, "Oversampling Filter",
+                                                            juce::StringArray{ "Polyphase IIR", "Linear-Phase FIR" }, 0));
+    params.add(std::make_unique<juce::AudioParameterChoice>(ParamIDs::antialiasing, "Antialiasing",
+                                                            juce::StringArray{ "Off", "ADAA 1st Order", "ADAA 2nd Order" }, 0));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::threshold, "Threshold", Range{ 0.0f, 1.0f, 0.001f }, 0.0f));
+    params.add(std::make_unique<juce::AudioParameterFloat>(ParamIDs::distMix, "Distortion Mix", Range{ 0.0f, 1.0f, 0.001f }, 0.0f));
 
-    presetXml.addChildElement(currentState.release());                         // will be deleted by parent element
+    return params;
 }
+//**************************************************************************************************************************
 
-void StatePresets::loadPreset(int presetID)
+/*void saveStateToXml(const juce::AudioProcessor& proc, juce::XmlElement& xml)
 {
-    if (1 <= presetID && presetID <= presetXml.getNumChildElements()) // 1 indexed to match ComboBox
-    {
-        juce::XmlElement loadThisChild{ *presetXml.getChildElement(presetID - 1) }; // (0 indexed method)
-        loadStateFromXml(loadThisChild, pluginProcessor);
-    }
-    currentPresetID = presetID; // allow 0 for 'no preset selected' (?)
+    xml.removeAllAttributes(); // clear first
+
+    for (const auto& param : proc.getParameters())
+        if (auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param))
+            xml.setAttribute(p->paramID, p->getValue()); // 0to1
 }
 
-void StatePresets::deletePreset()
+void loadStateFromXml(const juce::XmlElement& xml, juce::AudioProcessor& proc)
 {
-    juce::XmlElement* childToDelete{ presetXml.getChildElement(currentPresetID - 1) };
-    if (childToDelete)
-        presetXml.removeChildElement(childToDelete, true);
+    for (const auto& param : proc.getParameters())
+        if (auto* p = dynamic_cast<juce::AudioProcessorParameterWithID*> (param))
+            // if not in xml set current
+            p->setValueNotifyingHost((float)xml.getDoubleAttribute(p->paramID, p->getValue()));
 }
 
-juce::StringArray StatePresets::getPresetNames() const
+StateAB::StateAB(juce::AudioProcessor& p)
+    : pluginProcessor{ p }
 {
-    juce::StringArray names;
-
-    forEachXmlChildElement(presetXml, child)                                    // should avoid macro?
-    {
-        juce::String n = child->getStringAttribute("presetName");
-        if (n == "")
-            n = "(Unnamed preset)";
-        names.add(n);
-    }
-    return names; // hopefully moves
+    copyAB();
 }
 
-int StatePresets::getNumPresets() const
+void StateAB::toggleAB()
 {
-    return presetXml.getNumChildElements();
+    juce::XmlElement temp{ "Temp" };
+    saveStateToXml(pluginProcessor, temp); // current to temp
+    loadStateFromXml(ab, pluginProcessor); // ab to current
+    ab = temp;                              // temp to ab
 }
 
-int StatePresets::getCurrentPresetId() const
+void StateAB::copyAB()
 {
-    return currentPresetID;
+    saveStateToXml(pluginProcessor, ab);
 }
 
 */
@@ -9,11 +9,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "Parameters.h"
+#include "AudioFileLoader.h"
+#include "ParallelEffectChain.h"
+#include "DspLoadMeter.h"
+#include "AnalyserTap.h"
+#include "PresetLibrary.h"
 
 //==============================================================================
 /**
 */
-class AudioProcessor2AudioProcessor  : public juce::AudioProcessor, public juce::AudioProcessorValueTreeState::Listener
+class AudioProcessor2AudioProcessor  : public juce::AudioProcessor,
+                                       public juce::ChangeBroadcaster,
+                                       private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -30,6 +38,8 @@ public:
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    void updateTrackProperties (const TrackProperties& properties) override;
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -53,46 +63,142 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    juce::AudioProcessorValueTreeState params;
+    /** The state without the session's file, editor theme and play switch; setStateInformation()
+        leaves those as they are. */
+    void getPresetState(juce::MemoryBlock& destData);
+
     void openFile();
+
+    /** Starts loading in the background; playback switches over once the file
+        has been opened and pre-buffered, so this never blocks on disk. */
     void loadFile(juce::File& file);
 
-    float mGain{ 0.5 };
+    /** When enabled (the default), files loaded afterwards are read ahead on a
+        background thread instead of being decoded inside processBlock. */
+    void setStreamingEnabled(bool shouldStream);
 
-    void updateFilter();
+    /** When enabled (the default), PCM WAV/AIFF files are played from a memory
+        mapping instead; compressed formats always take the streamed path. */
+    void setMemoryMappingEnabled(bool shouldMap);
 
+    /** The file most recently loaded, or none. Listeners registered with addChangeListener()
+        are told on the message thread whenever this changes or a state is restored. */
+    juce::File getLoadedFile() const                             { return loadedFile; }
+    juce::AudioFormatManager& getFormatManager()                 { return audioFormatManager; }
 
-    juce::AudioProcessorValueTreeState tree;
+    /** Where playback is in the current file, and how long the file is, in samples at the
+        session rate. Updated once per block by the audio thread. */
+    juce::int64 getPlaybackPosition() const                      { return playbackPosition.load(std::memory_order_relaxed); }
+    juce::int64 getPlaybackLength() const                        { return playbackLength.load(std::memory_order_relaxed); }
 
-    juce::AudioProcessorValueTreeState apvts;
+    /** Moves playback to the given sample at the start of the next block. While playing,
+        the old position is crossfaded out under the new one over that block. */
+    void seek(juce::int64 position);
+
+    /** The editor's theme, as one of its theme menu IDs; saved with the plugin state. */
+    int getEditorTheme() const                                   { return editorTheme.load(std::memory_order_relaxed); }
+    void setEditorTheme(int themeId)                             { editorTheme.store(themeId, std::memory_order_relaxed); }
+    static constexpr int defaultEditorTheme = 4;
+
+    /** Interpolation quality used for files whose sample rate differs from the session's. */
+    void setResamplingQuality(PolyphaseResampler::Quality quality);
+    int getNumStreamingUnderruns() const { return streamingUnderruns.load(); }
+
+    void updateFilter(const ParameterSnapshot& snapshot);
+
+    /** Chooses the SIMD kernel used by the low-pass stage; safe to call while playing. */
+    void setFilterKernel(MultiChannelBiquad::Kernel kernel) { chain.setFilterKernel(kernel); }
+    MultiChannelBiquad::Kernel getFilterKernel() const      { return chain.getFilterKernel(); }
+
+    /** Order, bypass and duplication of the effect modules; saved with the plugin state. */
+    void setChainLayout(const ChainLayout& layout);
+    ChainLayout getChainLayout() const                      { return chain.getLayout(); }
 
-    int menuChoice;
-    float thresh = 0.0f;
-    float mix = 0.0f;
+    /** When enabled (the default), buses wider than ParallelEffectChain::channelsPerGroup are
+        split across worker threads. Hosts that already run plug-ins in parallel may do better
+        without; turning it back on takes effect at the next prepareToPlay. */
+    void setParallelProcessingEnabled(bool shouldRunInParallel) { chain.setParallelProcessingEnabled(shouldRunInParallel); }
+    bool isParallelProcessingEnabled() const                     { return chain.isParallelProcessingEnabled(); }
+
+    /** Off by default: pins the worker threads to cores of their own, spread across instances,
+        from the next prepareToPlay. Worth trying only where the host leaves those cores free. */
+    void setCorePinningEnabled(bool shouldPin)                   { chain.setCorePinningEnabled(shouldPin); }
+
+    /** Per-stage timing of processBlock, written by the audio thread. The history
+        is the message-thread view of it, drained by whoever displays it.
+    */
+    DspLoadMeter& getLoadMeter()                                 { return loadMeter; }
+    DspLoadHistory& getLoadHistory()                             { return loadHistory; }
+
+    /** The chain's input and output for the analyser view. */
+    AnalyserTap& getAnalyserTap()                                { return analyserTap; }
+
+    /** This instance's handle on the preset library shared by all instances. */
+    StatePresets& getStatePresets()                              { return presets; }
+
+    /** Widest bus accepted; the filter runs at most this many channels side by side. */
+    static constexpr int maxBusChannels = MultiChannelBiquad::maxChannels;
+
+    juce::AudioProcessorValueTreeState apvts;
 
 
 private:
     //==============================================================================
+    ParameterCache parameters;
+
     juce::AudioFormatManager audioFormatManager;
     juce::File audioFile;
 
-    juce::AudioTransportSource transportSource;
-    std::unique_ptr<juce::AudioFormatReaderSource> audioFileSource;
+    AudioFileLoader fileLoader{ audioFormatManager };
+
+    LoadedAudioFile* currentFile = nullptr;     // owned by the audio thread once claimed
+    juce::AudioBuffer<float> fadeBuffer;
+    bool wasPlaying = false;
+    std::atomic<int> streamingUnderruns{ 0 };
 
-    juce::dsp::ProcessorDuplicator <juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients <float>> lowPassFilter;
+    juce::File loadedFile;                      // message thread
+
+    // The file the session refers to: the last one asked for, even if it hasn't loaded (or
+    // can't be found). Hosts may ask for the state from any thread, hence the lock.
+    juce::File sessionFile;
+    juce::CriticalSection sessionFileLock;
+    juce::File getSessionFile() const;
+    void setSessionFile(const juce::File& file);
+
+    std::atomic<int> editorTheme{ defaultEditorTheme };
+    std::atomic<juce::int64> pendingSeek{ -1 }, playbackPosition{ 0 }, playbackLength{ 0 };
+
+    void renderFilePlayback(juce::AudioBuffer<float>& buffer, bool play);
+    static void clearUnusedChannels(juce::AudioBuffer<float>& buffer, int numFileChannels, int numSamples);
+    void swapCurrentFile(LoadedAudioFile* next) noexcept;
+    void publishPlaybackPosition() noexcept;
 
     float lastSampleRate;
 
+    // Filter, gain, delay and distortion, processed together in cache-sized sub-blocks,
+    // one chain per group of channels.
+    ParallelEffectChain chain;
+
+    DspLoadMeter loadMeter;
+    DspLoadHistory loadHistory;
+    AnalyserTap analyserTap;
+    StatePresets presets{ *this };
+
     static constexpr auto effectDelaySamples = 192000;
-    juce::dsp::DelayLine<float> delay{ effectDelaySamples };
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> linear{ effectDelaySamples };
-    juce::dsp::DryWetMixer<float> mixer;
+    double hostBpm = 120.0;     // last tempo reported by the host, kept when it stops reporting one
 
-    std::array<float, 2> delayValue{ {} };
-    std::array<float, 2> lastDelayOutput;
-    std::array<juce::LinearSmoothedValue<float>, 2> delayFeedbackVolume;
+    void updateDelay(const ParameterSnapshot& snapshot);
+    float getDelayTimeMs(const ParameterSnapshot& snapshot);
+
+
+    void handleAsyncUpdate() override;
+
+    void writeState(juce::MemoryBlock& destData, bool includeSession);
+    void restoreBinaryState(const void* data, size_t size);
+    void restoreXmlState(const void* data, int sizeInBytes);
+    void restoreSessionFile(const juce::String& path);
+    static void setParameterIfChanged(juce::RangedAudioParameter& parameter, float normalisedValue);
 
-    void parameterChanged(const juce::String& parameterID, float newValue) override;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
     
 
@@ -106,35 +212,7 @@ private:
 
 //==========================================================================================================
 
-/*class StatePresets
-{
-public:
-    StatePresets(juce::AudioProcessor& proc, const juce::String& presetFileLocation);
-    ~StatePresets();
-
-    void savePreset(const juce::String& presetName); // preset already exists? confirm overwrite
-    void loadPreset(int presetID);
-    void deletePreset();
-
-    juce::StringArray getPresetNames() const;
-    int getNumPresets() const;
-    int getCurrentPresetId() const;
-
-private:
-    juce::AudioProcessor& pluginProcessor;
-    juce::XmlElement presetXml{ "PRESETS" }; // local, in-plugin representation
-    juce::File presetFile;                  // on-disk representation
-    int currentPresetID{ 0 };
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StatePresets);
-};
-
-void createFileIfNonExistant(const juce::File& file);
-void parseFileToXmlElement(const juce::File& file, juce::XmlElement& xml);
-void writeXmlElementToFile(const juce::XmlElement& xml, juce::File& file);
-juce::String getNextAvailablePresetID(const juce::XmlElement& presetXml);
-
-void saveStateToXml(const juce::AudioProcessor& processor, juce::XmlElement& xml);
+/*void saveStateToXml(const juce::AudioProcessor& processor, juce::XmlElement& xml);
 void loadStateFromXml(const juce::XmlElement& xml, juce::AudioProcessor& processor);
 
 */
\ No newline at end of file
@@ -0,0 +1,322 @@
+/*
+  ==============================================================================
+
+    Windowed-sinc polyphase resampler for file playback at mismatched rates.
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define RESAMPLER_SSE 1
+#elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define RESAMPLER_NEON 1
+#endif
+
+namespace
+{
+    struct TierSettings
+    {
+        int taps;
+        double rolloff, kaiserBeta;
+    };
+
+    TierSettings getTierSettings (PolyphaseResampler::Quality quality)
+    {
+        switch (quality)
+        {
+            case PolyphaseResampler::Quality::draft:    return { 8,  0.85, 6.0 };
+            case PolyphaseResampler::Quality::normal:   return { 16, 0.90, 8.0 };
+            case PolyphaseResampler::Quality::high:     return { 32, 0.94, 9.5 };
+            case PolyphaseResampler::Quality::best:
+            default:                                    return { 64, 0.96, 11.0 };
+        }
+    }
+
+    // Zeroth-order modified Bessel function, for the Kaiser window.
+    double besselI0 (double x)
+    {
+        auto sum = 1.0, term = 1.0;
+        const auto halfX = x * 0.5;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (halfX / k) * (halfX / k);
+            sum += term;
+
+            if (term < sum * 1.0e-12)
+                break;
+        }
+
+        return sum;
+    }
+
+    // Both dot products share the input loads; numTaps is a multiple of 4.
+    inline void dotProduct2 (const float* x, const float* a, const float* b, int numTaps, float& sumA, float& sumB) noexcept
+    {
+       #if RESAMPLER_SSE
+        auto accA = _mm_setzero_ps(), accB = _mm_setzero_ps();
+
+        for (int i = 0; i < numTaps; i += 4)
+        {
+            const auto v = _mm_loadu_ps (x + i);
+            accA = _mm_add_ps (accA, _mm_mul_ps (v, _mm_loadu_ps (a + i)));
+            accB = _mm_add_ps (accB, _mm_mul_ps (v, _mm_loadu_ps (b + i)));
+        }
+
+        alignas (16) float lanesA[4], lanesB[4];
+        _mm_store_ps (lanesA, accA);
+        _mm_store_ps (lanesB, accB);
+        sumA = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+        sumB = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+       #elif RESAMPLER_NEON
+        auto accA = vdupq_n_f32 (0.0f), accB = vdupq_n_f32 (0.0f);
+
+        for (int i = 0; i < numTaps; i += 4)
+        {
+            const auto v = vld1q_f32 (x + i);
+            accA = vmlaq_f32 (accA, v, vld1q_f32 (a + i));
+            accB = vmlaq_f32 (accB, v, vld1q_f32 (b + i));
+        }
+
+        float lanesA[4], lanesB[4];
+        vst1q_f32 (lanesA, accA);
+        vst1q_f32 (lanesB, accB);
+        sumA = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+        sumB = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+       #else
+        float a0 = 0, a1 = 0, a2 = 0, a3 = 0, b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+
+        for (int i = 0; i < numTaps; i += 4)
+        {
+            a0 += x[i] * a[i];          b0 += x[i] * b[i];
+            a1 += x[i + 1] * a[i + 1];  b1 += x[i + 1] * b[i + 1];
+            a2 += x[i + 2] * a[i + 2];  b2 += x[i + 2] * b[i + 2];
+            a3 += x[i + 3] * a[i + 3];  b3 += x[i + 3] * b[i + 3];
+        }
+
+        sumA = (a0 + a1) + (a2 + a3);
+        sumB = (b0 + b1) + (b2 + b3);
+       #endif
+    }
+
+    // Output samples produced per pass; bounds the size of the input buffer.
+    constexpr int outputsPerPass = 2048;
+}
+
+//==============================================================================
+void PolyphaseResampler::prepare (double inputSamplesPerOutputSample, Quality quality)
+{
+    jassert (inputSamplesPerOutputSample > 0.0);
+
+    ratio = inputSamplesPerOutputSample;
+    const auto tier = getTierSettings (quality);
+
+    // Downsampling lowers the cutoff, so widen the kernel to keep the same transition band.
+    const auto stretch = juce::jmax (1.0, ratio);
+    numTaps = ((int) std::ceil (tier.taps * stretch) + 3) & ~3;
+
+    const auto cutoff = 0.5 * tier.rolloff / stretch;       // cycles per input sample
+    const auto halfWidth = numTaps / 2;
+    const auto windowNorm = 1.0 / besselI0 (tier.kaiserBeta);
+
+    table.assign ((size_t) ((numPhases + 1) * numTaps), 0.0f);
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        auto* row = table.data() + phase * numTaps;
+        auto sum = 0.0;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            // Distance from the interpolation point to this tap's input sample.
+            const auto d = (double) phase / numPhases + (halfWidth - 1 - tap);
+            const auto x = 2.0 * cutoff * d;
+            const auto sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+
+            const auto w = d / halfWidth;
+            const auto window = std::abs (w) <= 1.0 ? besselI0 (tier.kaiserBeta * std::sqrt (1.0 - w * w)) * windowNorm : 0.0;
+
+            const auto value = 2.0 * cutoff * sinc * window;
+            row[tap] = (float) value;
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase, so a constant signal stays constant.
+        if (sum != 0.0)
+            for (int tap = 0; tap < numTaps; ++tap)
+                row[tap] = (float) (row[tap] / sum);
+    }
+}
+
+float PolyphaseResampler::interpolate (const float* input, int index, double fraction) const noexcept
+{
+    const auto scaledPhase = fraction * numPhases;
+    const auto phase = juce::jlimit (0, numPhases - 1, (int) scaledPhase);
+    const auto alpha = (float) (scaledPhase - phase);
+
+    const auto* row = table.data() + phase * numTaps;
+
+    float a, b;
+    dotProduct2 (input + index - getHistory() + 1, row, row + numTaps, numTaps, a, b);
+
+    return a + alpha * (b - a);
+}
+
+//==============================================================================
+ResamplingPositionableSource::ResamplingPositionableSource (juce::PositionableAudioSource& s,
+                                                            double rateOfSource,
+                                                            int channels,
+                                                            PolyphaseResampler::Quality q)
+    : source (s),
+      sourceSampleRate (rateOfSource),
+      numChannels (juce::jmax (1, channels)),
+      quality (q)
+{
+}
+
+void ResamplingPositionableSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+    ratio = sourceSampleRate > 0.0 && sampleRate > 0.0 ? sourceSampleRate / sampleRate : 1.0;
+
+    source.prepareToPlay ((int) std::ceil (samplesPerBlockExpected * ratio), sourceSampleRate > 0.0 ? sourceSampleRate : sampleRate);
+
+    if (ratio != 1.0)
+    {
+        resampler.prepare (ratio, quality);
+        inputBuffer.setSize (numChannels, (int) std::ceil (outputsPerPass * ratio) + resampler.getNumTaps() + 4);
+    }
+    else
+    {
+        inputBuffer.setSize (numChannels, 0);
+    }
+
+    setNextReadPosition (outputPosition);
+}
+
+void ResamplingPositionableSource::releaseResources()
+{
+    source.releaseResources();
+}
+
+void ResamplingPositionableSource::fillInput (int numNeeded)
+{
+    jassert (numNeeded <= inputBuffer.getNumSamples());
+
+    if (numNeeded > numBuffered)
+    {
+        source.getNextAudioBlock (juce::AudioSourceChannelInfo (&inputBuffer, numBuffered, numNeeded - numBuffered));
+        numBuffered = numNeeded;
+    }
+}
+
+void ResamplingPositionableSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    if (ratio == 1.0)
+    {
+        source.getNextAudioBlock (info);
+    }
+    else
+    {
+        const auto history = resampler.getHistory();
+        const auto channelsToRender = juce::jmin (numChannels, info.buffer->getNumChannels());
+
+        for (int done = 0; done < info.numSamples;)
+        {
+            const auto numThisPass = juce::jmin (outputsPerPass, info.numSamples - done);
+            const auto lastPosition = position + (numThisPass - 1) * ratio;
+
+            fillInput ((int) lastPosition + history + 1);
+
+            for (int ch = 0; ch < channelsToRender; ++ch)
+            {
+                const auto* in = inputBuffer.getReadPointer (ch);
+                auto* out = info.buffer->getWritePointer (ch, info.startSample + done);
+
+                for (int i = 0; i < numThisPass; ++i)
+                {
+                    const auto x = position + i * ratio;
+                    const auto index = (int) x;
+                    out[i] = resampler.interpolate (in, index, x - index);
+                }
+            }
+
+            for (int ch = channelsToRender; ch < info.buffer->getNumChannels(); ++ch)
+                info.buffer->clear (ch, info.startSample + done, numThisPass);
+
+            position += numThisPass * ratio;
+            done += numThisPass;
+
+            // Slide the buffer down, keeping just enough history for the next pass.
+            const auto discard = juce::jmax (0, (int) position - history + 1);
+
+            if (discard > 0)
+            {
+                const auto remaining = numBuffered - discard;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    auto* data = inputBuffer.getWritePointer (ch);
+                    std::memmove (data, data + discard, (size_t) remaining * sizeof (float));
+                }
+
+                numBuffered = remaining;
+                position -= discard;
+            }
+        }
+    }
+
+    outputPosition += info.numSamples;
+
+    if (isLooping() && getTotalLength() > 0)
+        outputPosition %= getTotalLength();
+}
+
+//==============================================================================
+void ResamplingPositionableSource::setNextReadPosition (juce::int64 newPosition)
+{
+    outputPosition = newPosition;
+
+    if (ratio == 1.0)
+    {
+        source.setNextReadPosition (newPosition);
+        return;
+    }
+
+    // Start reading far enough back to fill the filter's history with real audio.
+    const auto inputPosition = (double) newPosition * ratio;
+    const auto index = (juce::int64) inputPosition;
+    const auto history = resampler.getHistory() - 1;
+    const auto first = juce::jmax ((juce::int64) 0, index - history);
+    const auto zeros = (int) (history - (index - first));
+
+    inputBuffer.clear();
+    numBuffered = zeros;
+    position = history + (inputPosition - (double) index);
+
+    source.setNextReadPosition (first);
+}
+
+juce::int64 ResamplingPositionableSource::getNextReadPosition() const
+{
+    return outputPosition;
+}
+
+juce::int64 ResamplingPositionableSource::getTotalLength() const
+{
+    const auto length = source.getTotalLength();
+    return ratio == 1.0 ? length : (juce::int64) std::ceil ((double) length / ratio);
+}
+
+bool ResamplingPositionableSource::isLooping() const
+{
+    return source.isLooping();
+}
+
+void ResamplingPositionableSource::setLooping (bool shouldLoop)
+{
+    source.setLooping (shouldLoop);
+}
@@ -0,0 +1,392 @@
+/*
+  ==============================================================================
+
+    The preset library shared by every instance of the plugin.
+
+  ==============================================================================
+*/
+
+#include "PresetLibrary.h"
+#include "PluginProcessor.h"
+#include "BinaryState.h"
+
+namespace
+{
+    // Records in the index journal. Fields may only be appended to them.
+    constexpr auto addRecord    = BinaryState::makeTag ('p', 'a', 'd', 'd');   // int32 id, string name, int32 numTags, strings
+    constexpr auto deleteRecord = BinaryState::makeTag ('p', 'd', 'e', 'l');   // int32 id
+    constexpr auto nextIdRecord = BinaryState::makeTag ('n', 'e', 'x', 't');   // int32 first unused id, written on compaction
+
+    bool replaceFileAtomically (const juce::File& target, const juce::MemoryBlock& data)
+    {
+        juce::TemporaryFile temp (target);
+
+        return temp.getFile().replaceWithData (data.getData(), data.getSize())
+                && temp.overwriteTargetFileWithTemporary();
+    }
+}
+
+//==============================================================================
+PresetLibrary::PresetLibrary()
+    : PresetLibrary (getDefaultDirectory())
+{
+}
+
+PresetLibrary::PresetLibrary (const juce::File& d)
+    : directory (d)
+{
+}
+
+juce::File PresetLibrary::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+             .getChildFile (JucePlugin_Name)
+             .getChildFile ("Presets");
+}
+
+juce::File PresetLibrary::getPresetFile (int id) const
+{
+    return directory.getChildFile (juce::String (id) + ".preset");
+}
+
+juce::File PresetLibrary::getIndexFile() const
+{
+    return directory.getChildFile ("index");
+}
+
+//==============================================================================
+std::vector<PresetLibrary::Preset> PresetLibrary::getPresets()
+{
+    return search ({});
+}
+
+std::vector<PresetLibrary::Preset> PresetLibrary::search (const juce::String& query)
+{
+    const auto terms = juce::StringArray::fromTokens (query.toLowerCase(), false);
+    std::vector<Preset> matches;
+
+    const juce::ScopedLock sl (lock);
+    ensureIndexLoaded();
+
+    for (const auto& item : entries)
+    {
+        const auto& entry = item.second;
+
+        if (std::all_of (terms.begin(), terms.end(), [&entry] (const juce::String& term) { return entry.searchText.contains (term); }))
+            matches.push_back (entry.preset);
+    }
+
+    return sortedByName (std::move (matches));
+}
+
+PresetLibrary::Preset PresetLibrary::getPreset (int id)
+{
+    const juce::ScopedLock sl (lock);
+    ensureIndexLoaded();
+
+    const auto found = entries.find (id);
+    return found != entries.end() ? found->second.preset : Preset();
+}
+
+std::vector<PresetLibrary::Preset> PresetLibrary::sortedByName (std::vector<Preset> presets)
+{
+    std::sort (presets.begin(), presets.end(), [] (const Preset& a, const Preset& b)
+    {
+        return a.name.compareNatural (b.name) < 0;
+    });
+
+    return presets;
+}
+
+//==============================================================================
+int PresetLibrary::save (const juce::String& name, const juce::StringArray& tags, const juce::MemoryBlock& state)
+{
+    Preset preset;
+    preset.name = name.trim().isEmpty() ? "(Unnamed preset)" : name.trim();
+    preset.tags = tags;
+    preset.tags.trim();
+    preset.tags.removeEmptyStrings();
+
+    const juce::ScopedLock sl (lock);
+    ensureIndexLoaded();
+
+    if (readOnly || ! directory.createDirectory())
+        return 0;
+
+    for (const auto& item : entries)
+        if (item.second.preset.name.equalsIgnoreCase (preset.name))
+            preset.id = item.first;
+
+    const auto replacing = preset.id != 0;
+
+    if (! replacing)
+        preset.id = nextId;
+
+    // The state goes down first, so the index never names a preset that isn't there.
+    if (! replaceFileAtomically (getPresetFile (preset.id), state))
+        return 0;
+
+    juce::MemoryBlock record;
+    {
+        juce::MemoryOutputStream out (record, false);
+        writePreset (out, preset);
+    }
+
+    if (! appendRecord (addRecord, record))
+        return 0;
+
+    if (replacing)
+        ++staleRecords;
+
+    nextId = juce::jmax (nextId, preset.id + 1);
+    addEntry (preset);
+
+    compactIfMostlyStale();
+    sendChangeMessage();
+    return preset.id;
+}
+
+bool PresetLibrary::load (int id, juce::MemoryBlock& state)
+{
+    juce::File file;
+
+    {
+        const juce::ScopedLock sl (lock);
+        ensureIndexLoaded();
+
+        if (entries.find (id) == entries.end())
+            return false;
+
+        file = getPresetFile (id);
+    }
+
+    // Outside the lock: saves replace the file in one rename, so this reads either all of the old one or all of the new.
+    return file.loadFileAsData (state) && state.getSize() > 0;
+}
+
+bool PresetLibrary::remove (int id)
+{
+    const juce::ScopedLock sl (lock);
+    ensureIndexLoaded();
+
+    if (readOnly || entries.find (id) == entries.end())
+        return false;
+
+    juce::MemoryBlock record;
+    {
+        juce::MemoryOutputStream out (record, false);
+        out.writeInt (id);
+    }
+
+    if (! appendRecord (deleteRecord, record))
+        return false;
+
+    // The preset's own record and the one that deletes it.
+    entries.erase (id);
+    staleRecords += 2;
+
+    getPresetFile (id).deleteFile();
+
+    compactIfMostlyStale();
+    sendChangeMessage();
+    return true;
+}
+
+//==============================================================================
+void PresetLibrary::ensureIndexLoaded()
+{
+    if (! indexLoaded)
+    {
+        readIndex();
+        indexLoaded = true;
+    }
+}
+
+void PresetLibrary::readIndex()
+{
+    juce::MemoryBlock data;
+
+    if (! getIndexFile().loadFileAsData (data) || data.getSize() == 0)
+        return;
+
+    BinaryState::Reader reader (data.getData(), data.getSize());
+
+    if (! reader.isValid())
+    {
+        // Written by a newer build: readable only by that build, so leave it be. Anything else is rebuilt from empty.
+        readOnly = BinaryState::isBinaryState (data.getData(), data.getSize());
+        indexNeedsRewrite = ! readOnly;
+        return;
+    }
+
+    while (reader.next())
+    {
+        juce::MemoryInputStream in (reader.getChunkData(), reader.getChunkSize(), false);
+
+        switch (reader.getTag())
+        {
+            case addRecord:
+            {
+                const auto preset = readPreset (in);
+
+                if (preset.id > 0)
+                {
+                    if (entries.find (preset.id) != entries.end())
+                        ++staleRecords;
+
+                    nextId = juce::jmax (nextId, preset.id + 1);
+                    addEntry (preset);
+                }
+                break;
+            }
+
+            case deleteRecord:
+                if (entries.erase (in.readInt()) > 0)
+                    staleRecords += 2;
+                break;
+
+            case nextIdRecord:
+                nextId = juce::jmax (nextId, in.readInt());
+                break;
+
+            default:
+                break;  // from a newer build
+        }
+    }
+
+    // A record cut short by a crash would swallow the next one appended after it.
+    indexNeedsRewrite = reader.getPosition() != data.getSize();
+}
+
+bool PresetLibrary::appendRecord (juce::uint32 tag, const juce::MemoryBlock& payload)
+{
+    if (indexNeedsRewrite && ! rewriteIndex())
+        return false;
+
+    const auto file = getIndexFile();
+    const auto isNew = file.getSize() == 0;
+
+    // FileOutputStream appends to an existing file.
+    juce::FileOutputStream out (file);
+
+    if (! out.openedOk())
+        return false;
+
+    if (isNew)
+        BinaryState::writeHeader (out);
+
+    BinaryState::writeChunk (out, tag, payload);
+    out.flush();
+
+    if (out.getStatus().failed())
+    {
+        indexNeedsRewrite = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool PresetLibrary::rewriteIndex()
+{
+    juce::MemoryBlock data;
+    {
+        juce::MemoryOutputStream out (data, false);
+        BinaryState::writeHeader (out);
+
+        // Kept so an ID freed by a delete is never handed to a different preset.
+        juce::MemoryBlock next;
+        {
+            juce::MemoryOutputStream nextOut (next, false);
+            nextOut.writeInt (nextId);
+        }
+
+        BinaryState::writeChunk (out, nextIdRecord, next);
+
+        for (const auto& item : entries)
+        {
+            juce::MemoryBlock record;
+            {
+                juce::MemoryOutputStream recordOut (record, false);
+                writePreset (recordOut, item.second.preset);
+            }
+
+            BinaryState::writeChunk (out, addRecord, record);
+        }
+    }
+
+    if (! replaceFileAtomically (getIndexFile(), data))
+        return false;
+
+    staleRecords = 0;
+    indexNeedsRewrite = false;
+    return true;
+}
+
+void PresetLibrary::compactIfMostlyStale()
+{
+    if (staleRecords > juce::jmax (minStaleRecordsBeforeCompacting, (int) entries.size()))
+        rewriteIndex();
+}
+
+void PresetLibrary::addEntry (const Preset& preset)
+{
+    auto& entry = entries[preset.id];
+    entry.preset = preset;
+    entry.searchText = (preset.name + " " + preset.tags.joinIntoString (" ")).toLowerCase();
+}
+
+//==============================================================================
+void PresetLibrary::writePreset (juce::OutputStream& out, const Preset& preset)
+{
+    out.writeInt (preset.id);
+    out.writeString (preset.name);
+    out.writeInt (preset.tags.size());
+
+    for (const auto& tag : preset.tags)
+        out.writeString (tag);
+}
+
+PresetLibrary::Preset PresetLibrary::readPreset (juce::InputStream& in)
+{
+    Preset preset;
+    preset.id = in.readInt();
+    preset.name = in.readString();
+
+    for (auto numTags = in.readInt(); numTags > 0 && ! in.isExhausted(); --numTags)
+        preset.tags.add (in.readString());
+
+    return preset;
+}
+
+//==============================================================================
+StatePresets::StatePresets (AudioProcessor2AudioProcessor& proc)
+    : pluginProcessor { proc }
+{
+}
+
+void StatePresets::savePreset (const juce::String& presetName, const juce::StringArray& tags)
+{
+    juce::MemoryBlock state;
+    pluginProcessor.getPresetState (state);
+
+    if (const auto id = library->save (presetName, tags, state))
+        currentPresetID = id;
+}
+
+void StatePresets::loadPreset (int presetID)
+{
+    juce::MemoryBlock state;
+
+    if (library->load (presetID, state))
+    {
+        pluginProcessor.setStateInformation (state.getData(), (int) state.getSize());
+        currentPresetID = presetID;
+    }
+}
+
+void StatePresets::deletePreset()
+{
+    if (currentPresetID != 0 && library->remove (currentPresetID))
+        currentPresetID = 0;
+}
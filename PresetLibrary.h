@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    The preset library shared by every instance of the plugin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class AudioProcessor2AudioProcessor;
+
+//==============================================================================
+/**
+    Presets on disk, one file per preset, plus an index of names and tags.
+
+    Only the index is held in memory. It is read the first time anything asks
+    for it, not when the library is created. A preset's state is read from its
+    own file only when it is loaded, so a library of thousands costs one small
+    file read per process.
+
+    The index is a journal in the BinaryState format: a record is appended
+    for each save or delete, and replayed on reading. Every change is a small
+    append rather than a rewrite. A record cut short by a crash is dropped,
+    and the journal is rewritten without it before anything else is
+    appended. Once most of its records are stale, the journal is compacted.
+    Preset files and compacted journals are written to a temporary file and
+    renamed into place. Readers only ever see a whole preset, and the index
+    never names a preset whose file isn't there yet.
+
+    All members may be called from any thread. Share one instance per process
+    through a juce::SharedResourcePointer. Listeners are told, on the message
+    thread, whenever a preset is saved or deleted through any instance.
+*/
+class PresetLibrary  : public juce::ChangeBroadcaster
+{
+public:
+    struct Preset
+    {
+        int id = 0;             // never 0 for a stored preset, so usable as a ComboBox item ID
+        juce::String name;
+        juce::StringArray tags;
+    };
+
+    PresetLibrary();
+    explicit PresetLibrary (const juce::File& directory);
+
+    static juce::File getDefaultDirectory();
+
+    //==============================================================================
+    /** Every preset, sorted by name. */
+    std::vector<Preset> getPresets();
+
+    /** Presets whose name or tags contain every word of the query, ignoring case, sorted by name.
+        An empty query matches everything. */
+    std::vector<Preset> search (const juce::String& query);
+
+    /** The preset's name and tags, or an empty Preset if there's no such ID. */
+    Preset getPreset (int id);
+
+    //==============================================================================
+    /** Stores a state under the given name, replacing any preset that already has
+        that name. Returns the preset's ID, or 0 if it couldn't be written. */
+    int save (const juce::String& name, const juce::StringArray& tags, const juce::MemoryBlock& state);
+
+    /** Reads a preset's state; false if there is no such preset or its file can't be read. */
+    bool load (int id, juce::MemoryBlock& state);
+
+    bool remove (int id);
+
+private:
+    struct Entry
+    {
+        Preset preset;
+        juce::String searchText;        // name and tags, lower case
+    };
+
+    static constexpr int minStaleRecordsBeforeCompacting = 64;
+
+    void ensureIndexLoaded();
+    void readIndex();
+    bool appendRecord (juce::uint32 tag, const juce::MemoryBlock& payload);
+    bool rewriteIndex();
+    void compactIfMostlyStale();
+    void addEntry (const Preset& preset);
+
+    juce::File getPresetFile (int id) const;
+    juce::File getIndexFile() const;
+
+    static void writePreset (juce::OutputStream& out, const Preset& preset);
+    static Preset readPreset (juce::InputStream& in);
+    static std::vector<Preset> sortedByName (std::vector<Preset> presets);
+
+    const juce::File directory;
+
+    juce::CriticalSection lock;
+    bool indexLoaded = false;
+    bool readOnly = false;              // the index was written by a newer build
+    bool indexNeedsRewrite = false;     // it ends in a torn record, or isn't an index at all
+    std::map<int, Entry> entries;
+    int nextId = 1;
+    int staleRecords = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetLibrary)
+};
+
+//==============================================================================
+/**
+    One instance's view of the preset library: saves and recalls its state
+    and remembers which preset is current.
+*/
+class StatePresets
+{
+public:
+    explicit StatePresets (AudioProcessor2AudioProcessor& processor);
+
+    /** Replaces a preset of the same name, if there is one. */
+    void savePreset (const juce::String& presetName, const juce::StringArray& tags = {});
+    void loadPreset (int presetID);
+    void deletePreset();
+
+    /** 0 when the current settings don't come from a preset. */
+    int getCurrentPresetId() const noexcept                 { return currentPresetID; }
+
+    PresetLibrary& getLibrary() noexcept                    { return *library; }
+
+private:
+    AudioProcessor2AudioProcessor& pluginProcessor;
+    juce::SharedResourcePointer<PresetLibrary> library;
+    int currentPresetID { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StatePresets)
+};
@@ -0,0 +1,431 @@
+/*
+  ==============================================================================
+
+    Debug instrumentation that catches allocations, locks and blocking calls
+    made on the audio thread.
+
+    Deliberately free of JUCE: everything here can run from inside malloc.
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafetyGuard.h"
+
+#if ! REALTIME_SAFETY_GUARD
+
+std::int64_t RealtimeSafetyGuard::getNumViolations() noexcept    { return 0; }
+void RealtimeSafetyGuard::writeReport (std::FILE*)              {}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined (__linux__) && defined (__GLIBC__)
+ #define REALTIME_GUARD_GLIBC 1
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#elif defined (__APPLE__)
+ #define REALTIME_GUARD_EXECINFO 1
+ #include <execinfo.h>
+#elif defined (_WIN32)
+ #define REALTIME_GUARD_WINDOWS 1
+ #include <windows.h>
+#endif
+
+#if REALTIME_GUARD_GLIBC
+ #define REALTIME_GUARD_EXECINFO 1
+#endif
+
+namespace
+{
+    using RealtimeSafetyGuard::Violation;
+
+    constexpr int maxFrames = 16;
+    constexpr int framesToSkip = 2;         // record() and the hook that called it
+    constexpr int maxCallSites = 512;
+
+    // Trivially constructible, so the static table is zero-filled before any
+    // hook can run, however early in start-up that is.
+    struct CallSite
+    {
+        std::atomic<std::uint64_t> key;
+        std::atomic<bool> ready;
+        std::atomic<std::int64_t> count;
+        Violation kind;
+        int numFrames;
+        void* frames[maxFrames];
+    };
+
+    CallSite callSites[maxCallSites];
+    std::atomic<std::int64_t> totals[(int) Violation::numKinds];
+    std::atomic<std::int64_t> numDroppedSites;
+
+    thread_local int realtimeDepth = 0;
+    thread_local bool insideGuard = false;
+
+    const char* getKindName (Violation kind) noexcept
+    {
+        switch (kind)
+        {
+            case Violation::allocation:     return "allocation";
+            case Violation::deallocation:   return "deallocation";
+            case Violation::lock:           return "lock";
+            case Violation::wait:           return "wait";
+            case Violation::sleep:          return "sleep";
+            case Violation::fileIO:         return "file I/O";
+            case Violation::numKinds:
+            default:                        return "?";
+        }
+    }
+
+    int captureStack (void** frames, int maxToCapture) noexcept
+    {
+       #if REALTIME_GUARD_EXECINFO
+        return backtrace (frames, maxToCapture);
+       #elif REALTIME_GUARD_WINDOWS
+        return (int) CaptureStackBackTrace (0, (DWORD) maxToCapture, frames, nullptr);
+       #else
+        (void) frames; (void) maxToCapture;
+        return 0;
+       #endif
+    }
+
+    std::uint64_t hashStack (void* const* frames, int numFrames, Violation kind) noexcept
+    {
+        // FNV-1a; zero marks an empty slot, so it's never returned.
+        auto hash = (std::uint64_t) 0xcbf29ce484222325ull ^ (std::uint64_t) kind;
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            hash ^= (std::uint64_t) (std::uintptr_t) frames[i];
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash != 0 ? hash : 1;
+    }
+
+    inline bool shouldRecord() noexcept
+    {
+        return realtimeDepth > 0 && ! insideGuard;
+    }
+
+    void record (Violation kind) noexcept
+    {
+        // Anything the stack walk itself allocates or locks is not the caller's fault.
+        insideGuard = true;
+
+        totals[(int) kind].fetch_add (1, std::memory_order_relaxed);
+
+        void* frames[maxFrames + framesToSkip];
+        const auto numCaptured = captureStack (frames, maxFrames + framesToSkip);
+        const auto skipped = numCaptured > framesToSkip ? framesToSkip : 0;
+        auto* const siteFrames = frames + skipped;
+        const auto numSiteFrames = numCaptured - skipped;
+        const auto key = hashStack (siteFrames, numSiteFrames, kind);
+
+        auto placed = false;
+
+        for (int probe = 0; probe < maxCallSites && ! placed; ++probe)
+        {
+            auto& site = callSites[(key + (std::uint64_t) probe) % maxCallSites];
+            auto existing = site.key.load (std::memory_order_acquire);
+
+            if (existing == 0 && site.key.compare_exchange_strong (existing, key, std::memory_order_acq_rel))
+            {
+                site.kind = kind;
+                site.numFrames = numSiteFrames;
+                std::memcpy (site.frames, siteFrames, sizeof (void*) * (size_t) numSiteFrames);
+                site.ready.store (true, std::memory_order_release);
+                existing = key;
+            }
+
+            if (existing == key)
+            {
+                site.count.fetch_add (1, std::memory_order_relaxed);
+                placed = true;
+            }
+        }
+
+        if (! placed)
+            numDroppedSites.fetch_add (1, std::memory_order_relaxed);
+
+        insideGuard = false;
+    }
+
+    inline void check (Violation kind) noexcept
+    {
+        if (shouldRecord())
+            record (kind);
+    }
+
+    //==============================================================================
+    struct ReportAtExit
+    {
+        ReportAtExit()
+        {
+            // The first stack walk may load the unwinder, which allocates; get that over with now.
+            void* frames[2];
+            captureStack (frames, 2);
+        }
+
+        ~ReportAtExit()
+        {
+            RealtimeSafetyGuard::writeReport (stderr);
+
+            if (const auto* path = std::getenv ("REALTIME_GUARD_REPORT"))
+            {
+                if (auto* file = std::fopen (path, "a"))
+                {
+                    RealtimeSafetyGuard::writeReport (file);
+                    std::fclose (file);
+                }
+            }
+        }
+    };
+
+    ReportAtExit reportAtExit;
+}
+
+//==============================================================================
+RealtimeSafetyGuard::ScopedRealtimeContext::ScopedRealtimeContext() noexcept     { ++realtimeDepth; }
+RealtimeSafetyGuard::ScopedRealtimeContext::~ScopedRealtimeContext() noexcept    { --realtimeDepth; }
+
+std::int64_t RealtimeSafetyGuard::getNumViolations() noexcept
+{
+    std::int64_t total = 0;
+
+    for (auto& count : totals)
+        total += count.load (std::memory_order_relaxed);
+
+    return total;
+}
+
+void RealtimeSafetyGuard::writeReport (std::FILE* destination)
+{
+    if (destination == nullptr)
+        return;
+
+    const auto wasInsideGuard = insideGuard;
+    insideGuard = true;
+
+    std::fprintf (destination, "Real-time safety report: %lld violation(s)\n", (long long) getNumViolations());
+
+    for (int kind = 0; kind < (int) Violation::numKinds; ++kind)
+        if (const auto count = totals[kind].load())
+            std::fprintf (destination, "  %-14s %lld\n", getKindName ((Violation) kind), (long long) count);
+
+    // Worst offenders first.
+    int order[maxCallSites];
+    int numSites = 0;
+
+    for (int i = 0; i < maxCallSites; ++i)
+        if (callSites[i].ready.load (std::memory_order_acquire))
+            order[numSites++] = i;
+
+    std::sort (order, order + numSites, [] (int a, int b) { return callSites[a].count.load() > callSites[b].count.load(); });
+
+    for (int i = 0; i < numSites; ++i)
+    {
+        const auto& site = callSites[order[i]];
+        std::fprintf (destination, "\n  %lld x %s\n", (long long) site.count.load(), getKindName (site.kind));
+
+       #if REALTIME_GUARD_EXECINFO
+        if (auto** symbols = backtrace_symbols (site.frames, site.numFrames))
+        {
+            for (int f = 0; f < site.numFrames; ++f)
+                std::fprintf (destination, "    #%-2d %s\n", f, symbols[f]);
+
+            std::free (symbols);
+            continue;
+        }
+       #endif
+
+        for (int f = 0; f < site.numFrames; ++f)
+            std::fprintf (destination, "    #%-2d %p\n", f, site.frames[f]);
+    }
+
+    if (const auto dropped = numDroppedSites.load())
+        std::fprintf (destination, "\n  %lld more violation(s) from call sites that didn't fit in the table\n", (long long) dropped);
+
+    std::fflush (destination);
+    insideGuard = wasInsideGuard;
+}
+
+//==============================================================================
+#if REALTIME_GUARD_GLIBC
+
+// glibc's own entry points, so the hooks below needn't look anything up to allocate.
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void  __libc_free (void*);
+}
+
+namespace
+{
+    template <typename Fn>
+    Fn getNext (std::atomic<Fn>& cache, const char* name) noexcept
+    {
+        auto fn = cache.load (std::memory_order_relaxed);
+
+        if (fn == nullptr)
+        {
+            fn = reinterpret_cast<Fn> (dlsym (RTLD_NEXT, name));
+            cache.store (fn, std::memory_order_relaxed);
+        }
+
+        return fn;
+    }
+
+    std::atomic<int (*) (pthread_mutex_t*)> nextMutexLock;
+    std::atomic<int (*) (pthread_cond_t*, pthread_mutex_t*)> nextCondWait;
+    std::atomic<int (*) (pthread_cond_t*, pthread_mutex_t*, const timespec*)> nextCondTimedWait;
+    std::atomic<int (*) (sem_t*)> nextSemWait;
+    std::atomic<int (*) (sem_t*, const timespec*)> nextSemTimedWait;
+    std::atomic<int (*) (const timespec*, timespec*)> nextNanosleep;
+    std::atomic<int (*) (useconds_t)> nextUsleep;
+    std::atomic<ssize_t (*) (int, void*, size_t)> nextRead;
+    std::atomic<ssize_t (*) (int, const void*, size_t)> nextWrite;
+}
+
+extern "C"
+{
+    void* malloc (size_t size)                      { check (Violation::allocation); return __libc_malloc (size); }
+    void* calloc (size_t count, size_t size)        { check (Violation::allocation); return __libc_calloc (count, size); }
+    void* realloc (void* ptr, size_t size)          { check (Violation::allocation); return __libc_realloc (ptr, size); }
+
+    // The aligned forms; the aligned operator new comes through these.
+    void* memalign (size_t alignment, size_t size)        { check (Violation::allocation); return __libc_memalign (alignment, size); }
+    void* aligned_alloc (size_t alignment, size_t size)   { check (Violation::allocation); return __libc_memalign (alignment, size); }
+
+    int posix_memalign (void** result, size_t alignment, size_t size)
+    {
+        check (Violation::allocation);
+
+        if (alignment == 0 || alignment % sizeof (void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        auto* ptr = __libc_memalign (alignment, size);
+
+        if (ptr == nullptr)
+            return ENOMEM;
+
+        *result = ptr;
+        return 0;
+    }
+
+    void free (void* ptr)
+    {
+        if (ptr != nullptr)
+            check (Violation::deallocation);
+
+        __libc_free (ptr);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        check (Violation::lock);
+        return getNext (nextMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* cond, pthread_mutex_t* mutex)
+    {
+        check (Violation::wait);
+        return getNext (nextCondWait, "pthread_cond_wait") (cond, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* cond, pthread_mutex_t* mutex, const timespec* time)
+    {
+        check (Violation::wait);
+        return getNext (nextCondTimedWait, "pthread_cond_timedwait") (cond, mutex, time);
+    }
+
+    int sem_wait (sem_t* semaphore)
+    {
+        check (Violation::wait);
+        return getNext (nextSemWait, "sem_wait") (semaphore);
+    }
+
+    int sem_timedwait (sem_t* semaphore, const timespec* time)
+    {
+        check (Violation::wait);
+        return getNext (nextSemTimedWait, "sem_timedwait") (semaphore, time);
+    }
+
+    int nanosleep (const timespec* duration, timespec* remaining)
+    {
+        check (Violation::sleep);
+        return getNext (nextNanosleep, "nanosleep") (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        check (Violation::sleep);
+        return getNext (nextUsleep, "usleep") (microseconds);
+    }
+
+    ssize_t read (int fd, void* buffer, size_t size)
+    {
+        check (Violation::fileIO);
+        return getNext (nextRead, "read") (fd, buffer, size);
+    }
+
+    ssize_t write (int fd, const void* buffer, size_t size)
+    {
+        check (Violation::fileIO);
+        return getNext (nextWrite, "write") (fd, buffer, size);
+    }
+}
+
+#else
+
+//==============================================================================
+// Elsewhere only the C++ allocator can be replaced portably.
+void* operator new (std::size_t size)
+{
+    check (Violation::allocation);
+
+    if (auto* ptr = std::malloc (size != 0 ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    check (Violation::allocation);
+    return std::malloc (size != 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size)                                  { return ::operator new (size); }
+void* operator new[] (std::size_t size, const std::nothrow_t& tag) noexcept  { return ::operator new (size, tag); }
+
+void operator delete (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        check (Violation::deallocation);
+
+    std::free (ptr);
+}
+
+void operator delete (void* ptr, const std::nothrow_t&) noexcept          { ::operator delete (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept                    { ::operator delete (ptr); }
+void operator delete[] (void* ptr) noexcept                               { ::operator delete (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept        { ::operator delete (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept                  { ::operator delete (ptr); }
+
+#endif
+
+#endif
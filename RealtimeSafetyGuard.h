@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    Debug instrumentation that catches allocations, locks and blocking calls
+    made on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+
+/** Off unless the build defines it; with it off, everything below compiles to nothing. */
+#ifndef REALTIME_SAFETY_GUARD
+ #define REALTIME_SAFETY_GUARD 0
+#endif
+
+//==============================================================================
+/**
+    While a ScopedRealtimeContext is alive on a thread, hooks in the allocator
+    and in the blocking primitives record every call that thread makes. Each
+    record holds the kind of call and a stack trace. Repeats from the same
+    stack add to one count per call site. A report goes to stderr at exit, and
+    is also appended to the file named by the REALTIME_GUARD_REPORT
+    environment variable when that is set.
+
+    What is hooked:
+    - operator new and delete.
+    - On Linux with glibc, also malloc, calloc, realloc, free and the aligned
+      allocators (posix_memalign, aligned_alloc, memalign).
+    - On Linux with glibc, also pthread mutex locks, condition waits,
+      semaphore waits, sleeps and blocking read and write.
+
+    The hooks must be the ones the process resolves. That holds when this
+    file is linked into the executable: the Standalone build, the batch
+    renderer, the benchmarks or a test host. A plug-in dlopen'd by a DAW
+    sees the host's allocator instead.
+
+    Outside a context the hooks cost one thread-local read. Recording uses a
+    fixed table and never allocates, so the guard can stay on for long soak
+    runs.
+*/
+namespace RealtimeSafetyGuard
+{
+    enum class Violation
+    {
+        allocation,
+        deallocation,
+        lock,
+        wait,
+        sleep,
+        fileIO,
+        numKinds
+    };
+
+    /** Marks the current thread as real-time until destroyed; nests. */
+    struct ScopedRealtimeContext
+    {
+       #if REALTIME_SAFETY_GUARD
+        ScopedRealtimeContext() noexcept;
+        ~ScopedRealtimeContext() noexcept;
+
+        ScopedRealtimeContext (const ScopedRealtimeContext&) = delete;
+        ScopedRealtimeContext& operator= (const ScopedRealtimeContext&) = delete;
+       #else
+        ScopedRealtimeContext() noexcept {}
+       #endif
+    };
+
+    /** Total violations recorded so far, of every kind. Always 0 with the guard compiled out. */
+    std::int64_t getNumViolations() noexcept;
+
+    /** Writes the per-call-site report; symbolising the stacks allocates, so don't call it from a real-time context. */
+    void writeReport (std::FILE* destination);
+}
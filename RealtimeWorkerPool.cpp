@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+
+    Small pool of real-time worker threads for splitting a block's work.
+
+  ==============================================================================
+*/
+
+#include "RealtimeWorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#else
+ #include <thread>
+#endif
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <semaphore.h>
+ #include <ctime>
+#endif
+
+namespace
+{
+    // Roughly 20-50 µs of polling, a fraction of a typical block, before a worker parks.
+    constexpr int spinIterations = 4000;
+
+    // Highest priority juce::Thread offers; maps to a real-time class where the OS allows it.
+    constexpr int realtimePriority = 10;
+
+    inline void spinPause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+
+    inline juce::uint64 packRange (juce::uint32 begin, juce::uint32 end) noexcept
+    {
+        return ((juce::uint64) begin << 32) | end;
+    }
+
+    // Hands out a different core offset to each pool that pins, so instances don't pile onto the same cores.
+    std::atomic<juce::uint32> nextPinnedCore { 0 };
+
+    //==============================================================================
+    /** The OS's own counting semaphore. Unlike juce::WaitableEvent, which locks a mutex
+        to signal a condition variable, posting never takes a lock in user space: the
+        audio thread only ever makes an atomic update and, if someone is waiting, a wake call.
+    */
+    class WakeSemaphore
+    {
+    public:
+       #if JUCE_MAC || JUCE_IOS
+        WakeSemaphore()     : semaphore (dispatch_semaphore_create (0)) {}
+        ~WakeSemaphore()    { dispatch_release (semaphore); }
+
+        void post() noexcept                { dispatch_semaphore_signal (semaphore); }
+        void wait (int milliseconds)        { dispatch_semaphore_wait (semaphore, dispatch_time (DISPATCH_TIME_NOW, (int64_t) milliseconds * 1000000)); }
+
+    private:
+        dispatch_semaphore_t semaphore;
+       #elif JUCE_WINDOWS
+        WakeSemaphore()     : semaphore (CreateSemaphoreW (nullptr, 0, LONG_MAX, nullptr)) {}
+        ~WakeSemaphore()    { CloseHandle (semaphore); }
+
+        void post() noexcept                { ReleaseSemaphore (semaphore, 1, nullptr); }
+        void wait (int milliseconds)        { WaitForSingleObject (semaphore, (DWORD) milliseconds); }
+
+    private:
+        HANDLE semaphore;
+       #else
+        WakeSemaphore()     { sem_init (&semaphore, 0, 0); }
+        ~WakeSemaphore()    { sem_destroy (&semaphore); }
+
+        void post() noexcept                { sem_post (&semaphore); }
+
+        void wait (int milliseconds)
+        {
+            timespec deadline;
+            clock_gettime (CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long) milliseconds * 1000000;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000;
+            deadline.tv_nsec %= 1000000000;
+
+            sem_timedwait (&semaphore, &deadline);
+        }
+
+    private:
+        sem_t semaphore;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (WakeSemaphore)
+    };
+}
+
+//==============================================================================
+class RealtimeWorkerPool::Worker  : public juce::Thread
+{
+public:
+    Worker (RealtimeWorkerPool& p, int participantIndex, juce::uint32 coreMask)
+        : juce::Thread ("Channel worker " + juce::String (participantIndex)),
+          pool (p),
+          participant (participantIndex),
+          affinityMask (coreMask)
+    {
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wake();
+        stopThread (1000);
+    }
+
+    /** Wakes the thread if it has parked; costs nothing if it is still spinning. */
+    void wake() noexcept
+    {
+        if (parked.exchange (false))
+            semaphore.post();
+    }
+
+    void run() override
+    {
+        // Set from the thread itself: juce::Thread::setAffinityMask() only applies at the next start.
+        if (affinityMask != 0)
+            juce::Thread::setCurrentThreadAffinityMask (affinityMask);
+
+        // Flush-to-zero is per thread; the host only sets it on its own audio thread.
+        const juce::ScopedNoDenormals noDenormals;
+        auto seen = pool.batch.load (std::memory_order_acquire);
+
+        while (! threadShouldExit())
+        {
+            if (! waitForBatch (seen))
+                continue;
+
+            pool.participate (participant);
+        }
+    }
+
+private:
+    bool waitForBatch (juce::uint32& seen)
+    {
+        for (int i = 0; i < spinIterations; ++i)
+        {
+            const auto current = pool.batch.load (std::memory_order_acquire);
+
+            if (current != seen)
+            {
+                seen = current;
+                return true;
+            }
+
+            spinPause();
+        }
+
+        // Announce the park before the final check, so a batch published in
+        // between either is seen here or finds the flag set and signals.
+        parked.store (true);
+
+        const auto current = pool.batch.load();
+
+        if (current != seen)
+        {
+            // If the caller got to the flag first, the semaphore is left posted
+            // and the next park just returns early.
+            parked.store (false);
+            seen = current;
+            return true;
+        }
+
+        if (! threadShouldExit())
+            semaphore.wait (100);
+
+        parked.store (false);
+        return false;
+    }
+
+    RealtimeWorkerPool& pool;
+    const int participant;
+    const juce::uint32 affinityMask;
+
+    std::atomic<bool> parked { false };
+    WakeSemaphore semaphore;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+RealtimeWorkerPool::RealtimeWorkerPool() = default;
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    stop();
+}
+
+void RealtimeWorkerPool::start (int newNumWorkers, bool pinToCores)
+{
+    stop();
+
+    numWorkers = juce::jlimit (0, maxWorkers, newNumWorkers);
+    const auto numCpus = juce::SystemStats::getNumCpus();
+
+    // Core 0 is left to the host's own audio thread; the rest are shared out between pinning pools in turn.
+    const auto canPin = pinToCores && numCpus > numWorkers && numCpus <= 32;
+    const auto firstCore = canPin ? nextPinnedCore.fetch_add ((juce::uint32) numWorkers) : 0u;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        const auto core = canPin ? 1 + (int) ((firstCore + (juce::uint32) i) % (juce::uint32) (numCpus - 1)) : 0;
+        const auto mask = canPin ? (juce::uint32) 1 << core : 0u;
+
+        workers.push_back (std::make_unique<Worker> (*this, i + 1, mask));
+        workers.back()->startThread (realtimePriority);
+    }
+}
+
+void RealtimeWorkerPool::stop()
+{
+    workers.clear();
+    numWorkers = 0;
+}
+
+//==============================================================================
+void RealtimeWorkerPool::run (Job job, void* context, int numJobs) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    if (numWorkers == 0 || numJobs == 1)
+    {
+        for (int i = 0; i < numJobs; ++i)
+            job (context, i);
+
+        return;
+    }
+
+    const auto numParticipants = juce::jmin (numWorkers + 1, numJobs);
+
+    currentJob.store (job, std::memory_order_relaxed);
+    currentContext.store (context, std::memory_order_relaxed);
+    remaining.store (numJobs, std::memory_order_relaxed);
+
+    for (int p = 0; p <= numWorkers; ++p)
+    {
+        const auto begin = (juce::uint32) (numJobs * juce::jmin (p, numParticipants) / numParticipants);
+        const auto end   = (juce::uint32) (numJobs * juce::jmin (p + 1, numParticipants) / numParticipants);
+        ranges[(size_t) p].bounds.store (packRange (begin, end), std::memory_order_release);
+    }
+
+    batch.fetch_add (1);
+
+    for (int i = 0; i < numParticipants - 1; ++i)
+        workers[(size_t) i]->wake();
+
+    participate (0);
+
+    while (remaining.load (std::memory_order_acquire) > 0)
+        spinPause();
+}
+
+bool RealtimeWorkerPool::takeFront (int participant, int& index) noexcept
+{
+    auto& bounds = ranges[(size_t) participant].bounds;
+    auto current = bounds.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        const auto begin = (juce::uint32) (current >> 32);
+        const auto end = (juce::uint32) current;
+
+        if (begin >= end)
+            return false;
+
+        if (bounds.compare_exchange_weak (current, packRange (begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            index = (int) begin;
+            return true;
+        }
+    }
+}
+
+bool RealtimeWorkerPool::stealBack (int participant, int& index) noexcept
+{
+    for (int offset = 1; offset <= numWorkers; ++offset)
+    {
+        auto& bounds = ranges[(size_t) ((participant + offset) % (numWorkers + 1))].bounds;
+        auto current = bounds.load (std::memory_order_acquire);
+
+        for (;;)
+        {
+            const auto begin = (juce::uint32) (current >> 32);
+            const auto end = (juce::uint32) current;
+
+            if (begin >= end)
+                break;
+
+            if (bounds.compare_exchange_weak (current, packRange (begin, end - 1), std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                index = (int) end - 1;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void RealtimeWorkerPool::participate (int participant) noexcept
+{
+    int index;
+
+    while (takeFront (participant, index) || stealBack (participant, index))
+    {
+        // Claiming an index from this batch's ranges means the job below belongs to it too.
+        const auto job = currentJob.load (std::memory_order_relaxed);
+        job (currentContext.load (std::memory_order_relaxed), index);
+
+        remaining.fetch_sub (1, std::memory_order_acq_rel);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    Small pool of real-time worker threads for splitting a block's work.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Runs a batch of independent jobs on the calling thread plus a few
+    high-priority worker threads, and returns once all of them are done.
+
+    Jobs are dealt out in contiguous ranges, one per participant. Each
+    participant takes from the front of its own range and, once that is empty,
+    steals from the back of the others. Nothing is locked and nothing is
+    allocated once start() has returned.
+
+    Between batches a worker spins for a short while, so back-to-back blocks
+    don't pay for a wake-up, then parks on an OS semaphore. The audio thread
+    only posts to workers that have actually parked, and posting takes no
+    lock. While the workers finish, the caller spins instead of sleeping.
+
+    start() and stop() allocate and must not be called while run() may be
+    running, i.e. only from prepareToPlay/releaseResources or the destructor.
+*/
+class RealtimeWorkerPool
+{
+public:
+    using Job = void (*) (void* context, int index);
+
+    static constexpr int maxWorkers = 15;
+
+    RealtimeWorkerPool();
+    ~RealtimeWorkerPool();
+
+    /** Starts numWorkers threads (clamped to maxWorkers). With pinToCores, and where the
+        machine has enough cores, each is pinned to its own core other than core 0; successive
+        pools pinned this way get successive cores, so several instances spread out.
+    */
+    void start (int numWorkers, bool pinToCores = false);
+    void stop();
+
+    int getNumWorkers() const noexcept      { return numWorkers; }
+
+    /** Calls job (context, i) once for every i in [0, numJobs) and waits for all of them. */
+    void run (Job job, void* context, int numJobs) noexcept;
+
+private:
+    class Worker;
+
+    // Half-open range of job indices, packed as (begin << 32) | end so it can be claimed with one CAS.
+    struct alignas (64) JobRange
+    {
+        std::atomic<juce::uint64> bounds { 0 };
+    };
+
+    bool takeFront (int participant, int& index) noexcept;
+    bool stealBack (int participant, int& index) noexcept;
+    void participate (int participant) noexcept;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    int numWorkers = 0;
+
+    std::array<JobRange, maxWorkers + 1> ranges;
+    std::atomic<Job> currentJob { nullptr };
+    std::atomic<void*> currentContext { nullptr };
+    std::atomic<int> remaining { 0 };
+    std::atomic<juce::uint32> batch { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeWorkerPool)
+};
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    A component whose refresh timer runs only while it is on screen.
+
+  ==============================================================================
+*/
+
+#include "ShowingTimerComponent.h"
+
+//==============================================================================
+ShowingTimerComponent::ShowingTimerComponent (int rateHz)
+    : refreshRateHz (rateHz)
+{
+}
+
+ShowingTimerComponent::~ShowingTimerComponent()
+{
+    stopTimer();
+}
+
+void ShowingTimerComponent::visibilityChanged()
+{
+    updateTimer();
+}
+
+void ShowingTimerComponent::parentHierarchyChanged()
+{
+    // visibilityChanged() only hears about this component; this catches the editor window opening and closing.
+    updateTimer();
+}
+
+void ShowingTimerComponent::updateTimer()
+{
+    const auto shouldRun = isShowing();
+
+    if (shouldRun == timerRunning)
+        return;
+
+    timerRunning = shouldRun;
+
+    if (shouldRun)
+    {
+        showingChanged (true);
+        startTimerHz (refreshRateHz);
+    }
+    else
+    {
+        stopTimer();
+        showingChanged (false);
+    }
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    A component whose refresh timer runs only while it is on screen.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Base for the editor's live views. The timer runs at the given rate while
+    the component is showing and stops when it is hidden, so a hidden tab or a
+    closed editor costs the message thread nothing.
+
+    Subclasses implement timerCallback(), and can override showingChanged() to
+    start or stop whatever feeds them.
+*/
+class ShowingTimerComponent  : public juce::Component, private juce::Timer
+{
+public:
+    explicit ShowingTimerComponent (int refreshRateHz);
+    ~ShowingTimerComponent() override;
+
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
+
+protected:
+    /** Called just before the timer starts, and just after it stops. */
+    virtual void showingChanged (bool /*isNowShowing*/) {}
+
+private:
+    void updateTimer();
+
+    const int refreshRateHz;
+    bool timerRunning = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ShowingTimerComponent)
+};
@@ -0,0 +1,273 @@
+/*
+  ==============================================================================
+
+    Read-ahead wrapper that keeps file reading and decoding off the audio thread.
+
+  ==============================================================================
+*/
+
+#include "StreamingAudioSource.h"
+#include "RealtimeSafetyGuard.h"
+
+//==============================================================================
+StreamingAudioSource::StreamingAudioSource (juce::PositionableAudioSource& s,
+                                            juce::TimeSliceThread& t,
+                                            int channels,
+                                            double secondsToBuffer,
+                                            double rateOfSource)
+    : source (s),
+      thread (t),
+      numChannels (juce::jmax (1, channels)),
+      readAheadSeconds (secondsToBuffer),
+      sourceSampleRate (rateOfSource)
+{
+    jassert (readAheadSeconds > 0.0);
+}
+
+StreamingAudioSource::~StreamingAudioSource()
+{
+    releaseResources();
+}
+
+//==============================================================================
+void StreamingAudioSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+    thread.removeTimeSliceClient (this);
+    isPrepared = false;
+
+    source.prepareToPlay (samplesPerBlockExpected, sampleRate);
+
+    const auto rate = sourceSampleRate > 0.0 ? sourceSampleRate : sampleRate;
+    const auto size = juce::jmax (samplesPerBlockExpected * 4, juce::roundToInt (readAheadSeconds * rate)) + 1;
+
+    ring.setSize (numChannels, size, false, false, false);
+    ring.clear();
+    fifo.setTotalSize (size);
+
+    totalRead = totalWritten = 0;
+    freshFrom = 0;
+
+    producerPosition = readPosition.load();
+    requestedPosition = producerPosition;
+    producerLooping = looping.load();
+    source.setLooping (producerLooping);
+    source.setNextReadPosition (producerPosition);
+
+    consumedGeneration = seekGeneration.load();
+    ackGeneration = consumedGeneration;
+
+    isPrepared = true;
+    thread.addTimeSliceClient (this);
+}
+
+void StreamingAudioSource::releaseResources()
+{
+    // Blocks until any slice in progress has returned.
+    thread.removeTimeSliceClient (this);
+
+    if (isPrepared.exchange (false))
+        source.releaseResources();
+
+    ring.setSize (numChannels, 0);
+}
+
+//==============================================================================
+void StreamingAudioSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    const RealtimeSafetyGuard::ScopedRealtimeContext realtimeContext;
+
+    if (! isPrepared.load (std::memory_order_acquire))
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    const auto generation = seekGeneration.load (std::memory_order_relaxed);
+
+    // A seek is still in flight: nothing valid is queued yet.
+    if (ackGeneration.load (std::memory_order_acquire) != generation)
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    // First block after the seek landed: drop everything queued before it.
+    const auto seekJustLanded = consumedGeneration != generation;
+
+    if (seekJustLanded)
+    {
+        const auto stale = (int) (freshFrom.load (std::memory_order_relaxed) - totalRead);
+        jassert (stale >= 0 && stale <= fifo.getNumReady());
+
+        fifo.finishedRead (stale);
+        totalRead += stale;
+        consumedGeneration = generation;
+        fadeInPending = true;
+    }
+
+    const auto length = source.getTotalLength();
+    const auto isLoopingNow = looping.load (std::memory_order_relaxed);
+    auto position = readPosition.load (std::memory_order_relaxed);
+
+    // Past the end of a one-shot file is silence, not starvation.
+    const auto wanted = isLoopingNow ? info.numSamples
+                                     : (int) juce::jlimit ((juce::int64) 0, (juce::int64) info.numSamples, length - position);
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (juce::jmin (wanted, fifo.getNumReady()), start1, size1, start2, size2);
+
+    const auto numRead = size1 + size2;
+
+    for (int ch = 0; ch < info.buffer->getNumChannels(); ++ch)
+    {
+        if (ch >= numChannels)
+        {
+            info.buffer->clear (ch, info.startSample, numRead);
+            continue;
+        }
+
+        if (size1 > 0)
+            info.buffer->copyFrom (ch, info.startSample, ring, ch, start1, size1);
+
+        if (size2 > 0)
+            info.buffer->copyFrom (ch, info.startSample + size1, ring, ch, start2, size2);
+    }
+
+    fifo.finishedRead (numRead);
+    totalRead += numRead;
+
+    // The silence while the seek was in flight ends here, so ramp in instead of stepping.
+    if (fadeInPending && numRead > 0)
+    {
+        for (int ch = 0; ch < juce::jmin (numChannels, info.buffer->getNumChannels()); ++ch)
+            info.buffer->applyGainRamp (ch, info.startSample, numRead, 0.0f, 1.0f);
+
+        fadeInPending = false;
+    }
+
+    if (numRead < info.numSamples)
+        info.buffer->clear (info.startSample + numRead, info.numSamples - numRead);
+
+    // A FIFO still mostly full of pre-seek audio can leave the landing block short; that isn't starvation.
+    if (numRead < wanted && ! seekJustLanded)
+    {
+        underruns.fetch_add (1, std::memory_order_relaxed);
+        underrunSamples.fetch_add (wanted - numRead, std::memory_order_relaxed);
+    }
+
+    // Starved samples don't advance the playhead; silence past the end does.
+    position += numRead + (info.numSamples - wanted);
+
+    if (isLoopingNow && length > 0)
+        position %= length;
+
+    readPosition.store (position, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void StreamingAudioSource::setNextReadPosition (juce::int64 newPosition)
+{
+    const auto seekPending = ackGeneration.load (std::memory_order_relaxed) != seekGeneration.load (std::memory_order_relaxed);
+
+    if (newPosition == readPosition.load (std::memory_order_relaxed) && ! seekPending)
+        return;
+
+    // Everything queued so far is stale; freeing it now lets the producer refill straight away.
+    const auto queued = fifo.getNumReady();
+    fifo.finishedRead (queued);
+    totalRead += queued;
+
+    readPosition.store (newPosition, std::memory_order_relaxed);
+    requestedPosition.store (newPosition, std::memory_order_relaxed);
+    seekGeneration.fetch_add (1, std::memory_order_release);
+}
+
+juce::int64 StreamingAudioSource::getNextReadPosition() const
+{
+    return readPosition.load (std::memory_order_relaxed);
+}
+
+juce::int64 StreamingAudioSource::getTotalLength() const
+{
+    return source.getTotalLength();
+}
+
+bool StreamingAudioSource::isLooping() const
+{
+    return looping.load (std::memory_order_relaxed);
+}
+
+void StreamingAudioSource::setLooping (bool shouldLoop)
+{
+    looping.store (shouldLoop, std::memory_order_relaxed);
+}
+
+//==============================================================================
+int StreamingAudioSource::useTimeSlice()
+{
+    if (! isPrepared.load (std::memory_order_acquire))
+        return 50;
+
+    const auto generation = seekGeneration.load (std::memory_order_acquire);
+    const auto seekRequested = generation != ackGeneration.load (std::memory_order_relaxed);
+
+    if (seekRequested)
+    {
+        producerPosition = requestedPosition.load (std::memory_order_relaxed);
+        source.setNextReadPosition (producerPosition);
+
+        freshFrom.store (totalWritten, std::memory_order_relaxed);
+    }
+
+    // The seek is only acknowledged once audio from the new position is queued, so the
+    // consumer never lands on an empty FIFO and takes that for an underrun.
+    const auto acknowledgeSeek = [&]
+    {
+        if (seekRequested)
+            ackGeneration.store (generation, std::memory_order_release);
+    };
+
+    const auto shouldLoop = looping.load (std::memory_order_relaxed);
+
+    if (shouldLoop != producerLooping)
+    {
+        producerLooping = shouldLoop;
+        source.setLooping (shouldLoop);
+    }
+
+    const auto length = source.getTotalLength();
+    auto numToRead = fifo.getFreeSpace();
+
+    if (! producerLooping)
+        numToRead = (int) juce::jmin ((juce::int64) numToRead, juce::jmax ((juce::int64) 0, length - producerPosition));
+
+    // Keep the decoder reads reasonably sized rather than trickling single blocks.
+    constexpr int maxChunk = 8192;
+    numToRead = juce::jmin (numToRead, maxChunk);
+
+    if (numToRead <= 0)
+    {
+        acknowledgeSeek();
+        return 10;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numToRead, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        source.getNextAudioBlock (juce::AudioSourceChannelInfo (&ring, start1, size1));
+
+    if (size2 > 0)
+        source.getNextAudioBlock (juce::AudioSourceChannelInfo (&ring, start2, size2));
+
+    fifo.finishedWrite (size1 + size2);
+    totalWritten += size1 + size2;
+    producerPosition += size1 + size2;
+    acknowledgeSeek();
+
+    if (producerLooping && length > 0)
+        producerPosition %= length;
+
+    // Come straight back while there is room left, otherwise let the consumer drain.
+    return fifo.getFreeSpace() > maxChunk / 4 ? 1 : 5;
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    Read-ahead wrapper that keeps file reading and decoding off the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Positionable source that pulls from another source on a background
+    TimeSliceThread into a lock-free ring buffer a few seconds long, so that
+    getNextAudioBlock() only ever copies memory.
+
+    The audio thread is the single consumer and the read-ahead thread the single
+    producer. Seeks are posted as a generation number: the consumer plays
+    silence until the producer has repositioned, then discards whatever stale
+    audio was already queued. The first block after a seek lands is faded in,
+    so a jump never steps straight from that silence into the signal.
+
+    When the buffer starves, the missing part of the block is silent, the read
+    position does not move (playback resumes exactly where the data stopped)
+    and the underrun counters are bumped.
+*/
+class StreamingAudioSource  : public juce::PositionableAudioSource,
+                              private juce::TimeSliceClient
+{
+public:
+    /** The source is not owned and must outlive this object. sourceSampleRate
+        is used only to size the ring buffer; pass 0 to use the playback rate.
+    */
+    StreamingAudioSource (juce::PositionableAudioSource& source,
+                          juce::TimeSliceThread& readAheadThread,
+                          int numChannels,
+                          double readAheadSeconds,
+                          double sourceSampleRate = 0.0);
+
+    ~StreamingAudioSource() override;
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;
+
+    void setNextReadPosition (juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping (bool shouldLoop) override;
+
+    //==============================================================================
+    /** Number of blocks that could not be filled completely. */
+    int getNumUnderruns() const noexcept                { return underruns.load (std::memory_order_relaxed); }
+
+    /** Total number of samples replaced by silence because the buffer was empty. */
+    juce::int64 getNumUnderrunSamples() const noexcept  { return underrunSamples.load (std::memory_order_relaxed); }
+
+    /** Samples currently buffered ahead of the read position. */
+    int getNumBufferedSamples() const noexcept          { return fifo.getNumReady(); }
+
+    int getBufferSize() const noexcept                  { return ring.getNumSamples(); }
+
+private:
+    int useTimeSlice() override;
+
+    juce::PositionableAudioSource& source;
+    juce::TimeSliceThread& thread;
+
+    const int numChannels;
+    const double readAheadSeconds, sourceSampleRate;
+
+    juce::AudioBuffer<float> ring;
+    juce::AbstractFifo fifo { 1 };
+
+    // Consumer side: only touched from getNextAudioBlock/setNextReadPosition.
+    juce::int64 totalRead = 0;
+    int consumedGeneration = 0;
+    bool fadeInPending = false;         // a seek landed and no audio has been read since
+
+    // Producer side: only touched from useTimeSlice.
+    juce::int64 totalWritten = 0, producerPosition = 0;
+    bool producerLooping = false;
+
+    // Shared.
+    std::atomic<juce::int64> readPosition { 0 }, requestedPosition { 0 }, freshFrom { 0 };
+    std::atomic<int> seekGeneration { 0 }, ackGeneration { 0 };
+    std::atomic<bool> looping { false }, isPrepared { false };
+
+    std::atomic<int> underruns { 0 };
+    std::atomic<juce::int64> underrunSamples { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StreamingAudioSource)
+};
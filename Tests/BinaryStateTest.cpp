@@ -0,0 +1,279 @@
+/*
+  ==============================================================================
+
+    Checks the binary state format, and the processor restoring from it and
+    from the XML states saved before it.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../BinaryState.h"
+#include "../PluginProcessor.h"
+
+namespace
+{
+    constexpr auto unknownTag = BinaryState::makeTag ('z', 'z', 'z', 'z');
+
+    juce::RangedAudioParameter& getParameter (AudioProcessor2AudioProcessor& processor, const char* id)
+    {
+        auto* parameter = processor.apvts.getParameter (id);
+        jassert (parameter != nullptr);
+        return *parameter;
+    }
+
+    float getPlainValue (AudioProcessor2AudioProcessor& processor, const char* id)
+    {
+        auto& parameter = getParameter (processor, id);
+        return parameter.convertFrom0to1 (parameter.getValue());
+    }
+
+    void setPlainValue (AudioProcessor2AudioProcessor& processor, const char* id, float value)
+    {
+        auto& parameter = getParameter (processor, id);
+        parameter.setValueNotifyingHost (parameter.convertTo0to1 (value));
+    }
+
+    ChainLayout makeReorderedLayout()
+    {
+        ChainLayout layout;
+        layout.add (ChainLayout::Module::distortion);
+        layout.add (ChainLayout::Module::filter, true);
+        layout.add (ChainLayout::Module::delay);
+        return layout;
+    }
+}
+
+//==============================================================================
+/**
+    Covers the Reader on its own, on well-formed, truncated and newer states,
+    and then the processor: a state with a chunk this build doesn't know, a
+    state cut short at every length, and the XML state written by builds from
+    before the binary format.
+*/
+class BinaryStateTest  : public juce::UnitTest
+{
+public:
+    BinaryStateTest()  : juce::UnitTest ("BinaryState", "State") {}
+
+    void runTest() override
+    {
+        beginTest ("Chunks read back in order");
+        {
+            const auto state = writeThreeChunks();
+            BinaryState::Reader reader (state.getData(), state.getSize());
+
+            expect (reader.isValid());
+            expectEquals ((int) reader.getVersion(), (int) BinaryState::currentVersion);
+
+            expect (reader.next());
+            expect (reader.getTag() == BinaryState::makeTag ('o', 'n', 'e', ' '));
+            expectEquals ((int) reader.getChunkSize(), 4);
+            expectEquals (juce::ByteOrder::littleEndianInt (reader.getChunkData()), (juce::uint32) 1);
+
+            expect (reader.next());
+            expect (reader.getTag() == unknownTag);
+
+            expect (reader.next());
+            expect (reader.getTag() == BinaryState::makeTag ('t', 'w', 'o', ' '));
+            expectEquals ((int) reader.getChunkSize(), 0);
+
+            expect (! reader.next());
+            expectEquals ((int) reader.getPosition(), (int) state.getSize());
+        }
+
+        beginTest ("A truncated state stops at the last complete chunk");
+        {
+            const auto state = writeThreeChunks();
+            const auto chunkEnds = getChunkEnds (state);
+
+            for (size_t size = 0; size < state.getSize(); ++size)
+            {
+                BinaryState::Reader reader (state.getData(), size);
+                expect (reader.isValid() == (size >= 8));
+
+                auto numChunks = 0;
+
+                while (reader.next())
+                    ++numChunks;
+
+                const auto numWhole = std::count_if (chunkEnds.begin(), chunkEnds.end(), [size] (size_t end) { return end <= size; });
+                const auto message = "cut to " + juce::String ((int) size) + " bytes";
+
+                expectEquals (numChunks, (int) numWhole, message);
+                const auto expectedPosition = numWhole > 0 ? chunkEnds[(size_t) numWhole - 1] : (size >= 8 ? 8 : 0);
+                expectEquals ((int) reader.getPosition(), (int) expectedPosition, message);
+            }
+        }
+
+        beginTest ("A chunk claiming more than is there is refused");
+        {
+            juce::MemoryBlock state;
+            juce::MemoryOutputStream out (state, false);
+            BinaryState::writeHeader (out);
+            out.writeInt ((int) unknownTag);
+            out.writeInt (0x7fffffff);
+            out.writeInt (0);
+            out.flush();
+
+            BinaryState::Reader reader (state.getData(), state.getSize());
+            expect (reader.isValid());
+            expect (! reader.next());
+            expectEquals ((int) reader.getPosition(), 8);
+        }
+
+        beginTest ("A state from a newer version is refused");
+        {
+            auto state = writeThreeChunks();
+            const auto newer = juce::ByteOrder::swapIfBigEndian (BinaryState::currentVersion + 1);
+            state.copyFrom (&newer, 4, sizeof (newer));
+
+            BinaryState::Reader reader (state.getData(), state.getSize());
+            expect (BinaryState::isBinaryState (state.getData(), state.getSize()));
+            expect (! reader.isValid());
+            expect (! reader.next());
+        }
+
+        beginTest ("The processor skips chunks it doesn't know");
+        {
+            AudioProcessor2AudioProcessor source;
+            configure (source);
+
+            juce::MemoryBlock saved;
+            source.getStateInformation (saved);
+
+            AudioProcessor2AudioProcessor restored;
+            const auto withUnknown = insertUnknownChunks (saved);
+            restored.setStateInformation (withUnknown.getData(), (int) withUnknown.getSize());
+
+            expectConfigured (restored);
+        }
+
+        beginTest ("The processor restores what it can from a truncated state");
+        {
+            AudioProcessor2AudioProcessor source;
+            configure (source);
+
+            juce::MemoryBlock saved;
+            source.getStateInformation (saved);
+
+            // Whatever the cut, nothing reads past it. Once the parameter chunk is whole, the parameters come back.
+            const auto endOfParameters = getChunkEnds (saved).front();
+
+            for (size_t size = 1; size < saved.getSize(); ++size)
+            {
+                AudioProcessor2AudioProcessor restored;
+                restored.setStateInformation (saved.getData(), (int) size);
+
+                if (size >= endOfParameters)
+                    expectWithinAbsoluteError (getPlainValue (restored, ParamIDs::gain), -6.5f, 0.01f,
+                                               "cut to " + juce::String ((int) size) + " bytes");
+            }
+
+            AudioProcessor2AudioProcessor restored;
+            restored.setStateInformation (saved.getData(), (int) endOfParameters);
+            expectWithinAbsoluteError (getPlainValue (restored, ParamIDs::cutoff), 2500.0f, 1.0f);
+            expect (restored.getChainLayout() == ChainLayout::getDefault());
+        }
+
+        beginTest ("The processor restores an XML state from before the binary format");
+        {
+            AudioProcessor2AudioProcessor source;
+            configure (source);
+
+            // What getStateInformation() wrote then: the parameter tree, with the layout as a property.
+            auto tree = source.apvts.copyState();
+            tree.setProperty (ChainLayout::propertyID, source.getChainLayout().toString(), nullptr);
+
+            juce::MemoryBlock saved;
+            auto xml = tree.createXml();
+            juce::AudioProcessor::copyXmlToBinary (*xml, saved);
+            expect (! BinaryState::isBinaryState (saved.getData(), saved.getSize()));
+
+            AudioProcessor2AudioProcessor restored;
+            restored.setStateInformation (saved.getData(), (int) saved.getSize());
+            expectConfigured (restored);
+
+            // From before the chain could be rearranged: no layout, so the original order.
+            tree.removeProperty (ChainLayout::propertyID, nullptr);
+            xml = tree.createXml();
+            saved.reset();
+            juce::AudioProcessor::copyXmlToBinary (*xml, saved);
+
+            restored.setStateInformation (saved.getData(), (int) saved.getSize());
+            expect (restored.getChainLayout() == ChainLayout::getDefault());
+            expectWithinAbsoluteError (getPlainValue (restored, ParamIDs::gain), -6.5f, 0.01f);
+        }
+    }
+
+private:
+    static juce::MemoryBlock writeThreeChunks()
+    {
+        juce::MemoryBlock state;
+        {
+            BinaryState::Writer writer (state);
+            writer.beginChunk (BinaryState::makeTag ('o', 'n', 'e', ' ')).writeInt (1);
+            writer.endChunk();
+            writer.beginChunk (unknownTag).writeString ("from a newer build");
+            writer.endChunk();
+            writer.beginChunk (BinaryState::makeTag ('t', 'w', 'o', ' '));
+            writer.endChunk();
+        }
+        return state;
+    }
+
+    /** The same chunks with an unknown one before each, and one at the end. */
+    static juce::MemoryBlock insertUnknownChunks (const juce::MemoryBlock& state)
+    {
+        juce::MemoryBlock unknownPayload;
+        {
+            juce::MemoryOutputStream payload (unknownPayload, false);
+            payload.writeString ("from a newer build");
+            payload.writeInt (42);
+        }
+
+        juce::MemoryBlock result;
+        {
+            juce::MemoryOutputStream out (result, false);
+            BinaryState::writeHeader (out);
+
+            BinaryState::Reader reader (state.getData(), state.getSize());
+
+            while (reader.next())
+            {
+                BinaryState::writeChunk (out, unknownTag, unknownPayload);
+                BinaryState::writeChunk (out, reader.getTag(), juce::MemoryBlock (reader.getChunkData(), reader.getChunkSize()));
+            }
+
+            BinaryState::writeChunk (out, unknownTag, unknownPayload);
+        }
+        return result;
+    }
+
+    static std::vector<size_t> getChunkEnds (const juce::MemoryBlock& state)
+    {
+        std::vector<size_t> ends;
+        BinaryState::Reader reader (state.getData(), state.getSize());
+
+        while (reader.next())
+            ends.push_back (reader.getPosition());
+
+        return ends;
+    }
+
+    static void configure (AudioProcessor2AudioProcessor& processor)
+    {
+        setPlainValue (processor, ParamIDs::gain, -6.5f);
+        setPlainValue (processor, ParamIDs::cutoff, 2500.0f);
+        processor.setChainLayout (makeReorderedLayout());
+    }
+
+    void expectConfigured (AudioProcessor2AudioProcessor& processor)
+    {
+        expectWithinAbsoluteError (getPlainValue (processor, ParamIDs::gain), -6.5f, 0.01f);
+        expectWithinAbsoluteError (getPlainValue (processor, ParamIDs::cutoff), 2500.0f, 1.0f);
+        expect (processor.getChainLayout() == makeReorderedLayout());
+    }
+};
+
+static BinaryStateTest binaryStateTest;
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    Checks every MultiChannelBiquad kernel against juce::dsp::IIR::Filter.
+
+    Built with Tests/TestMain.cpp as the MultiChannelBiquadTest target in
+    CMakeLists.txt, and run by ctest.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../MultiChannelBiquad.h"
+
+namespace
+{
+    using Kernel = MultiChannelBiquad::Kernel;
+
+    const char* getKernelName (Kernel kernel)
+    {
+        switch (kernel)
+        {
+            case Kernel::scalar:    return "scalar";
+            case Kernel::sse:       return "sse";
+            case Kernel::avx:       return "avx";
+            case Kernel::neon:      return "neon";
+            default:                return "unknown";
+        }
+    }
+
+    juce::dsp::IIR::Coefficients<float>::Ptr toJuceCoefficients (const BiquadCoefficients& c)
+    {
+        return new juce::dsp::IIR::Coefficients<float> (c.b0, c.b1, c.b2, 1.0f, c.a1, c.a2);
+    }
+}
+
+//==============================================================================
+/**
+    Runs the same noise through a MultiChannelBiquad and through one
+    juce::dsp::IIR::Filter per channel, for every kernel this build and CPU
+    have and every channel count up to maxChannels.
+
+    Blocks are cut at random lengths, so they start and end anywhere in the
+    kernels' chunks and lane groups, and the coefficients jump now and then
+    with the filter state carried over. A stretch of silence lets the state
+    decay into the denormal range, where both snap it to zero after a block.
+
+    The kernels follow IIR::Filter's operation order without fused
+    multiply-adds, so the outputs should match exactly; the tolerance only
+    leaves room for a compiler that contracts the reference's own arithmetic.
+*/
+class MultiChannelBiquadTest  : public juce::UnitTest
+{
+public:
+    MultiChannelBiquadTest()  : juce::UnitTest ("MultiChannelBiquad", "DSP") {}
+
+    void runTest() override
+    {
+        for (auto kernel : { Kernel::scalar, Kernel::sse, Kernel::avx, Kernel::neon })
+        {
+            if (! MultiChannelBiquad::isKernelAvailable (kernel))
+            {
+                logMessage (juce::String ("Skipping ") + getKernelName (kernel) + ": not in this build or on this CPU");
+                continue;
+            }
+
+            beginTest (getKernelName (kernel));
+
+            for (int numChannels = 1; numChannels <= MultiChannelBiquad::maxChannels; ++numChannels)
+                compareWithReference (kernel, numChannels);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int maxBlockSize = 300;
+    static constexpr int numBlocks = 120;
+
+    void compareWithReference (Kernel kernel, int numChannels)
+    {
+        auto random = getRandom();
+
+        MultiChannelBiquad biquad;
+        biquad.prepare (numChannels);
+        biquad.setKernel (kernel);
+        expect (biquad.getKernel() == kernel);
+
+        std::vector<juce::dsp::IIR::Filter<float>> reference ((size_t) numChannels);
+
+        for (auto& filter : reference)
+            filter.prepare ({ sampleRate, (juce::uint32) maxBlockSize, 1 });
+
+        auto coefficients = BiquadCoefficients::makeLowPass (sampleRate, 1000.0f, 0.707f);
+        setCoefficients (biquad, reference, coefficients);
+
+        juce::AudioBuffer<float> actual (numChannels, maxBlockSize), expected (numChannels, maxBlockSize);
+        auto maxError = 0.0f;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // Lengths from 1 up to several chunks, so every split point against chunks and lanes comes up.
+            const auto numSamples = 1 + random.nextInt (maxBlockSize);
+            const auto silent = block >= numBlocks - 30;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < numSamples; ++i)
+                    actual.setSample (ch, i, silent ? 0.0f : random.nextFloat() * 2.0f - 1.0f);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                expected.copyFrom (ch, 0, actual, ch, 0, numSamples);
+
+            if (block % 7 == 6)
+            {
+                coefficients = BiquadCoefficients::makeLowPass (sampleRate,
+                                                                20.0f * std::pow (1000.0f, random.nextFloat()),
+                                                                0.1f + random.nextFloat() * 9.9f);
+                setCoefficients (biquad, reference, coefficients);
+            }
+
+            biquad.process (actual.getArrayOfWritePointers(), numChannels, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* samples = expected.getWritePointer (ch);
+                juce::dsp::AudioBlock<float> channelBlock (&samples, 1, (size_t) numSamples);
+                reference[(size_t) ch].process (juce::dsp::ProcessContextReplacing<float> (channelBlock));
+            }
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < numSamples; ++i)
+                    maxError = juce::jmax (maxError, std::abs (actual.getSample (ch, i) - expected.getSample (ch, i)));
+        }
+
+        expectWithinAbsoluteError (maxError, 0.0f, 1.0e-5f,
+                                   juce::String (getKernelName (kernel)) + ", " + juce::String (numChannels) + " channels");
+    }
+
+    static void setCoefficients (MultiChannelBiquad& biquad, std::vector<juce::dsp::IIR::Filter<float>>& reference,
+                                 const BiquadCoefficients& coefficients)
+    {
+        biquad.setCoefficients (coefficients);
+
+        for (auto& filter : reference)
+            filter.coefficients = toJuceCoefficients (coefficients);
+    }
+};
+
+static MultiChannelBiquadTest multiChannelBiquadTest;
@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    Checks that the preset library's index journal survives a torn last
+    record, and that compacting it keeps every preset.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../BinaryState.h"
+#include "../PresetLibrary.h"
+
+namespace
+{
+    // The journal's record tags, as PresetLibrary.cpp writes them.
+    constexpr auto addRecord    = BinaryState::makeTag ('p', 'a', 'd', 'd');
+    constexpr auto nextIdRecord = BinaryState::makeTag ('n', 'e', 'x', 't');
+
+    juce::MemoryBlock makeState (int value)
+    {
+        juce::MemoryBlock state;
+        juce::MemoryOutputStream (state, false).writeInt (value);
+        return state;
+    }
+
+    juce::StringArray getNames (PresetLibrary& library)
+    {
+        juce::StringArray names;
+
+        for (const auto& preset : library.getPresets())
+            names.add (preset.name);
+
+        return names;
+    }
+}
+
+//==============================================================================
+/**
+    Each case works on a library in a fresh temporary directory, and reads it
+    back through a second instance, as the next process would.
+*/
+class PresetLibraryTest  : public juce::UnitTest
+{
+public:
+    PresetLibraryTest()  : juce::UnitTest ("PresetLibrary", "State") {}
+
+    void runTest() override
+    {
+        beginTest ("A record cut short is dropped and the complete ones kept");
+        {
+            const TemporaryDirectory directory;
+            int alpha, beta;
+
+            {
+                PresetLibrary library (directory.file);
+                alpha = library.save ("Alpha", { "bright" }, makeState (1));
+                beta = library.save ("Beta", {}, makeState (2));
+                library.save ("Gamma", { "dark", "wide" }, makeState (3));
+            }
+
+            // As if the process died halfway through appending Gamma.
+            const auto index = directory.file.getChildFile ("index");
+            truncate (index, index.getSize() - 3);
+
+            {
+                PresetLibrary library (directory.file);
+                expectEquals (getNames (library).joinIntoString (","), juce::String ("Alpha,Beta"));
+                expect (library.getPreset (alpha).tags == juce::StringArray ("bright"));
+
+                juce::MemoryBlock state;
+                expect (library.load (beta, state));
+                expect (state == makeState (2));
+
+                // The next append first rewrites the journal without the torn record.
+                expect (library.save ("Delta", {}, makeState (4)) != 0);
+                expectWholeJournal (index);
+            }
+
+            PresetLibrary reopened (directory.file);
+            expectEquals (getNames (reopened).joinIntoString (","), juce::String ("Alpha,Beta,Delta"));
+        }
+
+        beginTest ("A journal ending in a partial record header loses nothing");
+        {
+            const TemporaryDirectory directory;
+
+            {
+                PresetLibrary library (directory.file);
+                library.save ("Alpha", {}, makeState (1));
+                library.save ("Beta", {}, makeState (2));
+            }
+
+            const auto index = directory.file.getChildFile ("index");
+            juce::FileOutputStream (index).writeInt ((int) addRecord);
+
+            PresetLibrary library (directory.file);
+            expectEquals (getNames (library).joinIntoString (","), juce::String ("Alpha,Beta"));
+        }
+
+        beginTest ("Compaction rewrites the journal with one record per preset");
+        {
+            const TemporaryDirectory directory;
+            const auto index = directory.file.getChildFile ("index");
+            int keep, removed, lastSaved = 0;
+
+            {
+                PresetLibrary library (directory.file);
+                keep = library.save ("Keep", { "bass" }, makeState (0));
+                removed = library.save ("Removed", {}, makeState (0));
+                expect (library.remove (removed));
+
+                // Each save under the same name leaves a stale record, until there are enough to compact.
+                auto compacted = false;
+
+                for (int i = 1; i <= 1000 && ! compacted; ++i)
+                {
+                    const auto sizeBefore = index.getSize();
+                    expectEquals (library.save ("Keep", { "bass" }, makeState (i)), keep);
+                    lastSaved = i;
+                    compacted = index.getSize() < sizeBefore;
+                }
+
+                expect (compacted, "the journal was never compacted");
+                expectWholeJournal (index);
+
+                juce::MemoryBlock data;
+                index.loadFileAsData (data);
+                BinaryState::Reader reader (data.getData(), data.getSize());
+
+                // The first unused ID survives, so the removed preset's ID isn't handed out again.
+                expect (reader.next() && reader.getTag() == nextIdRecord);
+                expectEquals ((int) juce::ByteOrder::littleEndianInt (reader.getChunkData()), removed + 1);
+
+                expect (reader.next() && reader.getTag() == addRecord);
+                expect (! reader.next());
+            }
+
+            PresetLibrary reopened (directory.file);
+            const auto presets = reopened.getPresets();
+            expectEquals ((int) presets.size(), 1);
+            expect (presets.front().id == keep && presets.front().name == "Keep");
+            expect (presets.front().tags == juce::StringArray ("bass"));
+
+            juce::MemoryBlock state;
+            expect (reopened.load (keep, state));
+            expect (state == makeState (lastSaved));
+            expect (! reopened.load (removed, state));
+
+            expect (reopened.save ("New", {}, makeState (0)) == removed + 1);
+        }
+    }
+
+private:
+    struct TemporaryDirectory
+    {
+        TemporaryDirectory()
+            : file (juce::File::getSpecialLocation (juce::File::tempDirectory)
+                       .getNonexistentChildFile ("PresetLibraryTest", {}, false))
+        {
+            file.createDirectory();
+        }
+
+        ~TemporaryDirectory()
+        {
+            file.deleteRecursively();
+        }
+
+        const juce::File file;
+    };
+
+    static void truncate (const juce::File& file, juce::int64 size)
+    {
+        juce::FileOutputStream out (file);
+        out.setPosition (size);
+        out.truncate();
+    }
+
+    /** The journal parses to its last byte, with nothing torn at the end. */
+    void expectWholeJournal (const juce::File& index)
+    {
+        juce::MemoryBlock data;
+        expect (index.loadFileAsData (data));
+
+        BinaryState::Reader reader (data.getData(), data.getSize());
+        expect (reader.isValid());
+
+        while (reader.next()) {}
+
+        expectEquals ((int) reader.getPosition(), (int) data.getSize());
+    }
+};
+
+static PresetLibraryTest presetLibraryTest;
@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    Entry point shared by the test targets in CMakeLists.txt.
+
+    Each target links this with its test files, whose static juce::UnitTest
+    instances register themselves, and ctest runs the targets. Exits non-zero
+    if any test fails.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+int main()
+{
+    // The processor's parameters and change messages need the message manager.
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runAllTests (0x5eed);
+
+    auto failures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult (i)->failures;
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    Waveform thumbnails that outlive the session.
+
+  ==============================================================================
+*/
+
+#include "ThumbnailDiskCache.h"
+
+namespace
+{
+    struct SizedFileInputSource  : public juce::FileInputSource
+    {
+        explicit SizedFileInputSource (const juce::File& f)
+            : juce::FileInputSource (f, true), size (f.getSize())
+        {
+        }
+
+        juce::int64 hashCode() const override
+        {
+            return juce::FileInputSource::hashCode() * 101 + size;
+        }
+
+        const juce::int64 size;
+    };
+}
+
+//==============================================================================
+ThumbnailDiskCache::ThumbnailDiskCache()
+    : juce::AudioThumbnailCache (maxThumbsInMemory),
+      directory (getDefaultDirectory())
+{
+}
+
+juce::InputSource* ThumbnailDiskCache::createSource (const juce::File& file)
+{
+    return new SizedFileInputSource (file);
+}
+
+juce::File ThumbnailDiskCache::getDefaultDirectory()
+{
+    auto base = juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory);
+
+   #if JUCE_MAC
+    base = base.getChildFile ("Caches");
+   #endif
+
+    return base.getChildFile (JucePlugin_Name).getChildFile ("Thumbnails");
+}
+
+juce::File ThumbnailDiskCache::getFileFor (juce::int64 hashCode) const
+{
+    return directory.getChildFile (juce::String::toHexString (hashCode) + ".thumb");
+}
+
+//==============================================================================
+void ThumbnailDiskCache::saveNewlyFinishedThumbnail (const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    if (! directory.createDirectory())
+        return;
+
+    const auto file = getFileFor (hashCode);
+    juce::TemporaryFile temp (file);
+
+    {
+        juce::FileOutputStream out (temp.getFile());
+
+        if (! out.openedOk())
+            return;
+
+        thumb.saveTo (out);
+        out.flush();
+
+        if (out.getStatus().failed())
+            return;
+    }
+
+    if (temp.overwriteTargetFileWithTemporary())
+        prune();
+}
+
+bool ThumbnailDiskCache::loadNewThumb (juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const auto file = getFileFor (hashCode);
+    juce::FileInputStream in (file);
+
+    if (! in.openedOk() || ! thumb.loadFrom (in))
+        return false;
+
+    // The modification time doubles as the last-used time for pruning.
+    file.setLastModificationTime (juce::Time::getCurrentTime());
+    return true;
+}
+
+void ThumbnailDiskCache::prune()
+{
+    auto files = directory.findChildFiles (juce::File::findFiles, false, "*.thumb");
+
+    if (files.size() <= maxFilesOnDisk)
+        return;
+
+    std::sort (files.begin(), files.end(), [] (const juce::File& a, const juce::File& b)
+    {
+        return a.getLastModificationTime() > b.getLastModificationTime();
+    });
+
+    for (int i = maxFilesOnDisk; i < files.size(); ++i)
+        files.getReference (i).deleteFile();
+}
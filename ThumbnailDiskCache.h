@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    Waveform thumbnails that outlive the session.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    An AudioThumbnailCache that also keeps every finished thumbnail on disk, so
+    a file that has been opened before shows its whole overview straight away
+    instead of being scanned again.
+
+    Entries are keyed by the hash of createSource(): the file's path, size and
+    modification time. Editing a file in place gives it a new key, and its old
+    entry ages out. Each entry is written to a temporary file and renamed into
+    place, so an interrupted write or a second process can never leave a torn
+    one behind. Anything that fails to load is just scanned again. The
+    directory is pruned to the maxFilesOnDisk most recently used entries.
+
+    Saving happens on the cache's own thread once a scan completes; loading
+    happens on the message thread when a thumbnail is given its source. Share
+    one instance between editors through a juce::SharedResourcePointer.
+*/
+class ThumbnailDiskCache  : public juce::AudioThumbnailCache
+{
+public:
+    ThumbnailDiskCache();
+
+    /** The source to give AudioThumbnail::setSource(), so the cache key covers the file's size too. */
+    static juce::InputSource* createSource (const juce::File& file);
+
+    static juce::File getDefaultDirectory();
+
+protected:
+    void saveNewlyFinishedThumbnail (const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+    bool loadNewThumb (juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+    static constexpr int maxThumbsInMemory = 8;
+    static constexpr int maxFilesOnDisk = 256;
+
+    juce::File getFileFor (juce::int64 hashCode) const;
+    void prune();
+
+    const juce::File directory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailDiskCache)
+};
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    Overview of the loaded file, with a playhead and click-to-seek.
+
+  ==============================================================================
+*/
+
+#include "WaveformView.h"
+
+//==============================================================================
+WaveformView::WaveformView (AudioProcessor2AudioProcessor& p)
+    : ShowingTimerComponent (refreshRateHz),
+      processor (p),
+      thumbnail (samplesPerThumbnailSample, p.getFormatManager(), *cache)
+{
+    setOpaque (true);
+
+    thumbnail.addChangeListener (this);
+    processor.addChangeListener (this);
+
+    showFile (processor.getLoadedFile());
+}
+
+WaveformView::~WaveformView()
+{
+    processor.removeChangeListener (this);
+    thumbnail.removeChangeListener (this);
+}
+
+//==============================================================================
+void WaveformView::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colour::fromRGB (30, 34, 38));
+
+    const auto area = getLocalBounds().reduced (0, 2);
+
+    if (thumbnail.getTotalLength() <= 0.0)
+    {
+        g.setColour (juce::Colours::grey);
+        g.drawText (shownFile == juce::File() ? "No file loaded" : "Reading " + shownFile.getFileName() + "...",
+                    area, juce::Justification::centred);
+        return;
+    }
+
+    // Drawn up to wherever the scan has got; the rest fills in on later change messages.
+    g.setColour (juce::Colours::springgreen.withAlpha (0.8f));
+    thumbnail.drawChannels (g, area, 0.0, thumbnail.getTotalLength(), 1.0f);
+
+    if (playheadX >= 0)
+    {
+        g.setColour (juce::Colours::white);
+        g.fillRect (playheadX, 0, 1, getHeight());
+    }
+}
+
+void WaveformView::resized()
+{
+    playheadX = getPlayheadX();
+}
+
+//==============================================================================
+void WaveformView::mouseDown (const juce::MouseEvent& e)
+{
+    seekTo (e.x);
+}
+
+void WaveformView::mouseDrag (const juce::MouseEvent& e)
+{
+    seekTo (e.x);
+}
+
+void WaveformView::seekTo (int x)
+{
+    const auto length = processor.getPlaybackLength();
+
+    if (length <= 0 || getWidth() <= 0)
+        return;
+
+    const auto proportion = juce::jlimit (0.0, 1.0, (double) x / (double) getWidth());
+    processor.seek ((juce::int64) (proportion * (double) length));
+
+    // Show the jump now rather than on the next tick.
+    movePlayhead (juce::jlimit (0, getWidth() - 1, x));
+}
+
+//==============================================================================
+void WaveformView::changeListenerCallback (juce::ChangeBroadcaster* source)
+{
+    if (source == &processor)
+        showFile (processor.getLoadedFile());
+    else
+        repaint();
+}
+
+void WaveformView::showFile (const juce::File& file)
+{
+    if (file == shownFile)
+        return;
+
+    shownFile = file;
+
+    if (file.existsAsFile())
+        thumbnail.setSource (ThumbnailDiskCache::createSource (file));
+    else
+        thumbnail.clear();
+
+    playheadX = getPlayheadX();
+    repaint();
+}
+
+void WaveformView::timerCallback()
+{
+    if (! isMouseButtonDown())
+        movePlayhead (getPlayheadX());
+}
+
+void WaveformView::movePlayhead (int newX)
+{
+    if (newX == playheadX)
+        return;
+
+    if (playheadX >= 0)
+        repaint (playheadX, 0, 1, getHeight());
+
+    if (newX >= 0)
+        repaint (newX, 0, 1, getHeight());
+
+    playheadX = newX;
+}
+
+int WaveformView::getPlayheadX() const noexcept
+{
+    const auto length = processor.getPlaybackLength();
+
+    if (length <= 0 || getWidth() <= 0)
+        return -1;
+
+    const auto proportion = (double) processor.getPlaybackPosition() / (double) length;
+    return juce::jlimit (0, getWidth() - 1, (int) (proportion * (double) getWidth()));
+}
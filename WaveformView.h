@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    Overview of the loaded file, with a playhead and click-to-seek.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "ShowingTimerComponent.h"
+#include "ThumbnailDiskCache.h"
+
+//==============================================================================
+/**
+    The whole of the loaded file as a waveform, with a line at the playhead.
+    Clicking or dragging moves playback there.
+
+    The thumbnail is built on the shared cache's thread and drawn as it fills
+    in. A file seen before comes from the disk cache, so its overview shows at
+    once. The waveform is repainted only when the thumbnail or the file
+    changes. While the view is showing, a timer reads the playhead and
+    repaints just the strips it leaves and enters.
+*/
+class WaveformView  : public ShowingTimerComponent,
+                      private juce::ChangeListener
+{
+public:
+    explicit WaveformView (AudioProcessor2AudioProcessor& processor);
+    ~WaveformView() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    void mouseDown (const juce::MouseEvent&) override;
+    void mouseDrag (const juce::MouseEvent&) override;
+
+private:
+    static constexpr int samplesPerThumbnailSample = 512;
+    static constexpr int refreshRateHz = 30;
+
+    void changeListenerCallback (juce::ChangeBroadcaster* source) override;
+    void timerCallback() override;
+
+    void showFile (const juce::File& file);
+    void seekTo (int x);
+    void movePlayhead (int newX);
+    int getPlayheadX() const noexcept;
+
+    AudioProcessor2AudioProcessor& processor;
+
+    juce::SharedResourcePointer<ThumbnailDiskCache> cache;
+    juce::AudioThumbnail thumbnail;
+    juce::File shownFile;
+
+    int playheadX = -1;         // -1 when there is nothing to show
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformView)
+};